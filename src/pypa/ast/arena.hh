@@ -0,0 +1,166 @@
+// Copyright 2014 Vinzenz Feenstra
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#ifndef GUARD_PYPA_AST_ARENA_HH_INCLUDED
+#define GUARD_PYPA_AST_ARENA_HH_INCLUDED
+
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace pypa {
+
+// Owns all AST nodes of a parse when libpypa is built with PYPA_AST_ARENA.
+// Nodes are bump allocated in chunks and are never freed individually,
+// destroying the arena releases the whole tree at once. Node destructors
+// (for the member vectors and strings) run in one flat loop, the pointers
+// between nodes are plain handles and don't recurse.
+class AstArena {
+    enum {
+        ChunkSize = 64 * 1024
+    };
+
+    struct Destructor {
+        void (*destroy)(void *);
+        void * object;
+    };
+
+    std::vector<std::unique_ptr<char[]>> chunks_;
+    std::vector<Destructor> destructors_;
+    char * pos_;
+    std::size_t left_;
+
+public:
+    AstArena()
+    : chunks_()
+    , destructors_()
+    , pos_(0)
+    , left_(0)
+    {}
+
+    AstArena(AstArena const &) = delete;
+    AstArena & operator=(AstArena const &) = delete;
+
+    ~AstArena() {
+        clear();
+    }
+
+    // Destroys all nodes and frees the chunks, the arena can be reused
+    void clear() {
+        for(auto const & d : destructors_) {
+            d.destroy(d.object);
+        }
+        destructors_.clear();
+        chunks_.clear();
+        pos_ = 0;
+        left_ = 0;
+    }
+
+    template< typename T, typename... Args >
+    T * create(Args &&... args) {
+        T * result = new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+        if(!std::is_trivially_destructible<T>::value) {
+            destructors_.push_back({&destroy<T>, result});
+        }
+        return result;
+    }
+
+private:
+    template< typename T >
+    static void destroy(void * p) {
+        static_cast<T *>(p)->~T();
+    }
+
+    void * allocate(std::size_t size, std::size_t align) {
+        std::size_t skew = (align - std::size_t(pos_) % align) % align;
+        if(size + skew > left_) {
+            grow(size + align);
+            skew = (align - std::size_t(pos_) % align) % align;
+        }
+        void * result = pos_ + skew;
+        pos_ += size + skew;
+        left_ -= size + skew;
+        return result;
+    }
+
+    void grow(std::size_t size) {
+        std::size_t chunk_size = size > std::size_t(ChunkSize) ? size : std::size_t(ChunkSize);
+        chunks_.emplace_back(new char[chunk_size]);
+        pos_ = chunks_.back().get();
+        left_ = chunk_size;
+    }
+};
+
+#ifdef PYPA_AST_ARENA
+// Non owning handle to a node allocated in an AstArena, a plain pointer
+// with the subset of the std::shared_ptr interface the AST code uses.
+template< typename T >
+class AstArenaPtr {
+    T * ptr_;
+public:
+    typedef T element_type;
+
+    AstArenaPtr() : ptr_(0) {}
+    AstArenaPtr(std::nullptr_t) : ptr_(0) {}
+    explicit AstArenaPtr(T * ptr) : ptr_(ptr) {}
+
+    template< typename U, typename = typename std::enable_if<std::is_convertible<U *, T *>::value>::type >
+    AstArenaPtr(AstArenaPtr<U> const & other) : ptr_(other.get()) {}
+
+    T * get() const { return ptr_; }
+    T & operator*() const { return *ptr_; }
+    T * operator->() const { return ptr_; }
+    explicit operator bool() const { return ptr_ != 0; }
+    void reset() { ptr_ = 0; }
+
+    template< typename U >
+    bool operator==(AstArenaPtr<U> const & other) const { return ptr_ == other.get(); }
+    template< typename U >
+    bool operator!=(AstArenaPtr<U> const & other) const { return ptr_ != other.get(); }
+};
+
+template< typename T >
+using AstPtrT = AstArenaPtr<T>;
+
+template< typename U, typename T >
+inline AstPtrT<U> ast_cast(AstPtrT<T> const & p) {
+    return AstPtrT<U>(static_cast<U *>(p.get()));
+}
+
+template< typename T, typename... Args >
+inline AstPtrT<T> make_ast(AstArena * arena, Args &&... args) {
+    assert(arena && "PYPA_AST_ARENA builds require ParserOptions::arena");
+    return AstPtrT<T>(arena->create<T>(std::forward<Args>(args)...));
+}
+#else
+template< typename T >
+using AstPtrT = std::shared_ptr<T>;
+
+template< typename U, typename T >
+inline AstPtrT<U> ast_cast(AstPtrT<T> const & p) {
+    return std::static_pointer_cast<U>(p);
+}
+
+template< typename T, typename... Args >
+inline AstPtrT<T> make_ast(AstArena *, Args &&... args) {
+    return std::make_shared<T>(std::forward<Args>(args)...);
+}
+#endif
+
+}
+
+#endif // GUARD_PYPA_AST_ARENA_HH_INCLUDED
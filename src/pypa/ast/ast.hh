@@ -255,6 +255,14 @@ PYPA_AST_EXPR(Lambda) {
 };
 PYPA_AST_MEMBERS2(Lambda, arguments, body);
 
+// Function body which wasn't parsed yet (ParserOptions::lazy_bodies), it's
+// located at its first line. `items` holds the docstring, if there is one.
+PYPA_AST_STMT(LazySuite) {
+    AstStmtList items;
+    String      source;     // The lines of the body
+};
+PYPA_AST_MEMBERS2(LazySuite, items, source);
+
 PYPA_AST_EXPR(List) {
     AstExprList elements;
     AstContext  context;
@@ -281,9 +289,13 @@ PYPA_AST_EXPR(Number) {
         int64_t integer;
         char    data[sizeof(double) > sizeof(int64_t) ? sizeof(double) : sizeof(int64_t)];
     };
+    // Long: decimal value in `str`, the magnitude as 32 bit limbs (least
+    // significant first, no leading zero limbs) and the sign in `negative`
     String str;
+    std::vector<uint32_t> limbs;
+    bool negative;
 };
-PYPA_AST_MEMBERS5(Number, data, floating, integer, num_type, str);
+PYPA_AST_MEMBERS7(Number, data, floating, integer, limbs, negative, num_type, str);
 
 
 PYPA_AST_EXPR(Complex) {
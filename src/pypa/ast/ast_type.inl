@@ -49,6 +49,7 @@ PYPA_AST_TYPE(ImportFrom)
 PYPA_AST_TYPE(Index)
 PYPA_AST_TYPE(Keyword)
 PYPA_AST_TYPE(Lambda)
+PYPA_AST_TYPE(LazySuite)
 PYPA_AST_TYPE(List)
 PYPA_AST_TYPE(ListComp)
 PYPA_AST_TYPE(Module)
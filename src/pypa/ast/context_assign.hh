@@ -22,7 +22,7 @@ struct context_assign {
     AstContext context;
 
     template< typename T >
-    void operator() (std::shared_ptr<T> p) {
+    void operator() (AstPtrT<T> p) {
         if(p) (*this)(*p);
     }
 
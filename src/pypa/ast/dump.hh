@@ -43,7 +43,7 @@ namespace pypa {
         }
 
         template< typename T, typename V, typename F>
-        void apply_member(std::shared_ptr<T> t, V T::*member, F f) {
+        void apply_member(AstPtrT<T> t, V T::*member, F f) {
             f((*t).*member);
         }
 
@@ -75,6 +75,10 @@ namespace pypa {
             printf("%d\n", int(v));
         }
 
+        inline void dump_member_value(int depth, uint32_t const & v) {
+            printf("%u\n", unsigned(v));
+        }
+
         inline void dump_member_value(int depth, int64_t const & v) {
             long long int p = v;
             printf("%lld\n", p);
@@ -109,7 +113,7 @@ namespace pypa {
         }
 
         template< typename T >
-        inline void dump_member_value(int depth, std::shared_ptr<T> const & v) {
+        inline void dump_member_value(int depth, AstPtrT<T> const & v) {
             if(!v) {
                 printf("<NULL>\n");
             }
@@ -120,7 +124,7 @@ namespace pypa {
         }
 
         template< typename T >
-        inline void dump_padded_member(int depth, std::shared_ptr<T> const & v) {
+        inline void dump_padded_member(int depth, AstPtrT<T> const & v) {
             if(!v) { printf("\n"); print_padding(depth+4); }
             dump_member_value(depth+4, v);
         }
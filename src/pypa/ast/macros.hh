@@ -38,7 +38,7 @@
 
 
 #define PYPA_AST_TYPE_DECL_ALIAS(NAME, ALIASPTR, ALIASLIST) \
-    typedef std::shared_ptr<struct NAME> ALIASPTR;          \
+    typedef AstPtrT<struct NAME> ALIASPTR;          \
     typedef std::vector<ALIASPTR> ALIASLIST;                \
     struct NAME
 
@@ -64,18 +64,18 @@
 
 
 #define PYPA_AST_STMT(AST_TYPE)                                         \
-    typedef std::shared_ptr<struct Ast##AST_TYPE> Ast##AST_TYPE##Ptr;   \
+    typedef AstPtrT<struct Ast##AST_TYPE> Ast##AST_TYPE##Ptr;   \
     DEF_AST_TYPE_BY_ID(AST_TYPE, struct Ast##AST_TYPE);                 \
     struct Ast##AST_TYPE : AstStmtT<AstType::AST_TYPE>
 
 
 #define PYPA_AST_EXPR(AST_TYPE)                                         \
-    typedef std::shared_ptr<struct Ast##AST_TYPE> Ast##AST_TYPE##Ptr;   \
+    typedef AstPtrT<struct Ast##AST_TYPE> Ast##AST_TYPE##Ptr;   \
     DEF_AST_TYPE_BY_ID(AST_TYPE, struct Ast##AST_TYPE);                 \
     struct Ast##AST_TYPE : AstExprT<AstType::AST_TYPE>
 
 #define PYPA_AST_SLICE(AST_TYPE)                                        \
-    typedef std::shared_ptr<struct Ast##AST_TYPE> Ast##AST_TYPE##Ptr;   \
+    typedef AstPtrT<struct Ast##AST_TYPE> Ast##AST_TYPE##Ptr;   \
     DEF_AST_TYPE_BY_ID(AST_TYPE, struct Ast##AST_TYPE);                 \
     struct Ast##AST_TYPE : AstSliceTypeT<AstType::AST_TYPE>
 
@@ -83,7 +83,7 @@
     template<>                                                                      \
     struct ast_member_dump<Ast##TYPEID> {                                           \
         typedef Ast##TYPEID Type;                                                   \
-        static void dump(int depth, std::shared_ptr<Ast##TYPEID> const & p) {       \
+        static void dump(int depth, AstPtrT<Ast##TYPEID> const & p) {       \
             if(p) dump(depth, *p);                                                  \
         }                                                                           \
         static void dump(int depth, Ast##TYPEID const & t) {                        \
@@ -112,15 +112,15 @@
     template<>                                                                  \
     struct ast_member_visit<AstType::TYPEID> {                                  \
         template<typename T, typename V, typename F>                            \
-        static void do_apply(T t, V T::*v, F f) {                               \
+        static void do_apply(T & t, V T::*v, F f) {                             \
             detail::apply_member(t, v, f);                                      \
         }                                                                       \
         template<typename T, typename V, typename F>                            \
-        static void do_apply(std::shared_ptr<T> t, V T::*v, F f) {              \
+        static void do_apply(AstPtrT<T> t, V T::*v, F f) {              \
             detail::apply_member(t, v, f);                                      \
         }                                                                       \
         template<typename T, typename F>                                        \
-        static void apply(T t, F f) {                                           \
+        static void apply(T & t, F f) {                                         \
             typedef typename AstTypeByID<AstType::TYPEID>::Type Type;           \
             if(!f(t)) return;
 
@@ -128,9 +128,29 @@
 #define PYPA_AST_MEMBER_VISIT_IMPL_END }}
 
 
+#define PYPA_AST_MEMBER_NAMES_IMPL_BEGIN(TYPEID)                \
+    template<>                                                  \
+    struct ast_member_names<AstType::TYPEID> {                  \
+        static char const * const * get() {                     \
+            static char const * const names[] = {
+
+
+#define PYPA_AST_MEMBER_NAMES_ITEM(ARGNAME)                     \
+                #ARGNAME,
+
+
+#define PYPA_AST_MEMBER_NAMES_IMPL_END                          \
+            0 };                                                \
+            return names;                                       \
+        }                                                       \
+    };
+
+
 #define PYPA_AST_MEMBERS0(TYPE)                 \
     PYPA_AST_MEMBER_DUMP_IMPL_BEGIN(TYPE)       \
     PYPA_AST_MEMBER_DUMP_IMPL_END(TYPE)         \
+    PYPA_AST_MEMBER_NAMES_IMPL_BEGIN(TYPE)      \
+    PYPA_AST_MEMBER_NAMES_IMPL_END              \
     PYPA_AST_MEMBER_VISIT_IMPL_BEGIN(TYPE)      \
     PYPA_AST_MEMBER_VISIT_IMPL_END
 
@@ -139,6 +159,9 @@
     PYPA_AST_MEMBER_DUMP_IMPL_BEGIN(TYPE)       \
     PYPA_AST_MEMBER_DUMP_MEMBER_ITEM(ARG0)      \
     PYPA_AST_MEMBER_DUMP_IMPL_END(TYPE)         \
+    PYPA_AST_MEMBER_NAMES_IMPL_BEGIN(TYPE)      \
+    PYPA_AST_MEMBER_NAMES_ITEM(ARG0)            \
+    PYPA_AST_MEMBER_NAMES_IMPL_END              \
     PYPA_AST_MEMBER_VISIT_IMPL_BEGIN(TYPE)      \
     do_apply(t, &Type::ARG0, f);                \
     PYPA_AST_MEMBER_VISIT_IMPL_END
@@ -149,6 +172,10 @@
     PYPA_AST_MEMBER_DUMP_MEMBER_ITEM(ARG0)      \
     PYPA_AST_MEMBER_DUMP_MEMBER_ITEM(ARG1)      \
     PYPA_AST_MEMBER_DUMP_IMPL_END(TYPE)         \
+    PYPA_AST_MEMBER_NAMES_IMPL_BEGIN(TYPE)      \
+    PYPA_AST_MEMBER_NAMES_ITEM(ARG0)            \
+    PYPA_AST_MEMBER_NAMES_ITEM(ARG1)            \
+    PYPA_AST_MEMBER_NAMES_IMPL_END              \
     PYPA_AST_MEMBER_VISIT_IMPL_BEGIN(TYPE)      \
     do_apply(t, &Type::ARG0, f);                \
     do_apply(t, &Type::ARG1, f);                \
@@ -161,6 +188,11 @@
     PYPA_AST_MEMBER_DUMP_MEMBER_ITEM(ARG1)              \
     PYPA_AST_MEMBER_DUMP_MEMBER_ITEM(ARG2)              \
     PYPA_AST_MEMBER_DUMP_IMPL_END(TYPE)                 \
+    PYPA_AST_MEMBER_NAMES_IMPL_BEGIN(TYPE)              \
+    PYPA_AST_MEMBER_NAMES_ITEM(ARG0)                    \
+    PYPA_AST_MEMBER_NAMES_ITEM(ARG1)                    \
+    PYPA_AST_MEMBER_NAMES_ITEM(ARG2)                    \
+    PYPA_AST_MEMBER_NAMES_IMPL_END                      \
     PYPA_AST_MEMBER_VISIT_IMPL_BEGIN(TYPE)              \
     do_apply(t, &Type::ARG0, f);                        \
     do_apply(t, &Type::ARG1, f);                        \
@@ -175,6 +207,12 @@
     PYPA_AST_MEMBER_DUMP_MEMBER_ITEM(ARG2)                  \
     PYPA_AST_MEMBER_DUMP_MEMBER_ITEM(ARG3)                  \
     PYPA_AST_MEMBER_DUMP_IMPL_END(TYPE)                     \
+    PYPA_AST_MEMBER_NAMES_IMPL_BEGIN(TYPE)                  \
+    PYPA_AST_MEMBER_NAMES_ITEM(ARG0)                        \
+    PYPA_AST_MEMBER_NAMES_ITEM(ARG1)                        \
+    PYPA_AST_MEMBER_NAMES_ITEM(ARG2)                        \
+    PYPA_AST_MEMBER_NAMES_ITEM(ARG3)                        \
+    PYPA_AST_MEMBER_NAMES_IMPL_END                          \
     PYPA_AST_MEMBER_VISIT_IMPL_BEGIN(TYPE)                  \
     do_apply(t, &Type::ARG0, f);                            \
     do_apply(t, &Type::ARG1, f);                            \
@@ -191,6 +229,13 @@
     PYPA_AST_MEMBER_DUMP_MEMBER_ITEM(ARG3)                      \
     PYPA_AST_MEMBER_DUMP_MEMBER_ITEM(ARG4)                      \
     PYPA_AST_MEMBER_DUMP_IMPL_END(TYPE)                         \
+    PYPA_AST_MEMBER_NAMES_IMPL_BEGIN(TYPE)                      \
+    PYPA_AST_MEMBER_NAMES_ITEM(ARG0)                            \
+    PYPA_AST_MEMBER_NAMES_ITEM(ARG1)                            \
+    PYPA_AST_MEMBER_NAMES_ITEM(ARG2)                            \
+    PYPA_AST_MEMBER_NAMES_ITEM(ARG3)                            \
+    PYPA_AST_MEMBER_NAMES_ITEM(ARG4)                            \
+    PYPA_AST_MEMBER_NAMES_IMPL_END                              \
     PYPA_AST_MEMBER_VISIT_IMPL_BEGIN(TYPE)                      \
     do_apply(t, &Type::ARG0, f);                                \
     do_apply(t, &Type::ARG1, f);                                \
@@ -199,5 +244,60 @@
     do_apply(t, &Type::ARG4, f);                                \
     PYPA_AST_MEMBER_VISIT_IMPL_END
 
+#define PYPA_AST_MEMBERS6(TYPE, ARG0, ARG1, ARG2, ARG3, ARG4, ARG5)   \
+    PYPA_AST_MEMBER_DUMP_IMPL_BEGIN(TYPE)                             \
+    PYPA_AST_MEMBER_DUMP_MEMBER_ITEM(ARG0)                            \
+    PYPA_AST_MEMBER_DUMP_MEMBER_ITEM(ARG1)                            \
+    PYPA_AST_MEMBER_DUMP_MEMBER_ITEM(ARG2)                            \
+    PYPA_AST_MEMBER_DUMP_MEMBER_ITEM(ARG3)                            \
+    PYPA_AST_MEMBER_DUMP_MEMBER_ITEM(ARG4)                            \
+    PYPA_AST_MEMBER_DUMP_MEMBER_ITEM(ARG5)                            \
+    PYPA_AST_MEMBER_DUMP_IMPL_END(TYPE)                               \
+    PYPA_AST_MEMBER_NAMES_IMPL_BEGIN(TYPE)                            \
+    PYPA_AST_MEMBER_NAMES_ITEM(ARG0)                                  \
+    PYPA_AST_MEMBER_NAMES_ITEM(ARG1)                                  \
+    PYPA_AST_MEMBER_NAMES_ITEM(ARG2)                                  \
+    PYPA_AST_MEMBER_NAMES_ITEM(ARG3)                                  \
+    PYPA_AST_MEMBER_NAMES_ITEM(ARG4)                                  \
+    PYPA_AST_MEMBER_NAMES_ITEM(ARG5)                                  \
+    PYPA_AST_MEMBER_NAMES_IMPL_END                                    \
+    PYPA_AST_MEMBER_VISIT_IMPL_BEGIN(TYPE)                            \
+    do_apply(t, &Type::ARG0, f);                                      \
+    do_apply(t, &Type::ARG1, f);                                      \
+    do_apply(t, &Type::ARG2, f);                                      \
+    do_apply(t, &Type::ARG3, f);                                      \
+    do_apply(t, &Type::ARG4, f);                                      \
+    do_apply(t, &Type::ARG5, f);                                      \
+    PYPA_AST_MEMBER_VISIT_IMPL_END
+
+#define PYPA_AST_MEMBERS7(TYPE, ARG0, ARG1, ARG2, ARG3, ARG4, ARG5, ARG6)   \
+    PYPA_AST_MEMBER_DUMP_IMPL_BEGIN(TYPE)                                   \
+    PYPA_AST_MEMBER_DUMP_MEMBER_ITEM(ARG0)                                  \
+    PYPA_AST_MEMBER_DUMP_MEMBER_ITEM(ARG1)                                  \
+    PYPA_AST_MEMBER_DUMP_MEMBER_ITEM(ARG2)                                  \
+    PYPA_AST_MEMBER_DUMP_MEMBER_ITEM(ARG3)                                  \
+    PYPA_AST_MEMBER_DUMP_MEMBER_ITEM(ARG4)                                  \
+    PYPA_AST_MEMBER_DUMP_MEMBER_ITEM(ARG5)                                  \
+    PYPA_AST_MEMBER_DUMP_MEMBER_ITEM(ARG6)                                  \
+    PYPA_AST_MEMBER_DUMP_IMPL_END(TYPE)                                     \
+    PYPA_AST_MEMBER_NAMES_IMPL_BEGIN(TYPE)                                  \
+    PYPA_AST_MEMBER_NAMES_ITEM(ARG0)                                        \
+    PYPA_AST_MEMBER_NAMES_ITEM(ARG1)                                        \
+    PYPA_AST_MEMBER_NAMES_ITEM(ARG2)                                        \
+    PYPA_AST_MEMBER_NAMES_ITEM(ARG3)                                        \
+    PYPA_AST_MEMBER_NAMES_ITEM(ARG4)                                        \
+    PYPA_AST_MEMBER_NAMES_ITEM(ARG5)                                        \
+    PYPA_AST_MEMBER_NAMES_ITEM(ARG6)                                        \
+    PYPA_AST_MEMBER_NAMES_IMPL_END                                          \
+    PYPA_AST_MEMBER_VISIT_IMPL_BEGIN(TYPE)                                  \
+    do_apply(t, &Type::ARG0, f);                                            \
+    do_apply(t, &Type::ARG1, f);                                            \
+    do_apply(t, &Type::ARG2, f);                                            \
+    do_apply(t, &Type::ARG3, f);                                            \
+    do_apply(t, &Type::ARG4, f);                                            \
+    do_apply(t, &Type::ARG5, f);                                            \
+    do_apply(t, &Type::ARG6, f);                                            \
+    PYPA_AST_MEMBER_VISIT_IMPL_END
+
 
 #endif //GUARD_PYPA_AST_MACROS_HH_INCLUDED
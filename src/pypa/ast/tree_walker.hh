@@ -23,31 +23,51 @@ template< typename AstT, typename F >
 void walk_tree(AstT & t, F f, int depth = 0);
 
 namespace detail {
+    // Nodes are passed on by reference, so the visitor sees the nodes of the
+    // tree and not copies. A subtree held by a pointer is walked once,
+    // through the node it points to.
     template< typename F >
     struct tree_walk_visitor {
         struct each {
             F * f_;
             int depth_;
-            each(F * f, int depth) : f_(f), depth_(depth) {}
+            // ast_member_visit::apply() passes the node itself first, its
+            // members are walked by apply()
+            bool self_;
+            each(F * f, int depth) : f_(f), depth_(depth), self_(true) {}
 
-            void next(Ast & t) {
-                visit(detail::tree_walk_visitor<F>(f_, depth_ + 1), t);
+            // Nodes held by value, e.g. AstCall::arglist
+            template< typename T >
+            typename std::enable_if<std::is_base_of<Ast, T>::value>::type
+            next(T & t) {
+                visit(detail::tree_walk_visitor<F>(f_, depth_ + 1), static_cast<Ast &>(t));
             }
 
             template< typename T >
-            void next(std::shared_ptr<T> t) {
+            void next(AstPtrT<T> & t) {
                 if(t) visit(detail::tree_walk_visitor<F>(f_, depth_ + 1), *t);
             }
 
             template< typename T >
-            void next(T) {}
+            typename std::enable_if<!std::is_base_of<Ast, T>::value>::type
+            next(T &) {}
 
             template< typename T >
-            bool operator() (T t) {
-                if((*f_)(t)) {
+            bool operator() (T & t) {
+                if(!self_ && std::is_base_of<Ast, T>::value) {
+                    // A node held by value is passed to f_ when it's walked
                     next(t);
                     return true;
                 }
+                if((*f_)(t)) {
+                    if(self_) {
+                        self_ = false;
+                    }
+                    else {
+                        next(t);
+                    }
+                    return true;
+                }
                 return false;
             }
 
@@ -62,10 +82,16 @@ namespace detail {
         F * f_;
         int depth_;
         tree_walk_visitor(F * f, int depth) : f_(f), depth_(depth){}
+
         template< typename T >
-        void operator() (T  t) {
+        void operator() (T & t) {
             ast_member_visit<AstIDByType<T>::Id>::apply(t, each(f_, depth_ + 1));
         }
+
+        template< typename T >
+        void operator() (AstPtrT<T> t) {
+            if(t) (*this)(*t);
+        }
     };
 }
 
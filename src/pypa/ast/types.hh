@@ -15,6 +15,7 @@
 #define GUARD_PYPA_AST_TYPES_HH_INCLUDED
 
 #include <pypa/types.hh>
+#include <pypa/ast/arena.hh>
 
 #include <string>
 #include <memory>
@@ -175,19 +176,24 @@ namespace pypa {
     struct AstIDByType;
 
     template<typename T>
-    struct AstIDByType< std::shared_ptr<T> > : AstIDByType<T>  {};
+    struct AstIDByType< AstPtrT<T> > : AstIDByType<T>  {};
 
     template<typename T>
     struct AstIDByType< T const > : AstIDByType<T> {};
 
     template<AstType TypeID>
     struct AstTypePtrByID {
-        typedef std::shared_ptr<typename AstTypeByID<TypeID>::Type> Type;
+        typedef AstPtrT<typename AstTypeByID<TypeID>::Type> Type;
     };
 
     template<AstType>
     struct ast_member_visit;
 
+    // get() returns the member names in the order of ast_member_visit,
+    // terminated by a null pointer
+    template<AstType>
+    struct ast_member_names;
+
 }
 
 #endif // GUARD_PYPA_AST_TYPES_HH_INCLUDED
@@ -25,7 +25,7 @@ inline void visit(F visitor, AstPtr v) {
     if(!v) return;
     switch(v->type) {
 #undef PYPA_AST_TYPE
-#define PYPA_AST_TYPE(X) case AstType::X: visitor(std::static_pointer_cast<typename AstTypeByID<AstType::X>::Type>(v)); break;
+#define PYPA_AST_TYPE(X) case AstType::X: visitor(ast_cast<typename AstTypeByID<AstType::X>::Type>(v)); break;
 #   include <pypa/ast/ast_type.inl>
 #undef PYPA_AST_TYPE
         default:
@@ -39,7 +39,7 @@ inline R visit(F visitor, AstPtr v) {
     if(!v) { assert("Visit called with null pointer" && false); return R(); }
     switch(v->type) {
 #undef PYPA_AST_TYPE
-#define PYPA_AST_TYPE(X) case AstType::X: return visitor(std::static_pointer_cast<typename AstTypeByID<AstType::X>::Type>(v));
+#define PYPA_AST_TYPE(X) case AstType::X: return visitor(ast_cast<typename AstTypeByID<AstType::X>::Type>(v));
 #   include <pypa/ast/ast_type.inl>
 #undef PYPA_AST_TYPE
         default:
@@ -0,0 +1,121 @@
+// Copyright 2014 Vinzenz Feenstra
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include <cstring>
+
+#include <pypa/buffer_reader.hh>
+
+namespace pypa {
+
+    BufferReader::BufferReader(char const * data, std::size_t length, std::string name)
+    : BufferReader(std::move(name))
+    {
+        set_buffer(data, data + length);
+    }
+
+    BufferReader::BufferReader(std::string name)
+    : name_(std::move(name))
+    , begin_(0)
+    , end_(0)
+    , position_(0)
+    , line_(1)
+    , eof_(true)
+    , line_starts_()
+    , indexed_(0)
+    {}
+
+    void BufferReader::set_buffer(char const * begin, char const * end) {
+        begin_ = begin;
+        end_ = end;
+        position_ = begin_;
+        line_ = 1;
+        line_starts_.assign(1, 0);
+        indexed_ = 0;
+        if(end_ - begin_ >= 3) {
+            if(begin_[0] == '\xEF' && begin_[1] == '\xBB' && begin_[2] == '\xBF') {
+                position_ += 3;
+            }
+        }
+        eof_ = begin_ == end_;
+    }
+
+    bool BufferReader::next_line_view(char const *& line, std::size_t & length) {
+        line = position_;
+        length = 0;
+        if(position_ == end_) {
+            eof_ = true;
+            return false;
+        }
+        char const * p = position_;
+        while(p != end_ && *p != '\n' && *p != '\x0c') {
+            ++p;
+        }
+        if(p != end_) {
+            ++p;
+            ++line_;
+        }
+        else {
+            eof_ = true;
+        }
+        length = std::size_t(p - position_);
+        position_ = p;
+        return true;
+    }
+
+    std::string BufferReader::next_line() {
+        char const * line = 0;
+        std::size_t length = 0;
+        next_line_view(line, length);
+        return std::string(line, length);
+    }
+
+    bool BufferReader::index_next_line() {
+        std::size_t size = std::size_t(end_ - begin_);
+        if(indexed_ == size) {
+            return false;
+        }
+        void const * nl = std::memchr(begin_ + indexed_, '\n', size - indexed_);
+        if(!nl) {
+            indexed_ = size;
+            return false;
+        }
+        indexed_ = std::size_t(static_cast<char const *>(nl) + 1 - begin_);
+        line_starts_.push_back(indexed_);
+        return true;
+    }
+
+    std::string BufferReader::get_line(size_t idx) {
+        // Same line numbering as FileBufReader::get_line
+        idx = idx ? idx - 1 : idx;
+        if(idx == 0) {
+            return std::string();
+        }
+        while(line_starts_.size() < idx && index_next_line()) {
+        }
+        if(line_starts_.size() < idx) {
+            return std::string();
+        }
+        char const * line = begin_ + line_starts_[idx - 1];
+        if(line == end_) {
+            return std::string();
+        }
+        void const * nl = std::memchr(line, '\n', std::size_t(end_ - line));
+        return std::string(line, nl ? static_cast<char const *>(nl) : end_);
+    }
+
+    bool BufferReader::get_source(char const *& data, std::size_t & length) const {
+        data = begin_;
+        length = std::size_t(end_ - begin_);
+        return begin_ != 0;
+    }
+}
@@ -0,0 +1,65 @@
+// Copyright 2014 Vinzenz Feenstra
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#ifndef GUARD_PYPA_BUFFER_READER_HH_INCLUDED
+#define GUARD_PYPA_BUFFER_READER_HH_INCLUDED
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include <pypa/reader.hh>
+
+namespace pypa {
+
+// Reads the source from a caller owned buffer, which has to stay alive and
+// unchanged as long as the reader (and the Lexer using it) is in use. Lines
+// are handed out as views into the buffer, nothing is copied.
+class BufferReader : public Reader {
+public:
+    BufferReader(char const * data, std::size_t length, std::string name);
+    ~BufferReader() override {}
+
+    bool set_encoding(const std::string & coding) override { return true; }
+    std::string next_line() override;
+    bool next_line_view(char const *& line, std::size_t & length) override;
+    std::string get_line(size_t idx) override;
+    unsigned get_line_number() const override { return line_; }
+    std::string get_filename() const override { return name_; }
+    bool eof() const override { return eof_; }
+    bool get_source(char const *& data, std::size_t & length) const override;
+
+protected:
+    // For readers loading the source themselves
+    explicit BufferReader(std::string name);
+    void set_buffer(char const * begin, char const * end);
+
+private:
+    bool index_next_line();
+
+private:
+    std::string name_;
+    char const * begin_;
+    char const * end_;
+    char const * position_;
+    unsigned line_;
+    bool eof_;
+    // Offsets of the lines as get_line() counts them (split at '\n' only),
+    // built on demand by get_line() only, so reading keeps no per line state
+    std::vector<std::size_t> line_starts_;
+    std::size_t indexed_;
+};
+
+}
+
+#endif //GUARD_PYPA_BUFFER_READER_HH_INCLUDED
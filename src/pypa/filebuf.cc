@@ -12,7 +12,6 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 #include <pypa/filebuf.hh>
-#include <fstream>
 
 #if defined(WIN32)
 #include <windows.h>
@@ -111,20 +110,18 @@ namespace pypa {
 
 
     FileBufReader::FileBufReader(const std::string & file_name)
-    : file_name_(file_name), buf_(file_name.c_str())
+    : file_name_(file_name), buf_(file_name.c_str()), text_(), line_starts_(1, 0)
     {
     }
 
     std::string FileBufReader::get_line(size_t idx) {
         idx = idx ? idx - 1 : idx;
-        std::ifstream ifs(get_filename());
-        std::string line;
-        size_t lineno = 1;
-        while(std::getline(ifs, line) && lineno != idx) {
-            ++lineno;
+        if(idx == 0 || idx > line_starts_.size()) {
+            return std::string();
         }
-        return line;
-
+        std::size_t begin = line_starts_[idx - 1];
+        std::size_t end = idx < line_starts_.size() ? line_starts_[idx] - 1 : text_.size();
+        return text_.substr(begin, end - begin);
     }
 
     std::string FileBufReader::next_line() {
@@ -136,6 +133,10 @@ namespace pypa {
                 break;
             line.push_back(c);
         } while(c != '\n' && c != '\x0c');
+        text_ += line;
+        if(!line.empty() && line.back() == '\n') {
+            line_starts_.push_back(text_.size());
+        }
         return line;
     }
 
@@ -16,6 +16,7 @@
 
 #include <cstddef>
 #include <string>
+#include <vector>
 
 #include <pypa/reader.hh>
 
@@ -66,6 +67,10 @@ public:
 private:
     std::string file_name_;
     FileBuf buf_;
+    // Everything read so far and the offsets of the lines in it, split at
+    // '\n' only, for get_line()
+    std::string text_;
+    std::vector<std::size_t> line_starts_;
 };
 
 }
@@ -0,0 +1,117 @@
+// Copyright 2014 Vinzenz Feenstra
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include <stdio.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include <pypa/lexer/lexer.hh>
+#include <pypa/lexer/keyword.hh>
+
+// Microbenchmark for the lexer
+//
+//   lexer-bench            - keyword lookup on a generated identifier mix
+//   lexer-bench files...   - additionally lexes the given files
+
+namespace {
+    typedef std::chrono::steady_clock Clock;
+
+    double elapsed_ms(Clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    // The lookup Lexer::next() used before the keyword table
+    pypa::TokenDef const * linear_find_keyword(std::string const & value) {
+        for (auto const & kw : pypa::Keywords()) {
+            if (kw.value().size() == value.size()) {
+                if (kw.value().c_str() == value) {
+                    return &kw;
+                }
+            }
+        }
+        return 0;
+    }
+
+    std::vector<std::string> make_identifiers(std::size_t count) {
+        static char const * const names[] = {
+            "self", "x", "i", "name", "value", "result", "data", "os", "path",
+            "len", "isinstance", "append", "items", "key", "args", "kwargs",
+            "None", "True", "False", "obj", "cls", "_", "__init__", "line",
+            "index", "fromkeys", "iterable", "define", "classify", "ifdef",
+            "returned", "w", "ws", "e", "f", "node", "tok", "lst", "walker"
+        };
+        std::vector<std::string> result;
+        result.reserve(count);
+        uint32_t seed = 42;
+        for (std::size_t i = 0; i < count; ++i) {
+            seed = seed * 1103515245 + 12345;
+            // Roughly every fourth identifier in python code is a keyword
+            if ((seed >> 16) % 4 == 0) {
+                auto kw = pypa::Keywords();
+                result.push_back(kw.data()[(seed >> 8) % kw.size()].value().c_str());
+            }
+            else {
+                result.push_back(names[(seed >> 8) % (sizeof(names) / sizeof(names[0]))]);
+            }
+        }
+        return result;
+    }
+
+    template< typename Fun >
+    double run_lookup(std::vector<std::string> const & ids, int rounds, std::size_t & found, Fun fun) {
+        found = 0;
+        auto start = Clock::now();
+        for (int r = 0; r < rounds; ++r) {
+            for (auto const & id : ids) {
+                found += fun(id) != 0;
+            }
+        }
+        return elapsed_ms(start);
+    }
+}
+
+int main(int argc, char const ** argv) {
+    std::vector<std::string> ids = make_identifiers(1000000);
+    int const rounds = 20;
+    std::size_t linear_found = 0, table_found = 0;
+
+    double linear = run_lookup(ids, rounds, linear_found, [](std::string const & s) {
+        return linear_find_keyword(s);
+    });
+    double table = run_lookup(ids, rounds, table_found, [](std::string const & s) {
+        return pypa::find_keyword(s.data(), s.size());
+    });
+    if (linear_found != table_found) {
+        fprintf(stderr, "Keyword lookup mismatch: %zu != %zu\n", linear_found, table_found);
+        return 1;
+    }
+
+    double lookups = double(ids.size()) * rounds;
+    printf("keyword lookup (%.0f identifiers, %zu keywords)\n", lookups, table_found);
+    printf("  linear scan: %8.2f ms  %6.2f ns/lookup\n", linear, linear * 1e6 / lookups);
+    printf("  table:       %8.2f ms  %6.2f ns/lookup\n", table, table * 1e6 / lookups);
+    printf("  speedup:     %8.2fx\n", linear / table);
+
+    for (int i = 1; i < argc; ++i) {
+        std::size_t tokens = 0;
+        auto start = Clock::now();
+        pypa::Lexer lexer(argv[i]);
+        while (lexer.next().ident.id() != pypa::Token::End) {
+            ++tokens;
+        }
+        double ms = elapsed_ms(start);
+        printf("%s: %zu tokens in %.2f ms\n", argv[i], tokens, ms);
+    }
+    return 0;
+}
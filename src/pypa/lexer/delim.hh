@@ -19,7 +19,7 @@
 #include <stdexcept>
 
 namespace pypa {
-    TokenDef DelimTokens[] = {
+    static constexpr TokenDef DelimTokens[] = {
         TokenDef(Token::DelimBraceOpen, TokenString("{"), TokenKind::LeftBrace, TokenClass::Delimiter),
         TokenDef(Token::DelimBraceClose, TokenString("}"), TokenKind::RightBrace, TokenClass::Delimiter),
         TokenDef(Token::DelimComma, TokenString(","), TokenKind::Comma, TokenClass::Delimiter),
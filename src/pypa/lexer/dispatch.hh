@@ -0,0 +1,70 @@
+// Copyright 2014 Vinzenz Feenstra
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#ifndef GUARD_PYPA_TOKENIZER_DISPATCH_HH_INCLUDED
+#define GUARD_PYPA_TOKENIZER_DISPATCH_HH_INCLUDED
+
+#include <pypa/lexer/tokendef.hh>
+#include <pypa/lexer/delim.hh>
+#include <pypa/lexer/op.hh>
+#include <cstddef>
+#include <cstdint>
+
+namespace pypa {
+
+    // First byte dispatch for delimiters and operators, generated at compile
+    // time from DelimTokens and OpTokens.
+    // `delim` is the index into DelimTokens (-1 if none) and `ops` a bit mask
+    // of the OpTokens indexes starting with that byte. Testing the ops in
+    // ascending index order keeps the precedence of the OpTokens table.
+    struct CharDispatch {
+        signed char delim;
+        uint64_t ops;
+    };
+
+    namespace detail {
+        constexpr std::size_t DelimCount = sizeof(DelimTokens) / sizeof(DelimTokens[0]);
+        constexpr std::size_t OpCount = sizeof(OpTokens) / sizeof(OpTokens[0]);
+        static_assert(OpCount <= 64, "Operator masks are limited to 64 operators");
+
+        constexpr int delim_index(char c, std::size_t index = 0) {
+            return index == DelimCount ? -1
+                : DelimTokens[index].value()[0] == c ? int(index)
+                : delim_index(c, index + 1);
+        }
+
+        constexpr uint64_t op_mask(char c, std::size_t index = 0) {
+            return index == OpCount ? 0u
+                : ((OpTokens[index].value()[0] == c ? uint64_t(1) << index : 0u)
+                   | op_mask(c, index + 1));
+        }
+
+        struct DispatchTable {
+            CharDispatch entries[256];
+        };
+
+        template< std::size_t... I >
+        constexpr DispatchTable make_dispatch_table(IndexList<I...>) {
+            return {{ { static_cast<signed char>(delim_index(char(I))),
+                        op_mask(char(I)) }... }};
+        }
+
+        static constexpr DispatchTable Dispatch =
+            make_dispatch_table(MakeIndexList<256>::type());
+    }
+
+    inline CharDispatch const & char_dispatch(char c) {
+        return detail::Dispatch.entries[static_cast<unsigned char>(c)];
+    }
+}
+#endif // GUARD_PYPA_TOKENIZER_DISPATCH_HH_INCLUDED
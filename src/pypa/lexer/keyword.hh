@@ -16,10 +16,12 @@
 
 #include <pypa/lexer/tokens.hh>
 #include <pypa/lexer/tokendef.hh>
-
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
 
 namespace pypa {
-    static const TokenDef KeywordTokens[] = {
+    static constexpr TokenDef KeywordTokens[] = {
         TokenDef(Token::KeywordAnd, TokenString("and"), TokenKind::Name, TokenClass::Keyword),
         TokenDef(Token::KeywordAs, TokenString("as"), TokenKind::Name, TokenClass::Keyword),
         TokenDef(Token::KeywordAssert, TokenString("assert"), TokenKind::Name, TokenClass::Keyword),
@@ -60,5 +62,67 @@ namespace pypa {
     inline ConstArray<TokenDef const> Keywords() {
         return { KeywordTokens };
     }
+
+    // Compile time lookup table for keywords, indexed by the length and the
+    // first character of the identifier. Every entry is a bit mask of the
+    // indexes into KeywordTokens with that length and first character.
+    namespace detail {
+        enum {
+            KeywordMinLength = 2,
+            KeywordMaxLength = 8,
+            KeywordLetters   = 26,
+            KeywordTableSize = (KeywordMaxLength - KeywordMinLength + 1) * KeywordLetters
+        };
+
+        constexpr std::size_t KeywordCount = sizeof(KeywordTokens) / sizeof(KeywordTokens[0]);
+        static_assert(KeywordCount <= 32, "Keyword masks are limited to 32 keywords");
+
+        constexpr bool keyword_fits_table(std::size_t index = 0) {
+            return index == KeywordCount
+                || (KeywordTokens[index].value().size() >= std::size_t(KeywordMinLength)
+                    && KeywordTokens[index].value().size() <= std::size_t(KeywordMaxLength)
+                    && KeywordTokens[index].value()[0] >= 'a'
+                    && KeywordTokens[index].value()[0] <= 'z'
+                    && keyword_fits_table(index + 1));
+        }
+        static_assert(keyword_fits_table(), "Keyword outside of the lookup table range");
+
+        constexpr uint32_t keyword_mask(std::size_t length, char first, std::size_t index = 0) {
+            return index == KeywordCount ? 0u
+                : ((KeywordTokens[index].value().size() == length
+                    && KeywordTokens[index].value()[0] == first ? uint32_t(1) << index : 0u)
+                   | keyword_mask(length, first, index + 1));
+        }
+
+        struct KeywordTable {
+            uint32_t masks[KeywordTableSize];
+        };
+
+        template< std::size_t... I >
+        constexpr KeywordTable make_keyword_table(IndexList<I...>) {
+            return {{ keyword_mask(KeywordMinLength + I / KeywordLetters,
+                                   char('a' + I % KeywordLetters))... }};
+        }
+
+        static constexpr KeywordTable KeywordLookup =
+            make_keyword_table(MakeIndexList<KeywordTableSize>::type());
+    }
+
+    // Returns the keyword spelled by [str, str + length) or 0 if it isn't one
+    inline TokenDef const * find_keyword(char const * str, std::size_t length) {
+        if(length < std::size_t(detail::KeywordMinLength)
+           || length > std::size_t(detail::KeywordMaxLength)
+           || str[0] < 'a' || str[0] > 'z') {
+            return 0;
+        }
+        uint32_t mask = detail::KeywordLookup.masks[
+            (length - detail::KeywordMinLength) * detail::KeywordLetters + (str[0] - 'a')];
+        for(std::size_t index = 0; mask != 0; ++index, mask >>= 1) {
+            if((mask & 1) && std::memcmp(KeywordTokens[index].value().c_str() + 1, str + 1, length - 1) == 0) {
+                return &KeywordTokens[index];
+            }
+        }
+        return 0;
+    }
 }
 #endif // GUARD_PYPA_TOKENIZER_KEYWORD_HH_INCLUDED
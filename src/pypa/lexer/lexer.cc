@@ -11,15 +11,17 @@
 // WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
 // See the License for the specific language governing permissions and
 // limitations under the License.
+#include <algorithm>
 #include <stack>
 #include <cassert>
 #include <fstream>
 
 #include <pypa/lexer/lexer.hh>
-#include <pypa/lexer/op.hh>
 #include <pypa/lexer/keyword.hh>
-#include <pypa/lexer/delim.hh>
+#include <pypa/lexer/dispatch.hh>
 #include <pypa/filebuf.hh>
+#include <pypa/mmap_reader.hh>
+#include <pypa/buffer_reader.hh>
 
 namespace pypa {
     inline bool is_ident_char(char c, bool first = false) {
@@ -75,8 +77,24 @@ namespace pypa {
         return reader_->get_line(idx);
     }
 
-    Lexer::Lexer(char const * file_path)
-    : Lexer(std::unique_ptr<FileBufReader>(new FileBufReader(file_path)))
+    bool Lexer::get_source(char const *& data, std::size_t & length) const {
+        return reader_->get_source(data, length);
+    }
+
+    inline std::unique_ptr<Reader> make_file_reader(char const * file_path,
+                                                    FileReaderType type) {
+        if(type == FileReaderType::MemoryMapped) {
+            return std::unique_ptr<Reader>(new MMapReader(file_path));
+        }
+        return std::unique_ptr<Reader>(new FileBufReader(file_path));
+    }
+
+    Lexer::Lexer(char const * file_path, FileReaderType type)
+    : Lexer(make_file_reader(file_path, type))
+    {}
+
+    Lexer::Lexer(char const * data, std::size_t length, std::string name)
+    : Lexer(std::unique_ptr<Reader>(new BufferReader(data, length, std::move(name))))
     {}
 
     Lexer::Lexer(std::unique_ptr<Reader> reader)
@@ -88,11 +106,16 @@ namespace pypa {
     , indent_{0}
     , indent_stack_{0}
     , alt_indent_stack_{0}
-    , lex_buffer_{}
+    , buffer_{}
+    , position_{0}
+    , pushback_{}
     , info_{}
     , first_indet_char{0}
     , token_buffer_{}
     , ignore_altindent_errors_{true}
+    , text_{}
+    , strings_{}
+    , scan_{&scan_kernels()}
     {}
 
     Lexer::~Lexer(){}
@@ -114,17 +137,14 @@ namespace pypa {
             (reader_->eof() ? TokenKind::End : TokenKind::Error),
             TokenClass::Default},
             line(), column_, {} };
-        char c1 = next_char();
-        char c2 = next_char();
-        // Pushing c2 first, is on purpose, think of the order!
-        put_char(c2);
-        put_char(c1);
+        char c1 = peek(0);
+        char c2 = peek(1);
 
-        tok.value.clear();
+        text_.clear();
         char ctmp = 0;
         switch (c0) {
         case '"': case '\'':
-            return get_string(tok, c0);
+            return intern_value(get_string(tok, c0));
         case 'r': case 'b': case 'u':
         case 'R': case 'B': case 'U':
             ctmp = c1;
@@ -132,56 +152,56 @@ namespace pypa {
                 ctmp = c2;
             }
             if(ctmp == '\'' || ctmp == '"')
-                return get_string(tok, next_char(), c0);
+                return intern_value(get_string(tok, next_char(), c0));
         }
 
         if (is_ident_char(c0, true)) {
             char c = c0;
-            do {
-                tok.value.push_back(c);
-            } while (is_ident_char(c = next_char()));
+            text_.push_back(c);
+            std::size_t n = scan_run(scan_->ident);
+            text_.append(buffer_, position_ - n, n);
+            while (is_ident_char(c = next_char())) {
+                text_.push_back(c);
+            }
             put_char(c);
-            for (auto const & kw : Keywords()) {
-                if (kw.value().size() == tok.value.size()) {
-                    if (kw.value().c_str() == tok.value) {
-                        return make_token(tok, kw.ident());
-                    }
-                }
+            if (TokenDef const * kw = find_keyword(text_.data(), text_.size())) {
+                return make_token(tok, kw->ident());
             }
+            tok.value = strings_.intern(text_);
             return make_token(tok, Token::Identifier, TokenKind::Name);
         }
-        for(auto const & delim : Delims()) {
-            if(delim.value()[0] == c0) {
-                tok.value = delim.value().c_str();
-                bool abort = false;
-                switch(c0) {
-                case '[': case '{': case '(':
-                    ++level_;
-                    break;
-                case ']': case '}': case ')':
-                    --level_;
-                    break;
-                case '.': case '-': case '+':
-                    if(isdigit(c1)) {
-                        abort = true;
-                    }
-                    break;
+        CharDispatch const & dispatch = char_dispatch(c0);
+        if(dispatch.delim >= 0) {
+            bool abort = false;
+            switch(c0) {
+            case '[': case '{': case '(':
+                ++level_;
+                break;
+            case ']': case '}': case ')':
+                --level_;
+                break;
+            case '.': case '-': case '+':
+                if(isdigit(c1)) {
+                    abort = true;
                 }
-                if(abort) break;
-                return make_token(tok, delim.ident());
+                break;
+            }
+            if(!abort) {
+                return make_token(tok, DelimTokens[dispatch.delim].ident());
             }
         }
-        for(auto const & op : Ops()) {
-            if(op.match3(c0, c1, c2)) {
+        uint64_t ops = dispatch.ops;
+        for(std::size_t index = 0; ops != 0; ++index, ops >>= 1) {
+            TokenDef const & op = OpTokens[index];
+            if((ops & 1) && op.match3(c0, c1, c2)) {
                 if (op.value().size() > 1) next_char();
                 if(op.value().size() > 2) next_char();
-                tok.value = op.value().c_str();
                 return make_token(tok, op.ident());
             }
         }
 
         if (is_number(c0, c1, c2)) {
-            return get_number(tok, c0);
+            return intern_value(get_long_suffix(get_number(tok, c0)));
         }
 
         return tok;
@@ -195,27 +215,31 @@ namespace pypa {
         int quote_count = 0;
         int end_quote_count = 0;
         if(prefix) {
-            tok.value.push_back(prefix);
+            text_.push_back(prefix);
             if(first == 'b' || first == 'r') {
-                tok.value.push_back(first);
+                text_.push_back(first);
                 cur = first = next_char();
             }
         }
         while(cur == first && quote_count < 3) {
             ++quote_count;
-            tok.value.push_back(cur);
+            text_.push_back(cur);
             cur = next_char();
         }
         put_char(cur);
         if(quote_count != 2 && quote_count != 6) {
             while(end_quote_count != quote_count) {
+                if(std::size_t n = scan_run(scan_->string, first)) {
+                    text_.append(buffer_, position_ - n, n);
+                    end_quote_count = 0;
+                }
                 cur = next_char();
                 if(cur == -1 && reader_->eof()) {
                     return make_token(tok,
                             Token::UnterminatedStringError,
                             TokenKind::Error);
                 }
-                tok.value.push_back(cur);
+                text_.push_back(cur);
                 if(cur == first) {
                     ++end_quote_count;
                 }
@@ -233,9 +257,9 @@ namespace pypa {
                     if (cur == '\\') {
                         char c = next_char();
                         if (c == '\r')
-                            tok.value.push_back(next_char());
+                            text_.push_back(next_char());
                         else
-                            tok.value.push_back(c);
+                            text_.push_back(c);
                     }
                 }
             };
@@ -247,31 +271,31 @@ namespace pypa {
 
     TokenInfo Lexer::get_number_binary(TokenInfo & tok, char first) {
         do {
-            tok.value.push_back(first);
+            text_.push_back(first);
             first = next_char();
         } while (first == '0' || first == '1');
         put_char(first);
         tok.ident = {Token::NumberBinary, TokenKind::Number, TokenClass::Literal};
-        if (tok.value.size() <= 2) {
+        if (text_.size() <= 2) {
             tok.ident = {Token::Invalid, TokenKind::Error, TokenClass::Default};
-            add_error(tok);
+            add_error(intern_value(tok));
         }
-        tok.value.erase(0, 2);
+        text_.erase(0, 2);
         return tok;
     }
 
     TokenInfo Lexer::get_number_hex(TokenInfo & tok, char first) {
         do {
-            tok.value.push_back(first);
+            text_.push_back(first);
             first = next_char();
         } while (is_hex(first));
         put_char(first);
         tok.ident = {Token::NumberHex, TokenKind::Number, TokenClass::Literal};
-        if (tok.value.size() <= 2) {
+        if (text_.size() <= 2) {
             tok.ident = {Token::Invalid, TokenKind::Error, TokenClass::Default};
-            add_error(tok);
+            add_error(intern_value(tok));
         }
-        tok.value.erase(0, 2);
+        text_.erase(0, 2);
         return tok;
     }
 
@@ -281,17 +305,17 @@ namespace pypa {
             tok.ident = {Token::NumberInteger, TokenKind::Number, TokenClass::Literal};
             return tok;
         }
-        tok.value.push_back(first);
+        text_.push_back(first);
         first = next_char();
         while (first >= '0' && first < '8') {
-            tok.value.push_back(first);
+            text_.push_back(first);
             first = next_char();
         }
         bool non_oct = false;
         if (is_digit(first)) {
             non_oct = true;
             do {
-                tok.value.push_back(first);
+                text_.push_back(first);
             }
             while (is_digit(first = next_char()));
         }
@@ -305,11 +329,11 @@ namespace pypa {
         tok.ident = {Token::NumberOct, TokenKind::Number, TokenClass::Literal};
         if (non_oct) {
             tok.ident = {Token::Invalid, TokenKind::Error, TokenClass::Default};
-            add_error(tok);
+            add_error(intern_value(tok));
         }
-        if(tok.value.size() >= 2) {
-            if(tok.value[1] == 'o' || tok.value[1] == 'O') {
-                tok.value.erase(0, 2);
+        if(text_.size() >= 2) {
+            if(text_[1] == 'o' || text_[1] == 'O') {
+                text_.erase(0, 2);
             }
         }
         return tok;
@@ -319,11 +343,11 @@ namespace pypa {
         switch (first) {
         case '.':
             do {
-                tok.value.push_back(first);
+                text_.push_back(first);
             }
             while (is_digit(first = next_char()));
             if(first == 'j') {
-                tok.value.push_back(first);
+                text_.push_back(first);
                 tok.ident = {Token::NumberComplex, TokenKind::Number, TokenClass::Literal};
                 break;
             }
@@ -335,11 +359,11 @@ namespace pypa {
             // fallthrough
         case 'e': case 'E':
             tok.ident = {Token::NumberFloat, TokenKind::Number, TokenClass::Literal};
-            tok.value.push_back(first);
+            text_.push_back(first);
             first = next_char();
             if (is_digit(first) || first == '-' || first == '+') {
                 do {
-                    tok.value.push_back(first);
+                    text_.push_back(first);
                 } while (is_digit(first = next_char()));
                 if(first == 'j' || first == 'J') {
                     tok.ident = {Token::NumberComplex, TokenKind::Number, TokenClass::Literal};
@@ -356,9 +380,9 @@ namespace pypa {
     }
 
     TokenInfo Lexer::get_number_integer(TokenInfo & tok, char first) {
-        tok.value.push_back(first);
+        text_.push_back(first);
         while (is_digit(first = next_char())) {
-            tok.value.push_back(first);
+            text_.push_back(first);
         }
         if (first == '.' || first == 'e' || first == 'E') {
             return get_number_float(tok, first);
@@ -371,18 +395,40 @@ namespace pypa {
     }
 
     TokenInfo Lexer::get_number_complex(TokenInfo & tok, char first) {
-        tok.value.push_back(first);
+        text_.push_back(first);
         return make_token(tok, Token::NumberComplex, TokenKind::Number);
     }
 
+    // The `L` of Python 2 long integers (10L) stays the last character of
+    // the value of the integer token
+    TokenInfo Lexer::get_long_suffix(TokenInfo tok) {
+        switch (tok.ident.id()) {
+        case Token::NumberInteger:
+        case Token::NumberHex:
+        case Token::NumberOct:
+        case Token::NumberBinary:
+            break;
+        default:
+            return tok;
+        }
+        char c = next_char();
+        if (c == 'l' || c == 'L') {
+            text_.push_back(c);
+        }
+        else {
+            put_char(c);
+        }
+        return tok;
+    }
+
     TokenInfo Lexer::get_number(TokenInfo & tok, char first) {
-        tok.value.clear();
+        text_.clear();
         if(first == '-') {
-            tok.value.push_back(first);
+            text_.push_back(first);
             first = next_char();
         }
         if (first == '0') {
-            tok.value.push_back(first);
+            text_.push_back(first);
             char c1 = next_char();
             switch (c1) {
             case 'b': case 'B':
@@ -404,26 +450,87 @@ namespace pypa {
         return get_number_integer(tok, first);
     }
 
+    bool Lexer::read_line(bool append) {
+        char const * line = 0;
+        std::size_t length = 0;
+        reader_->next_line_view(line, length);
+        if (length == 0 && reader_->eof()) {
+            return false;
+        }
+        if (append) {
+            // Drop what has been consumed already, peek() would otherwise
+            // keep the whole source buffered when it always looks ahead
+            // past the end of the line. put_char() falls back to pushback_
+            buffer_.erase(0, position_);
+            position_ = 0;
+            buffer_.append(line, length);
+        }
+        else {
+            buffer_.assign(line, length);
+            position_ = 0;
+        }
+        return true;
+    }
+
     char Lexer::next_char() {
         column_++;
-        if (lex_buffer_.empty()) {
-            std::string line = reader_->next_line();
-            if (line.empty() && reader_->eof())
+        if (!pushback_.empty()) {
+            char c = pushback_.back();
+            pushback_.pop_back();
+            return c;
+        }
+        if (position_ == buffer_.size() && !read_line(false)) {
+            return -1;
+        }
+        return buffer_[position_++];
+    }
+
+    char Lexer::peek(std::size_t n) {
+        if (n < pushback_.size()) {
+            return pushback_[pushback_.size() - 1 - n];
+        }
+        n -= pushback_.size();
+        // Lines are only read when the requested character isn't buffered
+        // yet, this keeps the reader line numbers in sync with next_char()
+        while (position_ + n >= buffer_.size()) {
+            if (!read_line(true)) {
                 return -1;
-            lex_buffer_.insert(lex_buffer_.end(), line.begin(), line.end());
+            }
         }
-        char c = lex_buffer_.front();
-        lex_buffer_.pop_front();
-        return c;
+        return buffer_[position_ + n];
+    }
+
+    // Skips the run of characters recognized by `kernel` in buffer_ and
+    // returns its length. Stops at the end of the buffer and does nothing
+    // while characters were put back, the caller continues with next_char().
+    template< typename Kernel, typename... Args >
+    std::size_t Lexer::scan_run(Kernel kernel, Args... args) {
+        if (!pushback_.empty()) {
+            return 0;
+        }
+        std::size_t n = kernel(buffer_.data() + position_,
+                               buffer_.size() - position_, args...);
+        position_ += n;
+        column_ += n;
+        return n;
     }
 
     void Lexer::put_char(char c) {
         column_--;
-        lex_buffer_.push_front(c);
+        if (pushback_.empty() && position_ != 0 && buffer_[position_ - 1] == c) {
+            --position_;
+        }
+        else {
+            pushback_.push_back(c);
+        }
     }
 
     char Lexer::skip_comment() {
         char c = 0;
+        if(!reader_->eof()) {
+            // eof() can't change before the buffered line is consumed
+            scan_run(scan_->comment);
+        }
         do {
             c = next_char();
         } while(!reader_->eof() && c != '\n');
@@ -469,7 +576,7 @@ namespace pypa {
                          TokenClass::Default},
                         line(),
                         column_,
-                        "encoding problem: " + coding});
+                        strings_.intern("encoding problem: " + coding)});
                 }
                 read_encoding_ = true;
                 break;
@@ -534,7 +641,7 @@ namespace pypa {
                 if(c != '\n' && c != '\x0c') {
                     token_buffer_.push_back({
                             {Token::LineContinuationError, TokenKind::Error, TokenClass::Default},
-                            line(), column_, {"LineContinationError"}});
+                            line(), column_, {}});
                     return c;
                 }
                 // It should now continue with newline
@@ -543,8 +650,7 @@ namespace pypa {
             case '`':
                 token_buffer_.push_back({
                         {Token::BackQuote, TokenKind::BackQuote, TokenClass::Default},
-                        line(), column_,
-                        {"BackQuote"}});
+                        line(), column_, {}});
                 return next_char();
             case ' ':
             case '\t':
@@ -556,7 +662,8 @@ namespace pypa {
                         return next_char();
                     }
                 }
-                else {
+                else if(c == ' ' && first_indet_char == ' ') {
+                    scan_run(scan_->spaces);
                 }
                 break;
             case '\x0c': // Allow formfeed as \n
@@ -565,8 +672,7 @@ namespace pypa {
                 if(!continuation && level_ == 0) {
                     token_buffer_.push_back({
                             { Token::NewLine, TokenKind::NewLine, TokenClass::Default },
-                            line(), column_,
-                            {"NewLine"}});
+                            line(), column_, {}});
                 }
                 if(!handle_indentation(continuation)) {
                     return next_char();
@@ -600,6 +706,8 @@ namespace pypa {
         char c = 0;
         int changes = 0;
         for(;;) {
+            std::size_t n = scan_run(scan_->spaces);
+            col += int(n); alt_col += int(n);
             c = next_char();
             if(c == ' ') {
                 ++col; ++alt_col;
@@ -662,7 +770,7 @@ namespace pypa {
                           TokenClass::Default},
                           line(),
                           1,
-                          {changes < 0 ? "Dedent" : "Indent"}};
+                          {}};
         info.line = line();
         info.column = 1;
         while(changes != 0) {
@@ -679,7 +787,7 @@ namespace pypa {
              TokenClass::Default},
             line(),
             column_,
-            dedent ? "Dedentation Error" : "Indentation Error"});
+            {}});
         return false;
     }
 
@@ -688,15 +796,37 @@ namespace pypa {
         return tok;
     }
 
+    TokenInfo Lexer::intern_value(TokenInfo tok) {
+        tok.value = strings_.intern(text_);
+        return tok;
+    }
+
     TokenInfo Lexer::make_token(TokenInfo & tok, Token id, TokenKind kind, TokenClass cls) {
         return make_token(tok, { id, kind, cls });
     }
 
+    void Lexer::release_values(char const * oldest) {
+        // The chunk being filled is always kept
+        std::size_t keep = strings_.chunk_count() ? strings_.chunk_count() - 1 : 0;
+        keep = std::min(keep, strings_.chunk_of(oldest));
+        for(auto const & t : token_buffer_) {
+            if(!t.value.empty()) {
+                keep = std::min(keep, strings_.chunk_of(t.value.data()));
+            }
+        }
+        for(auto & i : info_) {
+            if(!i.info.value.empty() && strings_.chunk_of(i.info.value.data()) < keep) {
+                i.info.value = strings_.intern(i.info.value.data(), i.info.value.size());
+            }
+        }
+        strings_.release(keep);
+    }
+
     void Lexer::add_info_item(LexerInfoLevel level, TokenInfo const & t) {
         info_.push_back({t, level, {}});
     }
 
     TokenInfo Lexer::make_invalid(char const * begin, char const * end, Token id, TokenKind kind, TokenClass cls) {
-        return { {id, kind, cls},line(), column_, std::string(begin, end) };
+        return { {id, kind, cls},line(), column_, strings_.intern(begin, std::size_t(end - begin)) };
     }
 }
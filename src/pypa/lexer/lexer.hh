@@ -22,7 +22,10 @@
 #include <memory>
 
 #include <pypa/reader.hh>
+#include <pypa/types.hh>
 #include <pypa/lexer/tokendef.hh>
+#include <pypa/lexer/string_pool.hh>
+#include <pypa/lexer/scan.hh>
 
 namespace pypa {
 
@@ -30,7 +33,10 @@ struct TokenInfo {
     TokenIdent ident;
     uint64_t line;
     uint64_t column;
-    std::string value;
+    // Empty for tokens with a fixed spelling (keywords, operators, NewLine..)
+    // otherwise it refers to memory owned by the Lexer and stays valid as
+    // long as the Lexer is alive.
+    StringRef value;
 };
 
 enum class LexerInfoLevel {
@@ -45,6 +51,11 @@ struct LexerInfo {
     std::string value;
 };
 
+enum class FileReaderType {
+    Buffered,       // FileBufReader
+    MemoryMapped    // MMapReader
+};
+
 class Lexer {
     enum {
         TabSize = 8,
@@ -59,21 +70,36 @@ class Lexer {
     int indent_;
     std::vector<int> indent_stack_;
     std::vector<int> alt_indent_stack_;
-    std::deque<char> lex_buffer_;
+    // Current line(s) of the source, position_ is the read cursor.
+    // Characters put back which don't match the preceding character in
+    // buffer_ are kept on pushback_ (top = next character)
+    std::string buffer_;
+    std::size_t position_;
+    std::vector<char> pushback_;
 
     std::list<LexerInfo> info_;
     char first_indet_char;
     std::deque<TokenInfo> token_buffer_;
     bool ignore_altindent_errors_;
 
+    std::string text_;
+    StringPool strings_;
+    ScanKernels const * scan_;
+
 public:
-    Lexer(char const * file_path);
+    Lexer(char const * file_path,
+          FileReaderType type = FileReaderType::MemoryMapped);
     Lexer(std::unique_ptr<Reader> reader);
+    // Lexes the caller owned buffer `data`, which has to outlive the Lexer.
+    // `name` is reported as file name in errors.
+    Lexer(char const * data, std::size_t length, std::string name);
 
     ~Lexer();
 
     std::string get_name() const;
     std::string get_line(int idx);
+    // The whole source, if the reader keeps it in memory
+    bool get_source(char const *& data, std::size_t & length) const;
     std::string get_encoding() const {
         return encoding_;
     }
@@ -83,17 +109,32 @@ public:
         ignore_altindent_errors_ = ignore;
     }
 
+    // Selects the kernels used to skip identifier, whitespace, comment and
+    // string runs (default: best supported by the CPU)
+    void set_scan_impl(ScanImpl impl) {
+        scan_ = &scan_kernels(impl);
+    }
+
     std::list<LexerInfo> const & info();
 
     TokenInfo next();
 
+    // Frees the memory of token values returned before the one starting at
+    // `oldest`, which have to be unused by now. Values of tokens lexed
+    // ahead and of info() entries are kept.
+    void release_values(char const * oldest);
+
 private:
     char skip();
     char skip_comment();
     char skip_comment_check_coding();
     unsigned line() const { return reader_->get_line_number(); }
     char next_char();
+    char peek(std::size_t n = 0);
     void put_char(char c);
+    template< typename Kernel, typename... Args >
+    std::size_t scan_run(Kernel kernel, Args... args);
+    bool read_line(bool append);
     TokenInfo get_string(TokenInfo & tok, char first, char prefix=0);
     TokenInfo get_number(TokenInfo & tok, char first);
     TokenInfo get_number_binary(TokenInfo & tok, char first);
@@ -102,6 +143,7 @@ private:
     TokenInfo get_number_float(TokenInfo & tok, char first);
     TokenInfo get_number_integer(TokenInfo & tok, char first);
     TokenInfo get_number_complex(TokenInfo & tok, char first);
+    TokenInfo get_long_suffix(TokenInfo tok);
 
     bool handle_indentation(bool continuation = false);
     void handle_whitespace(char c);
@@ -109,6 +151,7 @@ private:
     TokenInfo make_token(TokenInfo & tok, Token id, TokenKind kind,
                          TokenClass cls = TokenClass::Default);
     TokenInfo make_token(TokenInfo & tok, TokenIdent ident);
+    TokenInfo intern_value(TokenInfo tok);
     TokenInfo make_invalid(char const * begin, char const * end,
                            Token id = Token::Invalid,
                            TokenKind kind = TokenKind::Error,
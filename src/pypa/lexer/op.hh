@@ -19,7 +19,7 @@
 #include <stdexcept>
 
 namespace pypa {
-    TokenDef OpTokens[] = {
+    static constexpr TokenDef OpTokens[] = {
         TokenDef(Token::OpAddAssign, TokenString("+="), TokenKind::PlusEqual, TokenClass::Operator),
         TokenDef(Token::OpSubAssign, TokenString("-="), TokenKind::MinusEqual, TokenClass::Operator),
         TokenDef(Token::OpMulAssign, TokenString("*="), TokenKind::StarEqual, TokenClass::Operator),
@@ -0,0 +1,259 @@
+// Copyright 2014 Vinzenz Feenstra
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include <pypa/lexer/scan.hh>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#   define PYPA_SCAN_X86 1
+#   include <immintrin.h>
+#endif
+
+namespace pypa {
+    namespace {
+        inline bool scalar_is_ident(unsigned char c) {
+            return (c >= 'a' && c <= 'z')
+                || (c >= 'A' && c <= 'Z')
+                || (c >= '0' && c <= '9')
+                || (c == '_');
+        }
+
+        inline bool scalar_is_string(unsigned char c, unsigned char quote) {
+            return c != quote && c != '\\' && c != '\n' && c != '\x0c'
+                && c != '\r' && c != 0xff;
+        }
+
+        std::size_t scalar_ident(char const * p, std::size_t n) {
+            std::size_t i = 0;
+            while (i < n && scalar_is_ident(p[i])) ++i;
+            return i;
+        }
+
+        std::size_t scalar_spaces(char const * p, std::size_t n) {
+            std::size_t i = 0;
+            while (i < n && p[i] == ' ') ++i;
+            return i;
+        }
+
+        std::size_t scalar_comment(char const * p, std::size_t n) {
+            std::size_t i = 0;
+            while (i < n && p[i] != '\n') ++i;
+            return i;
+        }
+
+        std::size_t scalar_string(char const * p, std::size_t n, char quote) {
+            std::size_t i = 0;
+            while (i < n && scalar_is_string(p[i], quote)) ++i;
+            return i;
+        }
+
+#if PYPA_SCAN_X86
+        // The vector kernels compute a mask of the bytes belonging to the
+        // run, the first clear bit is the end of it. Only whole vectors
+        // within [p, p + n) are loaded, the tail is left to the scalar code.
+
+#   define PYPA_SCAN_SSE2 __attribute__((target("sse2")))
+#   define PYPA_SCAN_AVX2 __attribute__((target("avx2")))
+
+        // x in [lo, hi] (unsigned)
+        PYPA_SCAN_SSE2
+        inline __m128i sse2_in_range(__m128i x, char lo, char hi) {
+            __m128i d = _mm_sub_epi8(x, _mm_set1_epi8(lo));
+            return _mm_cmpeq_epi8(_mm_min_epu8(d, _mm_set1_epi8(char(hi - lo))), d);
+        }
+
+        PYPA_SCAN_SSE2
+        inline __m128i sse2_load(char const * p) {
+            return _mm_loadu_si128(reinterpret_cast<__m128i const *>(p));
+        }
+
+        // Index of the first byte not in the run (set in `mask`) or 16
+        PYPA_SCAN_SSE2
+        inline unsigned sse2_run_end(__m128i mask) {
+            unsigned bits = unsigned(_mm_movemask_epi8(mask)) ^ 0xffffu;
+            return bits ? unsigned(__builtin_ctz(bits)) : 16;
+        }
+
+        PYPA_SCAN_SSE2
+        std::size_t sse2_ident(char const * p, std::size_t n) {
+            std::size_t i = 0;
+            for (; i + 16 <= n; i += 16) {
+                __m128i x = sse2_load(p + i);
+                __m128i alpha = sse2_in_range(_mm_or_si128(x, _mm_set1_epi8(0x20)), 'a', 'z');
+                __m128i digit = sse2_in_range(x, '0', '9');
+                __m128i under = _mm_cmpeq_epi8(x, _mm_set1_epi8('_'));
+                unsigned end = sse2_run_end(_mm_or_si128(_mm_or_si128(alpha, digit), under));
+                if (end != 16) return i + end;
+            }
+            return i + scalar_ident(p + i, n - i);
+        }
+
+        PYPA_SCAN_SSE2
+        std::size_t sse2_spaces(char const * p, std::size_t n) {
+            std::size_t i = 0;
+            for (; i + 16 <= n; i += 16) {
+                unsigned end = sse2_run_end(_mm_cmpeq_epi8(sse2_load(p + i), _mm_set1_epi8(' ')));
+                if (end != 16) return i + end;
+            }
+            return i + scalar_spaces(p + i, n - i);
+        }
+
+        PYPA_SCAN_SSE2
+        std::size_t sse2_comment(char const * p, std::size_t n) {
+            std::size_t i = 0;
+            for (; i + 16 <= n; i += 16) {
+                __m128i stop = _mm_cmpeq_epi8(sse2_load(p + i), _mm_set1_epi8('\n'));
+                unsigned end = sse2_run_end(_mm_andnot_si128(stop, _mm_set1_epi8(-1)));
+                if (end != 16) return i + end;
+            }
+            return i + scalar_comment(p + i, n - i);
+        }
+
+        PYPA_SCAN_SSE2
+        std::size_t sse2_string(char const * p, std::size_t n, char quote) {
+            std::size_t i = 0;
+            for (; i + 16 <= n; i += 16) {
+                __m128i x = sse2_load(p + i);
+                // '\n', '\x0c' and '\r' but not '\x0b'
+                __m128i eol = _mm_andnot_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8('\x0b')),
+                                               sse2_in_range(x, '\n', '\r'));
+                __m128i stop = _mm_or_si128(
+                    _mm_or_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8(quote)),
+                                 _mm_cmpeq_epi8(x, _mm_set1_epi8('\\'))),
+                    _mm_or_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8(char(0xff))), eol));
+                unsigned end = sse2_run_end(_mm_andnot_si128(stop, _mm_set1_epi8(-1)));
+                if (end != 16) return i + end;
+            }
+            return i + scalar_string(p + i, n - i, quote);
+        }
+
+        PYPA_SCAN_AVX2
+        inline __m256i avx2_in_range(__m256i x, char lo, char hi) {
+            __m256i d = _mm256_sub_epi8(x, _mm256_set1_epi8(lo));
+            return _mm256_cmpeq_epi8(_mm256_min_epu8(d, _mm256_set1_epi8(char(hi - lo))), d);
+        }
+
+        PYPA_SCAN_AVX2
+        inline __m256i avx2_load(char const * p) {
+            return _mm256_loadu_si256(reinterpret_cast<__m256i const *>(p));
+        }
+
+        PYPA_SCAN_AVX2
+        inline unsigned avx2_run_end(__m256i mask) {
+            unsigned bits = ~unsigned(_mm256_movemask_epi8(mask));
+            return bits ? unsigned(__builtin_ctz(bits)) : 32;
+        }
+
+        PYPA_SCAN_AVX2
+        std::size_t avx2_ident(char const * p, std::size_t n) {
+            std::size_t i = 0;
+            for (; i + 32 <= n; i += 32) {
+                __m256i x = avx2_load(p + i);
+                __m256i alpha = avx2_in_range(_mm256_or_si256(x, _mm256_set1_epi8(0x20)), 'a', 'z');
+                __m256i digit = avx2_in_range(x, '0', '9');
+                __m256i under = _mm256_cmpeq_epi8(x, _mm256_set1_epi8('_'));
+                unsigned end = avx2_run_end(_mm256_or_si256(_mm256_or_si256(alpha, digit), under));
+                if (end != 32) return i + end;
+            }
+            return i + sse2_ident(p + i, n - i);
+        }
+
+        PYPA_SCAN_AVX2
+        std::size_t avx2_spaces(char const * p, std::size_t n) {
+            std::size_t i = 0;
+            for (; i + 32 <= n; i += 32) {
+                unsigned end = avx2_run_end(_mm256_cmpeq_epi8(avx2_load(p + i), _mm256_set1_epi8(' ')));
+                if (end != 32) return i + end;
+            }
+            return i + sse2_spaces(p + i, n - i);
+        }
+
+        PYPA_SCAN_AVX2
+        std::size_t avx2_comment(char const * p, std::size_t n) {
+            std::size_t i = 0;
+            for (; i + 32 <= n; i += 32) {
+                __m256i stop = _mm256_cmpeq_epi8(avx2_load(p + i), _mm256_set1_epi8('\n'));
+                unsigned end = avx2_run_end(_mm256_andnot_si256(stop, _mm256_set1_epi8(-1)));
+                if (end != 32) return i + end;
+            }
+            return i + sse2_comment(p + i, n - i);
+        }
+
+        PYPA_SCAN_AVX2
+        std::size_t avx2_string(char const * p, std::size_t n, char quote) {
+            std::size_t i = 0;
+            for (; i + 32 <= n; i += 32) {
+                __m256i x = avx2_load(p + i);
+                __m256i eol = _mm256_andnot_si256(_mm256_cmpeq_epi8(x, _mm256_set1_epi8('\x0b')),
+                                                  avx2_in_range(x, '\n', '\r'));
+                __m256i stop = _mm256_or_si256(
+                    _mm256_or_si256(_mm256_cmpeq_epi8(x, _mm256_set1_epi8(quote)),
+                                    _mm256_cmpeq_epi8(x, _mm256_set1_epi8('\\'))),
+                    _mm256_or_si256(_mm256_cmpeq_epi8(x, _mm256_set1_epi8(char(0xff))), eol));
+                unsigned end = avx2_run_end(_mm256_andnot_si256(stop, _mm256_set1_epi8(-1)));
+                if (end != 32) return i + end;
+            }
+            return i + sse2_string(p + i, n - i, quote);
+        }
+
+        struct CpuFeatures {
+            bool sse2;
+            bool avx2;
+
+            CpuFeatures() {
+                __builtin_cpu_init();
+                sse2 = __builtin_cpu_supports("sse2");
+                avx2 = __builtin_cpu_supports("avx2");
+            }
+        };
+
+        bool cpu_supports(ScanImpl impl) {
+            // Detected once, the initialization of the local static is
+            // thread safe
+            static CpuFeatures const features;
+            switch (impl) {
+            case ScanImpl::AVX2:
+                return features.avx2;
+            case ScanImpl::SSE2:
+                return features.sse2;
+            default:
+                return true;
+            }
+        }
+#else
+        bool cpu_supports(ScanImpl impl) {
+            return impl == ScanImpl::Scalar;
+        }
+#endif
+
+        ScanKernels const Kernels[] = {
+            { ScanImpl::Scalar, scalar_ident, scalar_spaces, scalar_comment, scalar_string },
+#if PYPA_SCAN_X86
+            { ScanImpl::SSE2, sse2_ident, sse2_spaces, sse2_comment, sse2_string },
+            { ScanImpl::AVX2, avx2_ident, avx2_spaces, avx2_comment, avx2_string },
+#endif
+        };
+        std::size_t const KernelCount = sizeof(Kernels) / sizeof(Kernels[0]);
+    }
+
+    ScanKernels const & scan_kernels(ScanImpl impl) {
+        // Kernels is ordered from the simplest to the best implementation
+        std::size_t index = KernelCount;
+        while (--index != 0) {
+            if ((impl == ScanImpl::Best || Kernels[index].impl <= impl)
+                && cpu_supports(Kernels[index].impl)) {
+                break;
+            }
+        }
+        return Kernels[index];
+    }
+}
@@ -0,0 +1,47 @@
+// Copyright 2014 Vinzenz Feenstra
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#ifndef GUARD_PYPA_TOKENIZER_SCAN_HH_INCLUDED
+#define GUARD_PYPA_TOKENIZER_SCAN_HH_INCLUDED
+
+#include <cstddef>
+
+namespace pypa {
+
+    enum class ScanImpl {
+        Scalar,
+        SSE2,
+        AVX2,
+        Best        // Best implementation supported by the CPU
+    };
+
+    // Kernels used by the lexer to skip runs of bytes. Each of them returns
+    // the number of leading bytes in [p, p + n) belonging to the run.
+    struct ScanKernels {
+        ScanImpl impl;
+        // [A-Za-z0-9_]
+        std::size_t (*ident)(char const * p, std::size_t n);
+        // ' '
+        std::size_t (*spaces)(char const * p, std::size_t n);
+        // Everything but '\n'
+        std::size_t (*comment)(char const * p, std::size_t n);
+        // Everything but quote, '\\', '\n', '\x0c', '\r' and '\xff'
+        std::size_t (*string)(char const * p, std::size_t n, char quote);
+    };
+
+    // Returns the kernels for `impl`. If the CPU doesn't support `impl` the
+    // next best supported implementation is returned.
+    ScanKernels const & scan_kernels(ScanImpl impl = ScanImpl::Best);
+}
+
+#endif // GUARD_PYPA_TOKENIZER_SCAN_HH_INCLUDED
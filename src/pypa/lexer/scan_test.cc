@@ -0,0 +1,149 @@
+// Copyright 2014 Vinzenz Feenstra
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#include <pypa/lexer/lexer.hh>
+#include <pypa/lexer/scan.hh>
+
+// Differential test of the scan kernels against the scalar implementation
+//
+//   scan-test              - kernels on generated buffers
+//   scan-test files...     - additionally compares the token streams of the
+//                            given files lexed with each implementation
+
+namespace {
+    char const * const ImplNames[] = {"Scalar", "SSE2", "AVX2"};
+
+    std::vector<pypa::ScanKernels const *> implementations() {
+        std::vector<pypa::ScanKernels const *> result;
+        for (auto impl : {pypa::ScanImpl::Scalar, pypa::ScanImpl::SSE2, pypa::ScanImpl::AVX2}) {
+            pypa::ScanKernels const & k = pypa::scan_kernels(impl);
+            if (k.impl == impl) {
+                result.push_back(&k);
+            }
+        }
+        return result;
+    }
+
+    int check_kernels(pypa::ScanKernels const & scalar, pypa::ScanKernels const & k) {
+        // Mostly run characters with a few terminators, so runs cross the
+        // 16/32 byte boundaries
+        static char const alphabet[] = "abzAZ_09 '\"\\\n\r\x0b\x0c\xff#.";
+        std::string buffer;
+        uint32_t seed = 42;
+        int failures = 0;
+        for (int round = 0; round < 20000; ++round) {
+            seed = seed * 1103515245 + 12345;
+            std::size_t size = (seed >> 8) % 100;
+            char run = alphabet[(seed >> 16) % 3 == 0 ? 0 : 8];
+            buffer.assign(size, run);
+            for (std::size_t i = 0; i < size; ++i) {
+                seed = seed * 1103515245 + 12345;
+                if ((seed >> 16) % 24 == 0) {
+                    buffer[i] = alphabet[(seed >> 8) % (sizeof(alphabet) - 1)];
+                }
+            }
+            char const * p = buffer.data();
+            for (std::size_t offset = 0; offset <= size && offset < 4; ++offset) {
+                std::size_t n = size - offset;
+                bool ok = scalar.ident(p + offset, n) == k.ident(p + offset, n)
+                    && scalar.spaces(p + offset, n) == k.spaces(p + offset, n)
+                    && scalar.comment(p + offset, n) == k.comment(p + offset, n)
+                    && scalar.string(p + offset, n, '\'') == k.string(p + offset, n, '\'')
+                    && scalar.string(p + offset, n, '"') == k.string(p + offset, n, '"');
+                if (!ok) {
+                    ++failures;
+                }
+            }
+        }
+        if (failures) {
+            fprintf(stderr, "%s kernels: %d mismatches\n", ImplNames[int(k.impl)], failures);
+        }
+        return failures;
+    }
+
+    struct LexResult {
+        std::vector<pypa::TokenInfo> tokens;
+        std::vector<std::string> values;
+        std::vector<pypa::LexerInfo> info;
+    };
+
+    void lex(char const * file, pypa::ScanImpl impl, LexResult & result) {
+        pypa::Lexer lexer(file);
+        lexer.set_scan_impl(impl);
+        for (;;) {
+            pypa::TokenInfo t = lexer.next();
+            result.tokens.push_back(t);
+            result.values.push_back(std::string(t.value.data(), t.value.size()));
+            if (t.ident.id() == pypa::Token::End) break;
+        }
+        result.info.assign(lexer.info().begin(), lexer.info().end());
+    }
+
+    bool same_token(pypa::TokenInfo const & a, pypa::TokenInfo const & b) {
+        return a.ident.id() == b.ident.id()
+            && a.ident.kind() == b.ident.kind()
+            && a.line == b.line
+            && a.column == b.column;
+    }
+
+    int check_file(char const * file, pypa::ScanKernels const & k) {
+        LexResult expected, actual;
+        lex(file, pypa::ScanImpl::Scalar, expected);
+        lex(file, k.impl, actual);
+        for (std::size_t i = 0; i < expected.tokens.size(); ++i) {
+            if (i >= actual.tokens.size()
+                || !same_token(expected.tokens[i], actual.tokens[i])
+                || expected.values[i] != actual.values[i]) {
+                pypa::TokenInfo const & t = expected.tokens[i];
+                fprintf(stderr, "%s: %s token %zu differs (%d:%d '%s')\n", file,
+                        ImplNames[int(k.impl)], i, int(t.line), int(t.column),
+                        expected.values[i].c_str());
+                return 1;
+            }
+        }
+        if (expected.tokens.size() != actual.tokens.size()) {
+            fprintf(stderr, "%s: %s token count differs\n", file, ImplNames[int(k.impl)]);
+            return 1;
+        }
+        if (expected.info.size() != actual.info.size()) {
+            fprintf(stderr, "%s: %s lexer info differs\n", file, ImplNames[int(k.impl)]);
+            return 1;
+        }
+        for (std::size_t i = 0; i < expected.info.size(); ++i) {
+            if (!same_token(expected.info[i].info, actual.info[i].info)
+                || expected.info[i].level != actual.info[i].level) {
+                fprintf(stderr, "%s: %s lexer info %zu differs\n", file,
+                        ImplNames[int(k.impl)], i);
+                return 1;
+            }
+        }
+        return 0;
+    }
+}
+
+int main(int argc, char const ** argv) {
+    auto impls = implementations();
+    int failures = 0;
+    for (auto k : impls) {
+        printf("checking %s kernels\n", ImplNames[int(k->impl)]);
+        failures += check_kernels(*impls.front(), *k);
+        for (int i = 1; i < argc; ++i) {
+            failures += check_file(argv[i], *k);
+        }
+    }
+    return failures == 0 ? 0 : 1;
+}
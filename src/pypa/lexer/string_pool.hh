@@ -0,0 +1,110 @@
+// Copyright 2014 Vinzenz Feenstra
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#ifndef GUARD_PYPA_LEXER_STRING_POOL_HH_INCLUDED
+#define GUARD_PYPA_LEXER_STRING_POOL_HH_INCLUDED
+
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include <pypa/types.hh>
+
+namespace pypa {
+
+// Bump allocator for token texts. Strings stored in the pool never move,
+// the returned StringRef stays valid until the pool is destroyed or the
+// chunk holding it is released.
+class StringPool {
+    enum {
+        ChunkSize = 64 * 1024
+    };
+
+    struct Chunk {
+        std::unique_ptr<char[]> data;
+        std::size_t size;
+    };
+
+    std::vector<Chunk> chunks_;
+    char * pos_;
+    std::size_t left_;
+
+public:
+    StringPool()
+    : chunks_()
+    , pos_(0)
+    , left_(0)
+    {}
+
+    StringPool(StringPool const &) = delete;
+    StringPool & operator=(StringPool const &) = delete;
+
+    StringRef intern(char const * data, std::size_t size) {
+        if(size == 0) {
+            return StringRef();
+        }
+        if(size > left_) {
+            grow(size);
+        }
+        char * result = pos_;
+        std::memcpy(result, data, size);
+        pos_ += size;
+        left_ -= size;
+        return StringRef(result, size);
+    }
+
+    StringRef intern(String const & str) {
+        return intern(str.data(), str.size());
+    }
+
+    std::size_t chunk_count() const {
+        return chunks_.size();
+    }
+
+    // Index of the chunk holding `p`, chunk_count() if it isn't in the pool
+    std::size_t chunk_of(char const * p) const {
+        for(std::size_t i = 0; i < chunks_.size(); ++i) {
+            char const * begin = chunks_[i].data.get();
+            if(p >= begin && p < begin + chunks_[i].size) {
+                return i;
+            }
+        }
+        return chunks_.size();
+    }
+
+    // Frees the chunks before chunk `index`, the strings stored in them
+    // become invalid. Releasing all chunks starts a new one on the next
+    // intern().
+    void release(std::size_t index) {
+        if(index >= chunks_.size()) {
+            chunks_.clear();
+            pos_ = 0;
+            left_ = 0;
+            return;
+        }
+        chunks_.erase(chunks_.begin(), chunks_.begin() + index);
+    }
+
+private:
+    void grow(std::size_t size) {
+        std::size_t chunk_size = size > std::size_t(ChunkSize) ? size : std::size_t(ChunkSize);
+        chunks_.push_back({std::unique_ptr<char[]>(new char[chunk_size]), chunk_size});
+        pos_ = chunks_.back().data.get();
+        left_ = chunk_size;
+    }
+};
+
+}
+
+#endif // GUARD_PYPA_LEXER_STRING_POOL_HH_INCLUDED
@@ -0,0 +1,74 @@
+// Copyright 2014 Vinzenz Feenstra
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include <algorithm>
+
+#include <pypa/lexer/token_stream.hh>
+
+namespace pypa {
+    TokenStream::TokenStream(Lexer & lexer)
+    : lexer_(lexer)
+    , base_(0)
+    , first_(0)
+    , idents_()
+    , lines_()
+    , columns_()
+    , values_()
+    , complete_(false)
+    {}
+
+    void TokenStream::read_all() {
+        while(!complete_) {
+            read_next();
+        }
+    }
+
+    void TokenStream::discard(std::size_t index) {
+        if(size() == 0) {
+            return;
+        }
+        index = std::min(index, size() - 1);
+        if(index <= first_) {
+            return;
+        }
+        first_ = index;
+
+        // The lexer interns values in order, everything before the first
+        // value still in use can go
+        char const * oldest = 0;
+        for(std::size_t i = first_ - base_; i < values_.size() && !oldest; ++i) {
+            oldest = values_[i].empty() ? 0 : values_[i].data();
+        }
+        lexer_.release_values(oldest);
+
+        // Dropped tokens are erased once they are the majority, keeping the
+        // erasing linear in the number of tokens
+        std::size_t dropped = first_ - base_;
+        if(dropped >= idents_.size() - dropped) {
+            idents_.erase(idents_.begin(), idents_.begin() + dropped);
+            lines_.erase(lines_.begin(), lines_.begin() + dropped);
+            columns_.erase(columns_.begin(), columns_.begin() + dropped);
+            values_.erase(values_.begin(), values_.begin() + dropped);
+            base_ = first_;
+        }
+    }
+
+    void TokenStream::read_next() {
+        TokenInfo tok = lexer_.next();
+        idents_.push_back(tok.ident);
+        lines_.push_back(uint32_t(tok.line));
+        columns_.push_back(uint32_t(tok.column));
+        values_.push_back(tok.value);
+        complete_ = tok.ident.id() == Token::End;
+    }
+}
@@ -0,0 +1,112 @@
+// Copyright 2014 Vinzenz Feenstra
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#ifndef GUARD_PYPA_LEXER_TOKEN_STREAM_HH_INCLUDED
+#define GUARD_PYPA_LEXER_TOKEN_STREAM_HH_INCLUDED
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <pypa/lexer/lexer.hh>
+
+namespace pypa {
+
+// Tokens of a Lexer stored as parallel arrays and addressed by index.
+// Tokens are read from the lexer on demand, read_all() lexes the whole
+// module up front so the stream can be parsed (several times) without
+// touching the lexer again. The last token is always Token::End.
+// Token values refer to memory owned by the Lexer, which has to outlive
+// the stream. Indexes count from the start of the module, also after the
+// tokens before some index were dropped with discard().
+class TokenStream {
+    Lexer & lexer_;
+    std::size_t base_;      // Index of the first stored token
+    std::size_t first_;     // Index of the first token not discarded
+    std::vector<TokenIdent> idents_;
+    std::vector<uint32_t> lines_;
+    std::vector<uint32_t> columns_;
+    std::vector<StringRef> values_;
+    bool complete_;
+
+public:
+    explicit TokenStream(Lexer & lexer);
+
+    TokenStream(TokenStream const &) = delete;
+    TokenStream & operator=(TokenStream const &) = delete;
+
+    Lexer & lexer() const {
+        return lexer_;
+    }
+
+    // Lexes all remaining tokens
+    void read_all();
+
+    bool complete() const {
+        return complete_;
+    }
+
+    // Number of tokens read so far
+    std::size_t size() const {
+        return base_ + idents_.size();
+    }
+
+    // Drops the tokens before `index` (but never the last one read) and
+    // lets the lexer free their values. They must not be accessed anymore.
+    void discard(std::size_t index);
+
+    // Makes sure token `index` has been read, returns false if the stream
+    // ends before it
+    bool fetch(std::size_t index) {
+        while(index >= size()) {
+            if(complete_) {
+                return false;
+            }
+            read_next();
+        }
+        return true;
+    }
+
+    // Token `index`, reads from the lexer as needed. Past the end of the
+    // module this is the End token.
+    TokenInfo get(std::size_t index) {
+        if(!fetch(index)) {
+            index = size() - 1;
+        }
+        index -= base_;
+        return {idents_[index], lines_[index], columns_[index], values_[index]};
+    }
+
+    TokenIdent ident(std::size_t index) const {
+        return idents_[index - base_];
+    }
+
+    uint32_t line(std::size_t index) const {
+        return lines_[index - base_];
+    }
+
+    uint32_t column(std::size_t index) const {
+        return columns_[index - base_];
+    }
+
+    StringRef value(std::size_t index) const {
+        return values_[index - base_];
+    }
+
+private:
+    void read_next();
+};
+
+}
+
+#endif // GUARD_PYPA_LEXER_TOKEN_STREAM_HH_INCLUDED
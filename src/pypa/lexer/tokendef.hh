@@ -20,6 +20,20 @@
 
 namespace pypa {
 
+    namespace detail {
+        // Compile time 0..N-1 index pack, used to generate lookup tables
+        template< std::size_t... I >
+        struct IndexList {};
+
+        template< std::size_t N, std::size_t... I >
+        struct MakeIndexList : MakeIndexList<N - 1, N - 1, I...> {};
+
+        template< std::size_t... I >
+        struct MakeIndexList<0, I...> {
+            typedef IndexList<I...> type;
+        };
+    }
+
     template< typename ValueType, size_t InitSizeDiff = 0>
     class ConstArray {
     private:
@@ -27,20 +41,26 @@ namespace pypa {
             const std::size_t size_;
     public:
         template<std::size_t N>
-        ConstArray(ValueType(&data)[N])
+        constexpr ConstArray(ValueType(&data)[N])
         : data_(data)
         , size_(N-InitSizeDiff)
         {}
 
-        char operator[](std::size_t index) const {
-            return index < size_ ? data_[index] : throw std::out_of_range("");
+        // Unchecked like std::array, the lexer tables index with sizes
+        // checked beforehand
+        constexpr ValueType & operator[](std::size_t index) const {
+            return data_[index];
+        }
+
+        constexpr ValueType & at(std::size_t index) const {
+            return index < size_ ? data_[index] : throw std::out_of_range("ConstArray::at");
         }
 
-        std::size_t size() const {
+        constexpr std::size_t size() const {
             return size_;
         }
 
-        ValueType const * data() const {
+        constexpr ValueType const * data() const {
             return data_;
         }
 
@@ -61,11 +81,11 @@ namespace pypa {
     {
     public:
         template<std::size_t N>
-        TokenString(char const (&u)[N])
+        constexpr TokenString(char const (&u)[N])
         : ConstArray(u)
         {}
 
-        char const * c_str() const {
+        constexpr char const * c_str() const {
             return data();
         }
 
@@ -147,25 +167,25 @@ namespace pypa {
         TokenKind kind_;
         TokenClass cls_;
     public:
-        TokenIdent(Token id, TokenKind kind, TokenClass cls)
+        constexpr TokenIdent(Token id, TokenKind kind, TokenClass cls)
         : id_(id)
         , kind_(kind)
         , cls_(cls)
         {}
 
-        TokenIdent()
+        constexpr TokenIdent()
         : TokenIdent(Token::Invalid, TokenKind::Error, TokenClass::Default)
         {}
 
-        Token id() const {
+        constexpr Token id() const {
             return id_;
         }
 
-        TokenKind kind() const {
+        constexpr TokenKind kind() const {
             return kind_;
         }
 
-        TokenClass cls() const {
+        constexpr TokenClass cls() const {
             return cls_;
         }
     };
@@ -175,16 +195,16 @@ namespace pypa {
         TokenIdent ident_;
         TokenString value_;
     public:
-        TokenDef(Token id, TokenString value, TokenKind kind, TokenClass cls)
+        constexpr TokenDef(Token id, TokenString value, TokenKind kind, TokenClass cls)
         : ident_(id, kind, cls)
         , value_(value)
         {}
 
-        TokenIdent ident() const {
+        constexpr TokenIdent ident() const {
             return ident_;
         }
 
-        TokenString value() const {
+        constexpr TokenString value() const {
             return value_;
         }
 
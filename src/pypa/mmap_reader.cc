@@ -0,0 +1,135 @@
+// Copyright 2014 Vinzenz Feenstra
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include <pypa/mmap_reader.hh>
+
+#if defined(WIN32)
+#include <windows.h>
+#else
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#endif
+
+namespace pypa {
+
+    MMapReader::MMapReader(const std::string & file_name)
+    : BufferReader(file_name)
+    , data_(0)
+    , size_(0)
+    , mapped_(false)
+    , readable_(false)
+#if defined(WIN32)
+    , mapping_(0)
+#endif
+    , buffer_()
+    {
+#if defined(WIN32)
+        file_handle_t handle = ::CreateFileA(file_name.c_str(), GENERIC_READ, 0, 0, OPEN_EXISTING, 0, 0);
+        if(handle != INVALID_HANDLE_VALUE) {
+            readable_ = true;
+            if(!map_file(handle)) {
+                read_file(handle);
+            }
+            ::CloseHandle(handle);
+        }
+#else
+        file_handle_t handle = ::open(file_name.c_str(), O_RDONLY);
+        if(handle != -1) {
+            readable_ = true;
+            if(!map_file(handle)) {
+                read_file(handle);
+            }
+            ::close(handle);
+        }
+#endif
+        set_buffer(data_, data_ + size_);
+    }
+
+    MMapReader::~MMapReader() {
+        if(mapped_) {
+#if defined(WIN32)
+            ::UnmapViewOfFile(data_);
+            ::CloseHandle(mapping_);
+#else
+            ::munmap(const_cast<char *>(data_), size_);
+#endif
+        }
+    }
+
+    bool MMapReader::map_file(file_handle_t handle) {
+#if defined(WIN32)
+        LARGE_INTEGER size{};
+        if(::GetFileType(handle) != FILE_TYPE_DISK
+           || !::GetFileSizeEx(handle, &size)
+           || size.QuadPart == 0) {
+            return false;
+        }
+        mapping_ = ::CreateFileMappingA(handle, 0, PAGE_READONLY, 0, 0, 0);
+        if(!mapping_) {
+            return false;
+        }
+        void * p = ::MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0);
+        if(!p) {
+            ::CloseHandle(mapping_);
+            mapping_ = 0;
+            return false;
+        }
+        data_ = static_cast<char const *>(p);
+        size_ = std::size_t(size.QuadPart);
+#else
+        struct stat st{};
+        if(::fstat(handle, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size <= 0) {
+            return false;
+        }
+        void * p = ::mmap(0, std::size_t(st.st_size), PROT_READ, MAP_PRIVATE, handle, 0);
+        if(p == MAP_FAILED) {
+            return false;
+        }
+#if defined(MADV_SEQUENTIAL)
+        ::madvise(p, std::size_t(st.st_size), MADV_SEQUENTIAL);
+#endif
+        data_ = static_cast<char const *>(p);
+        size_ = std::size_t(st.st_size);
+#endif
+        mapped_ = true;
+        return true;
+    }
+
+    void MMapReader::read_file(file_handle_t handle) {
+        std::size_t length = 0;
+        for(;;) {
+            buffer_.resize(length + BufferSize);
+#if defined(WIN32)
+            DWORD n = 0;
+            if(!::ReadFile(handle, &buffer_[length], DWORD(BufferSize), &n, 0)) {
+                readable_ = false;
+                break;
+            }
+#else
+            ssize_t n = ::read(handle, &buffer_[length], BufferSize);
+#endif
+            if(n <= 0) {
+                // Reading a directory fails here
+                readable_ = readable_ && n == 0;
+                break;
+            }
+            length += std::size_t(n);
+        }
+        buffer_.resize(length);
+        data_ = buffer_.data();
+        size_ = length;
+    }
+}
@@ -0,0 +1,55 @@
+// Copyright 2014 Vinzenz Feenstra
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#ifndef GUARD_PYPA_MMAP_READER_HH_INCLUDED
+#define GUARD_PYPA_MMAP_READER_HH_INCLUDED
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include <pypa/buffer_reader.hh>
+#include <pypa/filebuf.hh>
+
+namespace pypa {
+
+// Maps the whole file into memory and hands out the lines as views into the
+// mapping. Pipes and other files which can't be mapped are read into a buffer
+// at once instead. A file which can't be opened or read is empty.
+class MMapReader : public BufferReader {
+    static const std::size_t BufferSize = 64 * 1024;
+public:
+    MMapReader(const std::string & file_name);
+    ~MMapReader() override;
+
+    bool mapped() const { return mapped_; }
+    bool readable() const { return readable_; }
+
+private:
+    bool map_file(file_handle_t handle);
+    void read_file(file_handle_t handle);
+
+private:
+    char const * data_;
+    std::size_t size_;
+    bool mapped_;
+    bool readable_;
+#if defined(WIN32)
+    void * mapping_;
+#endif
+    std::vector<char> buffer_;
+};
+
+}
+
+#endif //GUARD_PYPA_MMAP_READER_HH_INCLUDED
@@ -0,0 +1,241 @@
+// Copyright 2014 Vinzenz Feenstra
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+#include <pypa/parser/batch.hh>
+#include <pypa/mmap_reader.hh>
+#include <pypa/buffer_reader.hh>
+
+#if !defined(WIN32)
+#include <sys/types.h>
+#include <sys/stat.h>
+#endif
+
+namespace pypa {
+namespace {
+    std::size_t file_size(std::string const & path) {
+#if defined(WIN32)
+        struct _stat64 st{};
+        return ::_stat64(path.c_str(), &st) == 0 ? std::size_t(st.st_size) : 0;
+#else
+        struct stat st{};
+        return ::stat(path.c_str(), &st) == 0 ? std::size_t(st.st_size) : 0;
+#endif
+    }
+
+    // Source indexes assigned to one worker. The owner takes them from the
+    // front (largest first), other workers steal from the back.
+    class WorkQueue {
+        std::mutex mutex_;
+        std::deque<std::size_t> items_;
+    public:
+        void push(std::size_t index) {
+            items_.push_back(index);
+        }
+
+        bool pop(std::size_t & index) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if(items_.empty()) {
+                return false;
+            }
+            index = items_.front();
+            items_.pop_front();
+            return true;
+        }
+
+        bool steal(std::size_t & index) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if(items_.empty()) {
+                return false;
+            }
+            index = items_.back();
+            items_.pop_back();
+            return true;
+        }
+    };
+
+    struct Batch {
+        std::vector<ParseSource> & sources;
+        std::function<void(ParseResult &)> & on_result;
+        ParserOptions const & options;
+        std::vector<std::unique_ptr<WorkQueue>> queues;
+        std::mutex report_mutex;
+        // First exception thrown by on_result, the workers stop taking
+        // sources once it's set
+        std::exception_ptr failure;
+        std::atomic<bool> stop;
+    };
+
+    ParseResult parse_source(Batch & batch, std::size_t index) {
+        ParseSource & source = batch.sources[index];
+        ParseResult result;
+        result.index = index;
+        result.success = false;
+        result.arena.reset(new AstArena());
+        result.strings.reset(new StringPool());
+
+        // Set while options.error_handler runs, after it threw it isn't
+        // called again for this source
+        bool handler_threw = false;
+        auto report = [&batch, &result, &handler_threw](Error e) {
+            // The token value lives in the Lexer, which is gone after parsing
+            e.cur.value = result.strings->intern(e.cur.value.str());
+            result.errors.push_back(e);
+            if(batch.options.error_handler && !handler_threw) {
+                std::lock_guard<std::mutex> lock(batch.report_mutex);
+                handler_threw = true;
+                batch.options.error_handler(e);
+                handler_threw = false;
+            }
+        };
+        auto fail = [&result, &report](char const * message) {
+            result.success = false;
+            report({ErrorType::SystemError, message, result.name, {}, {}, "", -1, "", ""});
+        };
+
+        try {
+            std::unique_ptr<Reader> reader = std::move(source.reader);
+            if(!reader) {
+                MMapReader * file = new MMapReader(source.path);
+                reader.reset(file);
+                if(!file->readable()) {
+                    result.name = source.path;
+                    report({ErrorType::IOError, "can't read the file", source.path, {}, {}, "", -1, "", ""});
+                    return result;
+                }
+            }
+            Lexer lexer(std::move(reader));
+            result.name = lexer.get_name();
+
+            // The workers don't print, on_result and options.error_handler
+            // get the errors
+            ParserOptions options = batch.options;
+            options.arena = result.arena.get();
+            options.printerrors = false;
+            options.error_handler = report;
+            result.success = parse(lexer, result.ast, result.symbols, options);
+        }
+        catch(std::exception const & e) {
+            fail(e.what());
+        }
+        catch(...) {
+            fail("unknown exception");
+        }
+        return result;
+    }
+
+    void run_worker(Batch & batch, std::size_t self) {
+        std::size_t count = batch.queues.size();
+        std::size_t index = 0;
+        for(;;) {
+            // The queues are filled before the workers start, once all of
+            // them are empty there's nothing left to do
+            bool found = batch.queues[self]->pop(index);
+            for(std::size_t i = 1; !found && i < count; ++i) {
+                found = batch.queues[(self + i) % count]->steal(index);
+            }
+            if(!found || batch.stop) {
+                return;
+            }
+            ParseResult result = parse_source(batch, index);
+            std::lock_guard<std::mutex> lock(batch.report_mutex);
+            if(batch.stop) {
+                return;
+            }
+            try {
+                batch.on_result(result);
+            }
+            catch(...) {
+                batch.failure = std::current_exception();
+                batch.stop = true;
+                return;
+            }
+        }
+    }
+}
+
+ParseSource::ParseSource(std::string path)
+: path(std::move(path))
+, reader()
+, size(file_size(this->path))
+{}
+
+ParseSource::ParseSource(char const * data, std::size_t length, std::string name)
+: path()
+, reader(new BufferReader(data, length, std::move(name)))
+, size(length)
+{}
+
+ParseSource::ParseSource(std::unique_ptr<Reader> reader, std::size_t size)
+: path()
+, reader(std::move(reader))
+, size(size)
+{}
+
+void parse_many(std::vector<ParseSource> sources,
+                std::function<void(ParseResult & result)> on_result,
+                unsigned threads,
+                ParserOptions options) {
+    if(threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    std::size_t workers = std::min<std::size_t>(threads, sources.size());
+    if(workers == 0) {
+        return;
+    }
+
+    Batch batch{sources, on_result, options, {}, {}, {}, {false}};
+    for(std::size_t i = 0; i < workers; ++i) {
+        batch.queues.emplace_back(new WorkQueue());
+    }
+    std::vector<std::size_t> order(sources.size());
+    for(std::size_t i = 0; i < order.size(); ++i) {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&sources](std::size_t a, std::size_t b) {
+        return sources[a].size > sources[b].size;
+    });
+    for(std::size_t i = 0; i < order.size(); ++i) {
+        batch.queues[i % workers]->push(order[i]);
+    }
+
+    std::vector<std::thread> pool;
+    for(std::size_t i = 1; i < workers; ++i) {
+        pool.emplace_back(run_worker, std::ref(batch), i);
+    }
+    run_worker(batch, 0);
+    for(auto & t : pool) {
+        t.join();
+    }
+    if(batch.failure) {
+        std::rethrow_exception(batch.failure);
+    }
+}
+
+std::vector<ParseResult> parse_many(std::vector<ParseSource> sources,
+                                    unsigned threads,
+                                    ParserOptions options) {
+    std::vector<ParseResult> results(sources.size());
+    parse_many(std::move(sources), [&results](ParseResult & result) {
+        results[result.index] = std::move(result);
+    }, threads, options);
+    return results;
+}
+
+}
@@ -0,0 +1,77 @@
+// Copyright 2014 Vinzenz Feenstra
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#ifndef GUARD_PYPA_PARSER_BATCH_HH_INCLUDED
+#define GUARD_PYPA_PARSER_BATCH_HH_INCLUDED
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <pypa/parser/parser.hh>
+#include <pypa/parser/error.hh>
+
+namespace pypa {
+
+// One input of parse_many(): either a file path, a caller owned buffer or a
+// Reader supplied by the caller. `size` is only used to schedule the largest
+// inputs first, for files and buffers it is determined automatically.
+struct ParseSource {
+    ParseSource(std::string path);
+    ParseSource(char const * data, std::size_t length, std::string name);
+    ParseSource(std::unique_ptr<Reader> reader, std::size_t size);
+
+    std::string path;
+    std::unique_ptr<Reader> reader;
+    std::size_t size;
+};
+
+struct ParseResult {
+    std::size_t index;          // Index of the source passed to parse_many()
+    std::string name;           // File name as reported by the Reader
+    bool success;
+    AstModulePtr ast;
+    SymbolTablePtr symbols;
+    std::vector<Error> errors;
+    // Owns the AST nodes (PYPA_AST_ARENA builds) and the token values
+    // referenced by `errors`
+    std::unique_ptr<AstArena> arena;
+    std::unique_ptr<StringPool> strings;
+};
+
+// Parses `sources` on `threads` worker threads (0: one per core). Inputs are
+// scheduled largest first, idle workers steal from the others. `on_result`
+// is called once per source as soon as it's parsed, in completion order.
+// Calls are serialized, but they happen on the worker threads. The same
+// holds for options.error_handler, which is called in addition to
+// collecting the errors in ParseResult::errors. Errors aren't printed,
+// options.printerrors is ignored. A file which can't be read fails with an
+// IOError, an exception thrown while parsing with a SystemError.
+// An exception thrown by options.error_handler fails that source the same
+// way, the handler isn't called again for it. If `on_result` throws, no
+// further results are passed, the workers stop once their current source is
+// parsed and the exception is rethrown by parse_many().
+void parse_many(std::vector<ParseSource> sources,
+                std::function<void(ParseResult & result)> on_result,
+                unsigned threads = 0,
+                ParserOptions options = ParserOptions());
+
+// Same as above, returns the results in the order of `sources`
+std::vector<ParseResult> parse_many(std::vector<ParseSource> sources,
+                                    unsigned threads = 0,
+                                    ParserOptions options = ParserOptions());
+
+}
+
+#endif // GUARD_PYPA_PARSER_BATCH_HH_INCLUDED
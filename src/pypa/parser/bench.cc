@@ -0,0 +1,405 @@
+// Copyright 2014 Vinzenz Feenstra
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <pypa/parser/parser.hh>
+#include <pypa/parser/batch.hh>
+#include <pypa/parser/parse_cache.hh>
+#include <pypa/ast/tree_walker.hh>
+
+#if !defined(WIN32)
+#include <sys/resource.h>
+#endif
+
+// Parser benchmark
+//
+//   parser-bench [-n rounds] files...  - lexes each file once into a
+//                                        TokenStream and parses it `rounds`
+//                                        times, reports the time and the
+//                                        rule attempts per token
+//   parser-bench -j threads files...   - parses all files with parse_many()
+//                                        using 1, 2, 4 .. threads workers and
+//                                        reports the speedup
+//   parser-bench -r rounds files...    - edits a line in the middle of each
+//                                        file `rounds` times and compares
+//                                        reparse() with parsing the file
+//   parser-bench -c directory files... - parses all files without a cache,
+//                                        with an empty ParseCache in
+//                                        `directory` (cold) and once more
+//                                        with the filled cache (warm)
+//   parser-bench -s files...           - streams each file with
+//                                        parse_statements(), then parses it
+//                                        as a whole, reports the time and
+//                                        the peak memory after each
+//   parser-bench -l files...           - parses each file with and without
+//                                        ParserOptions::lazy_bodies and
+//                                        reports the time and node count
+//   parser-bench -d megabytes          - generates a data module of that
+//                                        size made of large dict and list
+//                                        displays and parses it with and
+//                                        without ParserOptions::literal_elements
+
+namespace {
+    typedef std::chrono::steady_clock Clock;
+
+    double elapsed_ms(Clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    bool parse_stream(pypa::TokenStream & tokens, pypa::ParseStats & stats) {
+        pypa::AstArena arena;
+        pypa::AstModulePtr ast;
+        pypa::SymbolTablePtr symbols;
+        pypa::ParserOptions options;
+        options.printerrors = false;
+        options.arena = &arena;
+        options.stats = &stats;
+        return pypa::parse(tokens, ast, symbols, options);
+    }
+
+    int run_reparse(int rounds, int argc, char const ** argv) {
+        for (int i = 0; i < argc; ++i) {
+            std::ifstream ifs(argv[i], std::ios::binary);
+            std::string source((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+            pypa::AstArena arena;
+            pypa::AstModulePtr ast;
+            pypa::SymbolTablePtr symbols;
+            pypa::ParserOptions options;
+            options.printerrors = false;
+            options.arena = &arena;
+
+            auto start = Clock::now();
+            pypa::Lexer lexer(source.data(), source.size(), argv[i]);
+            bool ok = pypa::parse(lexer, ast, symbols, options);
+            double full_ms = elapsed_ms(start);
+
+            // Appends to and restores the middle line
+            std::size_t middle = source.find('\n', source.size() / 2);
+            middle = middle == std::string::npos ? source.size() : middle;
+            pypa::TextEdit edits[] = {{middle, 0, " # edit"}, {middle, 7, ""}};
+            start = Clock::now();
+            for (int r = 0; r < rounds; ++r) {
+                ok = pypa::reparse(source, edits[r % 2], ast, symbols, options) && ok;
+            }
+            double reparse_ms = elapsed_ms(start) / rounds;
+            printf("%s:%s\n", argv[i], ok ? "" : " (parse failed)");
+            printf("  parse:   %8.3f ms\n", full_ms);
+            printf("  reparse: %8.3f ms  %6.1fx\n", reparse_ms, full_ms / reparse_ms);
+        }
+        return 0;
+    }
+
+    double parse_files(pypa::ParseCache * cache, int argc, char const ** argv, std::size_t & failed) {
+        failed = 0;
+        auto start = Clock::now();
+        for(int i = 0; i < argc; ++i) {
+            pypa::AstArena arena;
+            pypa::AstModulePtr ast;
+            pypa::SymbolTablePtr symbols;
+            pypa::ParserOptions options;
+            options.printerrors = false;
+            options.arena = &arena;
+            options.cache = cache;
+            pypa::Lexer lexer(argv[i]);
+            failed += pypa::parse(lexer, ast, symbols, options) ? 0 : 1;
+        }
+        return elapsed_ms(start);
+    }
+
+    int run_cache(char const * directory, int argc, char const ** argv) {
+        pypa::ParseCache cache(directory);
+        cache.trim(0);
+        std::size_t failed = 0;
+        double plain = parse_files(0, argc, argv, failed);
+        printf("cache: %d files, %zu failed\n", argc, failed);
+        printf("  no cache: %9.2f ms\n", plain);
+        double cold = parse_files(&cache, argc, argv, failed);
+        auto stats = cache.stats();
+        printf("  cold:     %9.2f ms  %6.2fx  (%llu stored, %.2f MB)\n", cold, plain / cold,
+               (unsigned long long)stats.stores, cache.size() / (1024. * 1024.));
+        double warm = parse_files(&cache, argc, argv, failed);
+        printf("  warm:     %9.2f ms  %6.2fx  (%llu hits)\n", warm, plain / warm,
+               (unsigned long long)(cache.stats().hits - stats.hits));
+        return 0;
+    }
+
+    // Peak resident memory of the process so far in MB, 0 if unknown
+    double peak_mb() {
+#if defined(WIN32)
+        return 0;
+#else
+        struct rusage usage{};
+        getrusage(RUSAGE_SELF, &usage);
+        return usage.ru_maxrss / 1024.;
+#endif
+    }
+
+    int run_stream(int argc, char const ** argv) {
+        for(int i = 0; i < argc; ++i) {
+            pypa::ParserOptions options;
+            options.printerrors = false;
+            std::size_t statements = 0;
+            auto start = Clock::now();
+            pypa::Lexer streamed(argv[i]);
+            bool ok = pypa::parse_statements(streamed, [&statements](pypa::AstStmt const &,
+                                                                     pypa::SymbolTablePtr const &) {
+                ++statements;
+            }, options);
+            double stream_ms = elapsed_ms(start);
+            double stream_peak = peak_mb();
+
+            pypa::AstArena arena;
+            pypa::AstModulePtr ast;
+            pypa::SymbolTablePtr symbols;
+            options.arena = &arena;
+            start = Clock::now();
+            pypa::Lexer lexer(argv[i]);
+            ok = pypa::parse(lexer, ast, symbols, options) && ok;
+            double parse_ms = elapsed_ms(start);
+            printf("%s: %zu statements%s\n", argv[i], statements, ok ? "" : " (parse failed)");
+            printf("  stream: %9.2f ms  peak %8.1f MB\n", stream_ms, stream_peak);
+            printf("  parse:  %9.2f ms  peak %8.1f MB\n", parse_ms, peak_mb());
+        }
+        return 0;
+    }
+
+    struct count_nodes {
+        std::size_t * count;
+
+        template< typename T >
+        typename std::enable_if<std::is_base_of<pypa::Ast, T>::value, bool>::type
+        operator()(T &) {
+            ++*count;
+            return true;
+        }
+
+        template< typename T >
+        typename std::enable_if<!std::is_base_of<pypa::Ast, T>::value, bool>::type
+        operator()(T &) {
+            return true;
+        }
+    };
+
+    int run_lazy(int argc, char const ** argv) {
+        for(int i = 0; i < argc; ++i) {
+            printf("%s:\n", argv[i]);
+            for(bool lazy : {false, true}) {
+                pypa::AstArena arena;
+                pypa::AstModulePtr ast;
+                pypa::SymbolTablePtr symbols;
+                pypa::ParserOptions options;
+                options.printerrors = false;
+                options.lazy_bodies = lazy;
+                options.arena = &arena;
+                auto start = Clock::now();
+                pypa::Lexer lexer(argv[i]);
+                bool ok = pypa::parse(lexer, ast, symbols, options);
+                double ms = elapsed_ms(start);
+                std::size_t nodes = 0;
+                if(ast) {
+                    walk_tree(*ast, count_nodes{&nodes});
+                }
+                printf("  %s %9.2f ms  %9zu nodes%s\n", lazy ? "lazy:" : "full:", ms, nodes,
+                       ok ? "" : " (parse failed)");
+            }
+        }
+        return 0;
+    }
+
+    double parse_all(pypa::ParserOptions options, pypa::ParseStats & stats,
+                     std::vector<std::unique_ptr<pypa::TokenStream>> const & tokens, std::size_t & failed) {
+        failed = 0;
+        auto start = Clock::now();
+        for(auto const & stream : tokens) {
+            pypa::AstArena arena;
+            pypa::AstModulePtr ast;
+            pypa::SymbolTablePtr symbols;
+            options.printerrors = false;
+            options.arena = &arena;
+            options.stats = &stats;
+            failed += pypa::parse(*stream, ast, symbols, options) ? 0 : 1;
+        }
+        return elapsed_ms(start);
+    }
+
+    // Generated data module: assignments of dicts with 10000 entries, the
+    // values are numbers, strings, names and small nested displays, and of
+    // lists with 100000 numbers
+    std::string data_module(std::size_t bytes) {
+        std::string source = "# Generated data\n";
+        unsigned seed = 1;
+        auto next = [&seed]() { seed = seed * 1103515245u + 12345u; return (seed >> 8) % 100000; };
+        char buffer[128];
+        for(int statement = 0; source.size() < bytes; ++statement) {
+            if(statement % 4 == 3) {
+                snprintf(buffer, sizeof(buffer), "VALUES_%d = [\n", statement);
+                source += buffer;
+                for(int i = 0; i < 100000; ++i) {
+                    snprintf(buffer, sizeof(buffer), i % 10 == 9 ? "%u,\n" : "%u, ", next());
+                    source += buffer;
+                }
+                source += "]\n";
+                continue;
+            }
+            snprintf(buffer, sizeof(buffer), "TABLE_%d = {\n", statement);
+            source += buffer;
+            for(int i = 0; i < 10000; ++i) {
+                unsigned v = next();
+                switch(i % 8) {
+                case 0: snprintf(buffer, sizeof(buffer), "    'key_%d': %u,\n", i, v); break;
+                case 1: snprintf(buffer, sizeof(buffer), "    'key_%d': %u.%u,\n", i, v, v % 97); break;
+                case 2: snprintf(buffer, sizeof(buffer), "    'key_%d': -%u,\n", i, v); break;
+                case 3: snprintf(buffer, sizeof(buffer), "    'key_%d': \"value %u\",\n", i, v); break;
+                case 4: snprintf(buffer, sizeof(buffer), "    'key_%d': None,\n", i); break;
+                case 5: snprintf(buffer, sizeof(buffer), "    'key_%d': [%u, %u, -%u, 0x%x],\n", i, v, v / 3, v / 7, v); break;
+                case 6: snprintf(buffer, sizeof(buffer), "    'key_%d': ('a%u', u'b', True),\n", i, v); break;
+                default: snprintf(buffer, sizeof(buffer), "    %u: {'x': %u, 'y': %u.5},\n", v, v / 2, v / 5); break;
+                }
+                source += buffer;
+            }
+            source += "}\n";
+        }
+        return source;
+    }
+
+    int run_data(int megabytes) {
+        std::string source = data_module(std::size_t(megabytes) * 1024 * 1024);
+        pypa::Lexer lexer(source.data(), source.size(), "<data>");
+        std::vector<std::unique_ptr<pypa::TokenStream>> tokens;
+        tokens.emplace_back(new pypa::TokenStream(lexer));
+        auto start = Clock::now();
+        tokens.back()->read_all();
+        double lex_ms = elapsed_ms(start);
+        printf("data module: %.2f MB, %zu tokens\n", source.size() / (1024. * 1024.), tokens.back()->size());
+        printf("  lex:      %9.2f ms\n", lex_ms);
+        pypa::ParserOptions plain_options, literal_options;
+        plain_options.literal_elements = false;
+        literal_options.literal_elements = true;
+        pypa::ParseStats plain_stats, stats;
+        std::size_t failed = 0;
+        double plain = parse_all(plain_options, plain_stats, tokens, failed);
+        double literal = parse_all(literal_options, stats, tokens, failed);
+        for(int r = 0; r < 2; ++r) {
+            plain = std::min(plain, parse_all(plain_options, plain_stats, tokens, failed));
+            stats = pypa::ParseStats();
+            literal = std::min(literal, parse_all(literal_options, stats, tokens, failed));
+        }
+        printf("  plain:    %9.2f ms\n", plain);
+        printf("  literals: %9.2f ms  %6.2fx  %llu elements built directly%s\n", literal, plain / literal,
+               (unsigned long long)stats.literal_elements, failed ? " (parse failed)" : "");
+        return 0;
+    }
+
+    int run_scaling(unsigned max_threads, int argc, char const ** argv) {
+        std::size_t bytes = 0;
+        for (int i = 0; i < argc; ++i) {
+            bytes += pypa::ParseSource(argv[i]).size;
+        }
+        printf("parse_many: %d files, %.2f MB\n", argc, bytes / (1024. * 1024.));
+        double single = 0;
+        for (unsigned threads = 1;; threads = std::min(threads * 2, max_threads)) {
+            std::vector<pypa::ParseSource> sources;
+            for (int i = 0; i < argc; ++i) {
+                sources.emplace_back(argv[i]);
+            }
+            pypa::ParserOptions options;
+            options.printerrors = false;
+            std::size_t failed = 0;
+            auto start = Clock::now();
+            pypa::parse_many(std::move(sources), [&failed](pypa::ParseResult & r) {
+                failed += !r.success;
+            }, threads, options);
+            double ms = elapsed_ms(start);
+            if (threads == 1) {
+                single = ms;
+            }
+            printf("  %3u threads: %9.2f ms  %6.2fx  (%zu failed)\n", threads, ms, single / ms, failed);
+            if (threads == max_threads) {
+                break;
+            }
+        }
+        return 0;
+    }
+}
+
+int main(int argc, char const ** argv) {
+    int rounds = 10;
+    int first = 1;
+    if (argc > 2 && argv[1][0] == '-' && argv[1][1] == 'j') {
+        int threads = atoi(argv[2]);
+        if (threads > 0 && argc > 3) {
+            return run_scaling(unsigned(threads), argc - 3, argv + 3);
+        }
+        first = argc;
+    }
+    if (argc > 3 && argv[1][0] == '-' && argv[1][1] == 'r') {
+        int edits = atoi(argv[2]);
+        if (edits > 0) {
+            return run_reparse(edits, argc - 3, argv + 3);
+        }
+        first = argc;
+    }
+    if (argc > 3 && argv[1][0] == '-' && argv[1][1] == 'c') {
+        return run_cache(argv[2], argc - 3, argv + 3);
+    }
+    if (argc > 2 && argv[1][0] == '-' && argv[1][1] == 'l') {
+        return run_lazy(argc - 2, argv + 2);
+    }
+    if (argc > 2 && argv[1][0] == '-' && argv[1][1] == 'd') {
+        return run_data(std::max(atoi(argv[2]), 1));
+    }
+    if (argc > 2 && argv[1][0] == '-' && argv[1][1] == 's') {
+        return run_stream(argc - 2, argv + 2);
+    }
+    if (argc > 2 && argv[1][0] == '-' && argv[1][1] == 'n') {
+        rounds = atoi(argv[2]);
+        first = 3;
+    }
+    if (first >= argc || rounds <= 0) {
+        fprintf(stderr, "Usage: %s [-n rounds | -j threads | -r rounds | -c directory | -s | -l] <python_file_path>...\n"
+                "       %s -d megabytes\n", argv[0], argv[0]);
+        return 1;
+    }
+    for (int i = first; i < argc; ++i) {
+        auto start = Clock::now();
+        pypa::Lexer lexer(argv[i]);
+        pypa::TokenStream tokens(lexer);
+        tokens.read_all();
+        double lex_ms = elapsed_ms(start);
+        double ns_per_token = 1e6 / double(tokens.size());
+
+        bool ok = true;
+        pypa::ParseStats stats;
+        start = Clock::now();
+        for (int r = 0; r < rounds; ++r) {
+            ok = parse_stream(tokens, stats) && ok;
+        }
+        double parse_ms = elapsed_ms(start) / rounds;
+        printf("%s: %zu tokens%s\n", argv[i], tokens.size(), ok ? "" : " (parse failed)");
+        printf("  lex:   %8.2f ms  %7.1f ns/token\n", lex_ms, lex_ms * ns_per_token);
+        printf("  parse: %8.2f ms  %7.1f ns/token\n", parse_ms, parse_ms * ns_per_token);
+        printf("  rules: %8.2f savepoints/token  %5.2f reverts/token\n",
+               double(stats.savepoints) / rounds / tokens.size(),
+               double(stats.reverts) / rounds / tokens.size());
+    }
+    return 0;
+}
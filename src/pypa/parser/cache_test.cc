@@ -0,0 +1,224 @@
+// Copyright 2014 Vinzenz Feenstra
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include <dirent.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fstream>
+
+#include <pypa/parser/parse_cache.hh>
+#include <pypa/parser/test_helper.hh>
+
+// ParseCache and serialization test
+//
+//   cache-test files...    - parses every file twice through a ParseCache in
+//                            a new temporary directory, which is removed
+//                            afterwards. The second time it has to be
+//                            a hit with the same AST and symbol table. Then
+//                            checks the options are part of the key and
+//                            the size limit is kept. The serialized tree
+//                            walked in place by SerializedAst has to match
+//                            the parsed one. An entry found under the file
+//                            name of another source has to be a miss.
+
+using pypa::test::expect;
+using pypa::test::Parsed;
+
+namespace {
+    // Same order as walk_tree(), but reading the serialized form
+    void print_serialized(pypa::SerializedNode node, std::string & out) {
+        char buffer[64];
+        snprintf(buffer, sizeof(buffer), "%d:%u:%u ", int(node.type()), node.line(), node.column());
+        out += buffer;
+        for(std::size_t i = 0; i < node.member_count(); ++i) {
+            pypa::SerializedMember m = node.member(i);
+            if(m.kind() == pypa::SerializedKind::Node && m.node()) {
+                print_serialized(m.node(), out);
+            }
+            else if(m.kind() == pypa::SerializedKind::String) {
+                out += m.string().str() + " ";
+            }
+            for(std::size_t j = 0; j < m.size(); ++j) {
+                if(m.at(j).node()) {
+                    print_serialized(m.at(j).node(), out);
+                }
+            }
+        }
+    }
+
+    // Directory of the cache, created by main()
+    std::string directory;
+
+    bool check_serialized(char const * file, Parsed & parsed) {
+        std::string data = parsed.serialized();
+        std::string expected = parsed.tree();
+
+        pypa::SerializedAst view;
+        std::string actual;
+        if(!expect(view.open(data.data(), data.size()), file, "can't open serialized data")) {
+            return false;
+        }
+        print_serialized(view.root(), actual);
+        if(!expect(actual == expected, file, "serialized tree differs")) {
+            return false;
+        }
+
+        // Once more through a mapped file
+        std::string path = directory + "/serialize-test.bin";
+        pypa::SerializedAst mapped;
+        actual.clear();
+        bool ok = expect(pypa::serialize_to_file(*parsed.ast, *parsed.symbols, path), file, "can't write file")
+               && expect(mapped.open(path), file, "can't map file");
+        if(ok) {
+            print_serialized(mapped.root(), actual);
+            ok = expect(actual == expected, file, "mapped tree differs");
+        }
+        remove(path.c_str());
+        return ok;
+    }
+
+    void parse_file(char const * file, pypa::ParseCache & cache, Parsed & result,
+                    bool docstrings = true) {
+        pypa::ParserOptions options;
+        options.docstrings = docstrings;
+        options.cache = &cache;
+        pypa::Lexer lexer(file);
+        result.parse(lexer, options);
+    }
+
+    // Names of the cache entries in `directory`
+    std::vector<std::string> entries() {
+        std::vector<std::string> names;
+        if(DIR * dir = opendir(directory.c_str())) {
+            while(struct dirent * e = readdir(dir)) {
+                std::size_t length = strlen(e->d_name);
+                if(length > 11 && strcmp(e->d_name + length - 11, ".pypa-cache") == 0) {
+                    names.push_back(directory + "/" + e->d_name);
+                }
+            }
+            closedir(dir);
+        }
+        return names;
+    }
+
+    // Copies the entry of one source over the one of another source of the
+    // same length, as if their file names collided
+    int check_collision() {
+        char const * name = "<collision>";
+        pypa::ParseCache cache(directory);
+        pypa::ParserOptions options;
+        options.cache = &cache;
+        Parsed first, second;
+        first.parse(std::string("first = 1\n"), options);
+        std::vector<std::string> before = entries();
+        second.parse(std::string("other = 2\n"), options);
+        std::vector<std::string> after = entries();
+        if(!expect(first.success && second.success && before.size() == 1 && after.size() == 2,
+                   name, "entries weren't stored")) {
+            cache.trim(0);
+            return 1;
+        }
+        std::string target = after[0] == before[0] ? after[1] : after[0];
+        std::ofstream(target.c_str(), std::ios::binary | std::ios::trunc)
+            << pypa::test::read_file(before[0].c_str());
+
+        Parsed again;
+        auto misses = cache.stats().misses;
+        again.parse(std::string("other = 2\n"), options);
+        bool ok = expect(cache.stats().misses == misses + 1, name, "entry of another source was used")
+               && expect(again.tree() == second.tree(), name, "wrong result after a collision");
+        cache.trim(0);
+        if(ok) {
+            printf("%s: ok\n", name);
+        }
+        return ok ? 0 : 1;
+    }
+
+    int check_file(char const * file, pypa::ParseCache & cache) {
+        auto before = cache.stats();
+        Parsed first;
+        parse_file(file, cache, first);
+        auto after = cache.stats();
+        if(!first.success || !first.error_lines.empty()) {
+            bool ok = expect(after.stores == before.stores, file, "result with errors was stored");
+            printf("%s: not cached, %s\n", file, first.success ? "has warnings" : "doesn't parse");
+            return ok ? 0 : 1;
+        }
+        if(!expect(after.stores == before.stores + 1, file, "result wasn't stored")) {
+            return 1;
+        }
+
+        Parsed second;
+        parse_file(file, cache, second);
+        if(!expect(cache.stats().hits == after.hits + 1, file, "no cache hit")
+        || !expect(second.success && second.symbols->file_name == file, file, "bad result on hit")
+        || !expect(first.serialized() == second.serialized(), file, "cached result differs")) {
+            return 1;
+        }
+
+        if(!check_serialized(file, first)) {
+            return 1;
+        }
+
+        Parsed other;
+        auto hits = cache.stats().hits;
+        parse_file(file, cache, other, false);
+        if(!expect(cache.stats().hits == hits, file, "options aren't part of the key")) {
+            return 1;
+        }
+        printf("%s: %zu bytes\n", file, first.serialized().size());
+        return 0;
+    }
+}
+
+int main(int argc, char const ** argv) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <python_file_path>...\n", argv[0]);
+        return 1;
+    }
+    char const * tmp = getenv("TMPDIR");
+    std::string name = std::string(tmp && *tmp ? tmp : "/tmp") + "/pypa-cache-test.XXXXXX";
+    if (!mkdtemp(&name[0])) {
+        perror("mkdtemp");
+        return 1;
+    }
+    directory = name;
+    int failures = 0;
+    {
+        pypa::ParseCache cache(directory);
+        for (int i = 1; i < argc; ++i) {
+            failures += check_file(argv[i], cache);
+        }
+        cache.trim(0);
+    }
+
+    {
+        // Every store beyond the limit has to evict entries
+        std::uint64_t limit = 16 * 1024;
+        pypa::ParseCache cache(directory, limit);
+        for (int i = 1; i < argc; ++i) {
+            Parsed parsed;
+            parse_file(argv[i], cache, parsed);
+            failures += expect(cache.size() <= limit, argv[i], "size limit exceeded") ? 0 : 1;
+        }
+        auto stats = cache.stats();
+        printf("limit %llu: %llu stores, %llu evictions\n", (unsigned long long)limit,
+               (unsigned long long)stats.stores, (unsigned long long)stats.evictions);
+        cache.trim(0);
+    }
+    failures += check_collision();
+    // Fails if anything was left behind
+    failures += expect(rmdir(directory.c_str()) == 0, directory.c_str(), "can't remove the cache directory") ? 0 : 1;
+    return failures == 0 ? 0 : 1;
+}
@@ -22,7 +22,9 @@ namespace pypa {
     enum class ErrorType {
         SyntaxError,
         SyntaxWarning,
-        IndentationError
+        IndentationError,
+        IOError,        // The source couldn't be read
+        SystemError     // Parsing failed with an exception
     };
 
     struct Error {
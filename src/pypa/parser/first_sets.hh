@@ -0,0 +1,101 @@
+// Copyright 2014 Vinzenz Feenstra
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#ifndef GUARD_PYPA_PARSER_FIRST_SETS_HH_INCLUDED
+#define GUARD_PYPA_PARSER_FIRST_SETS_HH_INCLUDED
+
+#include <pypa/lexer/lexer.hh>
+
+namespace pypa {
+
+// FIRST sets of the rules the parser dispatches on, written out from the
+// `grammar` file. first-test computes them from the grammar and compares.
+// `python3` additionally allows `...` (lexed as '.') as an atom.
+
+inline bool starts_atom(TokenInfo const & tok, bool python3) {
+    switch(tok.ident.kind()) {
+    case TokenKind::LeftParen:
+    case TokenKind::LeftBracket:
+    case TokenKind::LeftBrace:
+    case TokenKind::BackQuote:
+    case TokenKind::Number:
+        return true;
+    case TokenKind::Dot:
+        return python3;
+    default:
+        return tok.ident.id() == Token::Identifier || tok.ident.id() == Token::String;
+    }
+}
+
+// The prefix operators and FIRST(atom)
+inline bool starts_test(TokenInfo const & tok, bool python3) {
+    switch(tok.ident.id()) {
+    case Token::KeywordNot:
+    case Token::KeywordLambda:
+        return true;
+    default:
+        break;
+    }
+    switch(tok.ident.kind()) {
+    case TokenKind::Plus:
+    case TokenKind::Minus:
+    case TokenKind::Tilde:
+        return true;
+    default:
+        return starts_atom(tok, python3);
+    }
+}
+
+inline bool starts_trailer(TokenInfo const & tok) {
+    switch(tok.ident.kind()) {
+    case TokenKind::LeftParen:
+    case TokenKind::LeftBracket:
+    case TokenKind::Dot:
+        return true;
+    default:
+        return false;
+    }
+}
+
+inline bool starts_flow_stmt(TokenInfo const & tok) {
+    switch(tok.ident.id()) {
+    case Token::KeywordBreak:
+    case Token::KeywordContinue:
+    case Token::KeywordReturn:
+    case Token::KeywordRaise:
+    case Token::KeywordYield:
+        return true;
+    default:
+        return false;
+    }
+}
+
+inline bool starts_compound_stmt(TokenInfo const & tok) {
+    switch(tok.ident.id()) {
+    case Token::KeywordIf:
+    case Token::KeywordWhile:
+    case Token::KeywordFor:
+    case Token::KeywordTry:
+    case Token::KeywordWith:
+    case Token::KeywordDef:
+    case Token::KeywordClass:
+    case Token::DelimAt:
+        return true;
+    default:
+        return false;
+    }
+}
+
+}
+
+#endif // GUARD_PYPA_PARSER_FIRST_SETS_HH_INCLUDED
@@ -0,0 +1,300 @@
+// Copyright 2014 Vinzenz Feenstra
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include <ctype.h>
+#include <stdio.h>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <pypa/parser/first_sets.hh>
+
+// Check of the FIRST sets in first_sets.hh
+//
+//   first-test grammar     - computes the FIRST sets of the rules in the
+//                            grammar file and compares them with the
+//                            predicates for every terminal of the grammar
+
+namespace {
+    // Rule body: alternatives, sequences, [optional], x*, x+, rule names
+    // and 'quoted' terminals. Upper case names are lexer tokens.
+    struct Node {
+        enum Type { Alt, Seq, Opt, Star, Plus, Ref, Term } type;
+        std::string text;
+        std::vector<std::unique_ptr<Node>> items;
+    };
+    typedef std::unique_ptr<Node> NodePtr;
+
+    bool is_token(std::string const & name) {
+        return !name.empty() && isupper((unsigned char)name[0]);
+    }
+
+    class RuleParser {
+        std::vector<std::string> words_;
+        std::size_t pos_;
+
+        std::string const & peek() {
+            static std::string const none;
+            return pos_ < words_.size() ? words_[pos_] : none;
+        }
+
+        NodePtr make(Node::Type type, std::string text = std::string()) {
+            NodePtr node(new Node);
+            node->type = type;
+            node->text = text;
+            return node;
+        }
+
+        NodePtr item() {
+            NodePtr result;
+            std::string word = peek();
+            ++pos_;
+            if(word == "(" || word == "[") {
+                result = alt();
+                if(word == "[") {
+                    NodePtr opt = make(Node::Opt);
+                    opt->items.push_back(std::move(result));
+                    result = std::move(opt);
+                }
+                ++pos_; // ')' or ']'
+            }
+            else if(word[0] == '\'' || word[0] == '"') {
+                result = make(Node::Term, word.substr(1, word.size() - 2));
+            }
+            else {
+                result = make(Node::Ref, word);
+            }
+            if(peek() == "*" || peek() == "+") {
+                NodePtr repeat = make(peek() == "*" ? Node::Star : Node::Plus);
+                repeat->items.push_back(std::move(result));
+                result = std::move(repeat);
+                ++pos_;
+            }
+            return result;
+        }
+
+        NodePtr seq() {
+            NodePtr result = make(Node::Seq);
+            while(pos_ < words_.size() && peek() != "|" && peek() != ")" && peek() != "]") {
+                result->items.push_back(item());
+            }
+            return result;
+        }
+
+        NodePtr alt() {
+            NodePtr result = make(Node::Alt);
+            result->items.push_back(seq());
+            while(peek() == "|") {
+                ++pos_;
+                result->items.push_back(seq());
+            }
+            return result;
+        }
+
+    public:
+        NodePtr parse(std::string const & body) {
+            words_.clear();
+            pos_ = 0;
+            for(std::size_t i = 0; i < body.size();) {
+                char c = body[i];
+                std::size_t end = i + 1;
+                if(isspace((unsigned char)c)) {
+                    ++i;
+                    continue;
+                }
+                if(c == '\'' || c == '"') {
+                    end = body.find(c, i + 1) + 1;
+                }
+                else if(isalnum((unsigned char)c) || c == '_') {
+                    while(end < body.size() && (isalnum((unsigned char)body[end]) || body[end] == '_')) {
+                        ++end;
+                    }
+                }
+                words_.push_back(body.substr(i, end - i));
+                i = end;
+            }
+            return alt();
+        }
+    };
+
+    struct Grammar {
+        std::map<std::string, NodePtr> rules;
+        std::map<std::string, std::set<std::string>> first;
+        std::map<std::string, bool> nullable;
+        std::set<std::string> terminals;
+
+        // Adds FIRST(node) to `out`, returns whether it matches nothing
+        bool first_of(Node const & node, std::set<std::string> & out) {
+            switch(node.type) {
+            case Node::Term:
+                out.insert("'" + node.text + "'");
+                return false;
+            case Node::Ref:
+                if(is_token(node.text)) {
+                    out.insert(node.text);
+                    return false;
+                }
+                out.insert(first[node.text].begin(), first[node.text].end());
+                return nullable[node.text];
+            case Node::Seq:
+                for(auto const & item : node.items) {
+                    if(!first_of(*item, out)) {
+                        return false;
+                    }
+                }
+                return true;
+            case Node::Alt: {
+                bool result = false;
+                for(auto const & item : node.items) {
+                    result = first_of(*item, out) || result;
+                }
+                return result;
+            }
+            case Node::Opt:
+            case Node::Star:
+                first_of(*node.items.front(), out);
+                return true;
+            case Node::Plus:
+                return first_of(*node.items.front(), out);
+            }
+            return false;
+        }
+
+        void collect_terminals(Node const & node) {
+            if(node.type == Node::Term) {
+                terminals.insert("'" + node.text + "'");
+            }
+            else if(node.type == Node::Ref && is_token(node.text)) {
+                terminals.insert(node.text);
+            }
+            for(auto const & item : node.items) {
+                collect_terminals(*item);
+            }
+        }
+
+        bool load(char const * path) {
+            std::ifstream ifs(path);
+            std::string line;
+            std::vector<std::string> lines;
+            while(std::getline(ifs, line)) {
+                line = line.substr(0, line.find('#'));
+                if(!line.empty() && isspace((unsigned char)line[0]) && !lines.empty()) {
+                    lines.back() += " " + line;
+                }
+                else if(line.find(':') != std::string::npos) {
+                    lines.push_back(line);
+                }
+            }
+            RuleParser parser;
+            for(auto const & l : lines) {
+                std::string name = l.substr(0, l.find(':'));
+                // Token definitions are regular expressions
+                if(!is_token(name)) {
+                    rules[name] = parser.parse(l.substr(l.find(':') + 1));
+                    collect_terminals(*rules[name]);
+                }
+            }
+            for(bool changed = true; changed;) {
+                changed = false;
+                for(auto const & rule : rules) {
+                    std::set<std::string> out;
+                    bool empty = first_of(*rule.second, out);
+                    if(out != first[rule.first] || empty != nullable[rule.first]) {
+                        first[rule.first] = out;
+                        nullable[rule.first] = empty;
+                        changed = true;
+                    }
+                }
+            }
+            return !rules.empty();
+        }
+    };
+
+    // A source starting with the terminal
+    std::string sample(std::string const & terminal) {
+        if(terminal == "NAME") return "name";
+        if(terminal == "NUMBER") return "1";
+        if(terminal == "STRING") return "'text'";
+        if(terminal[0] == '\'') return terminal.substr(1, terminal.size() - 2);
+        return std::string();
+    }
+
+    struct Check {
+        char const * rule;
+        bool python3;
+        std::set<std::string> extra; // Accepted beyond the grammar
+        std::function<bool(pypa::TokenInfo const &, bool)> starts;
+    };
+
+    int check(Grammar & grammar, Check const & c) {
+        if(!grammar.rules.count(c.rule)) {
+            fprintf(stderr, "%s: rule not in the grammar\n", c.rule);
+            return 1;
+        }
+        int failures = 0;
+        for(auto const & terminal : grammar.terminals) {
+            std::string text = sample(terminal);
+            if(text.empty()) {
+                continue;   // NEWLINE, INDENT, ...
+            }
+            pypa::Lexer lexer(text.data(), text.size(), "<first-test>");
+            pypa::TokenInfo tok = lexer.next();
+            std::set<std::string> const & first = grammar.first[c.rule];
+            // `print` isn't a keyword for the lexer, it's a NAME
+            bool expected = first.count(terminal) || c.extra.count(terminal)
+                || (tok.ident.id() == pypa::Token::Identifier && first.count("NAME"));
+            if(c.starts(tok, c.python3) != expected) {
+                fprintf(stderr, "FIRST(%s)%s: %s %s\n", c.rule, c.python3 ? " python3" : "",
+                        terminal.c_str(), expected ? "missing" : "not in the grammar");
+                ++failures;
+            }
+        }
+        printf("FIRST(%s)%s: %zu terminals\n", c.rule, c.python3 ? " python3" : "",
+               grammar.first[c.rule].size() + c.extra.size());
+        return failures;
+    }
+}
+
+int main(int argc, char const ** argv) {
+    if (argc != 2) {
+        fprintf(stderr, "Usage: %s <grammar_file_path>\n", argv[0]);
+        return 1;
+    }
+    Grammar grammar;
+    if (!grammar.load(argv[1])) {
+        fprintf(stderr, "%s: no rules found\n", argv[1]);
+        return 1;
+    }
+    auto ignore_python3 = [](bool (*f)(pypa::TokenInfo const &)) {
+        return [f](pypa::TokenInfo const & tok, bool) { return f(tok); };
+    };
+    std::set<std::string> none, ellipsis = {"'.'"};
+    Check const checks[] = {
+        {"atom", false, none, pypa::starts_atom},
+        {"atom", true, ellipsis, pypa::starts_atom},
+        {"test", false, none, pypa::starts_test},
+        {"test", true, ellipsis, pypa::starts_test},
+        {"trailer", false, none, ignore_python3(pypa::starts_trailer)},
+        {"flow_stmt", false, none, ignore_python3(pypa::starts_flow_stmt)},
+        {"compound_stmt", false, none, ignore_python3(pypa::starts_compound_stmt)},
+    };
+    int failures = 0;
+    for (auto const & c : checks) {
+        failures += check(grammar, c);
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,108 @@
+// Copyright 2014 Vinzenz Feenstra
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include <pypa/parser/test_helper.hh>
+
+// Test of ParserOptions::lazy_bodies
+//
+//   lazy-test files...     - parses each file with lazy function bodies,
+//                            after expand_bodies() the tree has to match the
+//                            one of a normal parse. Then checks errors in
+//                            lazy bodies are reported with the module lines.
+
+using pypa::test::expect;
+
+namespace {
+    struct Parsed : pypa::test::Parsed {
+        Parsed(std::string const & source, bool lazy_bodies) {
+            parse(source, lazy_options(lazy_bodies));
+        }
+
+        pypa::ParserOptions lazy_options(bool lazy_bodies) {
+            pypa::ParserOptions result;
+            result.lazy_bodies = lazy_bodies;
+            return options(result);
+        }
+
+        bool expand() {
+            return pypa::expand_bodies(*ast, *symbols, lazy_options(true));
+        }
+    };
+
+    int check_source(std::string const & source, char const * file) {
+        Parsed full(source, false);
+        if (!full.success) {
+            printf("%s: skipped, doesn't parse\n", file);
+            return 0;
+        }
+        Parsed lazy(source, true);
+        std::size_t bodies = 0, remaining = 0;
+        lazy.tree(&bodies);
+        if (!expect(lazy.success, file, "lazy parse failed")
+            || !expect(lazy.expand(), file, "expanding failed")
+            || !expect(lazy.tree(&remaining) == full.tree() && remaining == 0, file, "expanded tree differs")) {
+            return 1;
+        }
+        printf("%s: %zu lazy bodies\n", file, bodies);
+        return 0;
+    }
+
+    int check_file(char const * file) {
+        return check_source(pypa::test::read_file(file), file);
+    }
+
+    int check_errors(std::string const & indent) {
+        std::string source =
+            "def f(a):\n" +
+            indent + "'''Docstring'''\n" +
+            indent + "if a:\n" +
+            indent + indent + "return a +\n" +
+            indent + "return 1\n"
+            "\n"
+            "x = f(1)\n";
+        Parsed full(source, false);
+        Parsed lazy(source, true);
+        if (!expect(!full.success && !full.error_lines.empty(), "<errors>", "error not found")
+            || !expect(lazy.success && lazy.error_lines.empty(), "<errors>", "lazy body was parsed")) {
+            return 1;
+        }
+        auto f = pypa::ast_cast<pypa::AstFunctionDef>(lazy.ast->body->items.front());
+        auto body = pypa::ast_cast<pypa::AstLazySuite>(f->body);
+        if (!expect(body->type == pypa::AstType::LazySuite && body->items.size() == 1
+                    && body->items.front()->type == pypa::AstType::DocString,
+                    "<errors>", "docstring of lazy body missing")
+            || !expect(!lazy.expand() && f->body == body, "<errors>", "expanding didn't fail")
+            || !expect(lazy.error_lines.front() == full.error_lines.front(), "<errors>", "wrong error line")) {
+            return 1;
+        }
+        printf("<errors>: error reported on line %d\n", lazy.error_lines.front());
+        return 0;
+    }
+
+    int check_indentation() {
+        // A tab at the start of the lexed body has to count as it does in
+        // the module
+        std::string tabs =
+            "def f():\n"
+            "\tx = 1\n"
+            "\treturn x\n"
+            "z = 3\n";
+        return check_source(tabs, "<tabs>")
+            + check_errors("    ")
+            + check_errors("\t");
+    }
+}
+
+int main(int argc, char const ** argv) {
+    return pypa::test::run(argc, argv, check_file, check_indentation);
+}
@@ -0,0 +1,87 @@
+// Copyright 2014 Vinzenz Feenstra
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include <pypa/parser/test_helper.hh>
+
+// Test of ParserOptions::literal_elements
+//
+//   literal-test files...  - parses each file with and without building the
+//                            literal elements of displays directly, with and
+//                            without inline optimizations. The serialized
+//                            trees and the reported errors have to be the
+//                            same
+
+using pypa::test::expect;
+using pypa::test::Parsed;
+
+namespace {
+    pypa::ParserOptions options(bool literal_elements, bool inline_optimizations) {
+        pypa::ParserOptions result;
+        result.literal_elements = literal_elements;
+        result.perform_inline_optimizations = inline_optimizations;
+        return result;
+    }
+
+    int check_source(std::string const & source, char const * file, unsigned long long & elements) {
+        elements = 0;
+        for (bool inline_optimizations : {false, true}) {
+            Parsed plain, literal;
+            plain.parse(source, options(false, inline_optimizations));
+            literal.parse(source, options(true, inline_optimizations));
+            if (!expect(plain.stats.literal_elements == 0, file, "elements built directly without literal_elements")
+                || !expect(literal.success == plain.success, file, "parse result differs")
+                || !expect(literal.error_lines == plain.error_lines, file, "errors differ")
+                || !expect(literal.serialized() == plain.serialized(), file, "tree differs")) {
+                return 1;
+            }
+            elements = literal.stats.literal_elements;
+        }
+        printf("%s: %llu elements built directly\n", file, elements);
+        return 0;
+    }
+
+    int check_file(char const * file) {
+        unsigned long long elements = 0;
+        return check_source(pypa::test::read_file(file), file, elements);
+    }
+
+    int check_displays() {
+        // Literal elements next to the ones that continue after the first
+        // token and have to go through test()
+        std::string source =
+            "data = {\n"
+            "    'a': 1, 'b': -2, 'c': ~3, 'd': +4.5, 'e': 'x' 'y' \"z\",\n"
+            "    None: [True, False, 0x10, 07, 1L, 2.5e3, -1j, 1+2j, 3j, -1-2j],\n"
+            "    ('t',): (1,), 'n': (), 's': {1, 'two', -3,},\n"
+            "    'expr': [a.b, f(1), x[0], 1 + 2, -1 ** 2, 2 ** 3, a if b else c, not a, lambda: 1, 'a' % b],\n"
+            "    'comp': [x for x in y], 'gen': (x for x in y), 'dcomp': {k: -v for k, v in z},\n"
+            "    'nested': [[1, -2], (3, 'four'), {5: None}], -1: {-2: {'x': ()}},\n"
+            "}\n";
+        unsigned long long elements = 0;
+        if (check_source(source, "<displays>", elements)) {
+            return 1;
+        }
+        if (!expect(elements > 0, "<displays>", "no elements built directly")) {
+            return 1;
+        }
+        std::string errors =
+            "a = [1, 2,\n"
+            "b = {1: }\n"
+            "c = (1, -)\n";
+        return check_source(errors, "<errors>", elements);
+    }
+}
+
+int main(int argc, char const ** argv) {
+    return pypa::test::run(argc, argv, check_file, check_displays);
+}
@@ -0,0 +1,214 @@
+// Copyright 2014 Vinzenz Feenstra
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Conversion of long integer literals, see AstNumber::limbs
+//
+// Binary, octal and hex digits are packed into the limbs directly. Decimal
+// digits are multiplied in and divided out 9 at a time, which is quadratic in
+// the number of digits. That doesn't matter for the literals found in code,
+// GMP is only used (if available) for the longer ones.
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#ifdef PYPA_WITH_GMP
+#   include <gmp.h>
+#endif
+
+#include <pypa/types.hh>
+
+namespace pypa {
+
+namespace {
+    uint32_t const decimal_chunk = 1000000000u;  // 10^9, fits into a limb
+    unsigned const decimal_chunk_digits = 9;
+
+#ifdef PYPA_WITH_GMP
+    // Sizes from which on GMP is faster, measured with g++ -O2 on x86_64
+    std::size_t const gmp_from_decimal_digits = 400;
+    std::size_t const gmp_to_decimal_limbs = 8;
+#endif
+
+    inline unsigned digit_value(char c) {
+        if(c >= '0' && c <= '9') {
+            return unsigned(c - '0');
+        }
+        if(c >= 'a' && c <= 'f') {
+            return unsigned(c - 'a' + 10);
+        }
+        if(c >= 'A' && c <= 'F') {
+            return unsigned(c - 'A' + 10);
+        }
+        return 16;
+    }
+
+    inline void trim(std::vector<uint32_t> & limbs) {
+        while(!limbs.empty() && limbs.back() == 0) {
+            limbs.pop_back();
+        }
+    }
+
+    // limbs = limbs * factor + add
+    inline void multiply_add(std::vector<uint32_t> & limbs, uint32_t factor, uint32_t add) {
+        uint64_t carry = add;
+        for(uint32_t & limb : limbs) {
+            uint64_t v = uint64_t(limb) * factor + carry;
+            limb = uint32_t(v);
+            carry = v >> 32;
+        }
+        if(carry) {
+            limbs.push_back(uint32_t(carry));
+        }
+    }
+
+    // limbs = limbs / divisor, returns the remainder
+    inline uint32_t divide(std::vector<uint32_t> & limbs, uint32_t divisor) {
+        uint64_t remainder = 0;
+        for(std::size_t i = limbs.size(); i-- > 0;) {
+            uint64_t v = (remainder << 32) | limbs[i];
+            limbs[i] = uint32_t(v / divisor);
+            remainder = v % divisor;
+        }
+        trim(limbs);
+        return uint32_t(remainder);
+    }
+
+    bool from_power_of_two(StringRef digits, unsigned bits, std::vector<uint32_t> & limbs) {
+        limbs.reserve((digits.size() * bits + 31) / 32);
+        uint64_t pending = 0;
+        unsigned pending_bits = 0;
+        for(char const * it = digits.end(); it != digits.begin();) {
+            unsigned digit = digit_value(*--it);
+            if(digit >= (1u << bits)) {
+                return false;
+            }
+            pending |= uint64_t(digit) << pending_bits;
+            pending_bits += bits;
+            if(pending_bits >= 32) {
+                limbs.push_back(uint32_t(pending));
+                pending >>= 32;
+                pending_bits -= 32;
+            }
+        }
+        if(pending_bits) {
+            limbs.push_back(uint32_t(pending));
+        }
+        return true;
+    }
+
+    bool from_decimal(StringRef digits, std::vector<uint32_t> & limbs) {
+        // log2(10) < 3.33, 10 bits per 3 digits
+        limbs.reserve((digits.size() * 10 / 3) / 32 + 1);
+        std::size_t first = digits.size() % decimal_chunk_digits;
+        if(first == 0) {
+            first = decimal_chunk_digits;
+        }
+        char const * it = digits.begin();
+        for(std::size_t length = first; it != digits.end(); length = decimal_chunk_digits) {
+            uint32_t chunk = 0;
+            uint32_t factor = 1;
+            for(char const * end = it + length; it != end; ++it) {
+                if(*it < '0' || *it > '9') {
+                    return false;
+                }
+                chunk = chunk * 10 + uint32_t(*it - '0');
+                factor *= 10;
+            }
+            multiply_add(limbs, factor, chunk);
+        }
+        return true;
+    }
+
+#ifdef PYPA_WITH_GMP
+    bool from_decimal_gmp(StringRef digits, std::vector<uint32_t> & limbs) {
+        // GMP needs a NUL terminated string
+        mpz_t value;
+        if(mpz_init_set_str(value, digits.str().c_str(), 10) != 0) {
+            mpz_clear(value);
+            return false;
+        }
+        limbs.resize((mpz_sizeinbase(value, 2) + 31) / 32);
+        std::size_t count = 0;
+        mpz_export(&limbs[0], &count, -1, sizeof(uint32_t), 0, 0, value);
+        limbs.resize(count);
+        mpz_clear(value);
+        return true;
+    }
+
+    String to_decimal_gmp(std::vector<uint32_t> const & limbs) {
+        mpz_t value;
+        mpz_init(value);
+        mpz_import(value, limbs.size(), -1, sizeof(uint32_t), 0, 0, &limbs[0]);
+        String result(mpz_sizeinbase(value, 10) + 2, '\0');
+        mpz_get_str(&result[0], 10, value);
+        result.resize(std::strlen(result.c_str()));
+        mpz_clear(value);
+        return result;
+    }
+#endif
+}
+
+// Magnitude of the integer literal `digits` in `base` (2, 8, 10 or 16) as
+// limbs, see AstNumber::limbs. Fails for characters which are no digits of
+// `base`, no digits at all give no limbs
+bool limbs_from_digits(StringRef digits, int base, std::vector<uint32_t> & limbs) {
+    limbs.clear();
+#ifdef PYPA_WITH_GMP
+    if(base == 10 && digits.size() >= gmp_from_decimal_digits) {
+        return from_decimal_gmp(digits, limbs);
+    }
+#endif
+    bool ok = false;
+    switch(base) {
+    case 2:  ok = from_power_of_two(digits, 1, limbs); break;
+    case 8:  ok = from_power_of_two(digits, 3, limbs); break;
+    case 16: ok = from_power_of_two(digits, 4, limbs); break;
+    case 10: ok = from_decimal(digits, limbs); break;
+    default: break;
+    }
+    trim(limbs);
+    return ok;
+}
+
+// Decimal representation of the magnitude `limbs`
+String limbs_to_decimal(std::vector<uint32_t> const & limbs) {
+    if(limbs.empty()) {
+        return "0";
+    }
+#ifdef PYPA_WITH_GMP
+    if(limbs.size() >= gmp_to_decimal_limbs) {
+        return to_decimal_gmp(limbs);
+    }
+#endif
+    // Chunks of 9 digits, least significant first
+    std::vector<uint32_t> value = limbs;
+    std::vector<uint32_t> chunks;
+    chunks.reserve(limbs.size() * 32 / 29 + 1);
+    while(!value.empty()) {
+        chunks.push_back(divide(value, decimal_chunk));
+    }
+    String result = std::to_string(chunks.back());
+    for(std::size_t i = chunks.size() - 1; i-- > 0;) {
+        char buffer[decimal_chunk_digits];
+        for(unsigned j = decimal_chunk_digits; j-- > 0; chunks[i] /= 10) {
+            buffer[j] = char('0' + chunks[i] % 10);
+        }
+        result.append(buffer, decimal_chunk_digits);
+    }
+    return result;
+}
+
+}
@@ -28,15 +28,24 @@ inline bool islower(char c) {
     return (c >= 'a' && c <= 'z');
 }
 
-String make_string(String const & input, bool & unicode, bool & raw, bool ignore_escaping) {
+String make_string(StringRef input, bool & unicode, bool & raw, bool ignore_escaping) {
     String result;
-    size_t first_quote  = input.find_first_of("\"'");
-    assert(first_quote != String::npos);
+    size_t first_quote = 0;
+    while(first_quote < input.size() && input[first_quote] != '"' && input[first_quote] != '\'') {
+        ++first_quote;
+    }
+    assert(first_quote != input.size());
     char quote = input[first_quote];
-    size_t string_start = input.find_first_not_of(quote, first_quote);
+    size_t string_start = first_quote;
+    while(string_start < input.size() && input[string_start] == quote) {
+        ++string_start;
+    }
+    if(string_start == input.size()) {
+        string_start = String::npos;
+    }
 
-    char const * qst = input.c_str() + first_quote;
-    char const * tmp = input.c_str();
+    char const * qst = input.data() + first_quote;
+    char const * tmp = input.data();
 
     // bool bytes = false;
     raw = false;
@@ -69,8 +78,8 @@ String make_string(String const & input, bool & unicode, bool & raw, bool ignore
     size_t string_end =  input.size() - (string_start - first_quote);
     assert(string_end != String::npos && string_start <= string_end);
 
-    char const * s = input.c_str() + string_start;
-    char const * end = input.c_str() + string_end;
+    char const * s = input.data() + string_start;
+    char const * end = input.data() + string_end;
 
     std::back_insert_iterator<String> p((result));
 
@@ -0,0 +1,190 @@
+// Copyright 2014 Vinzenz Feenstra
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include <stdio.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <pypa/parser/parser.hh>
+
+// Test of the conversion of number literals
+//
+//   number-test            - parses `x = <literal>` for a table of integer,
+//                            long and float literals around the int64_t
+//                            limits and checks the resulting AstNumber, and
+//                            the limbs and sign of long literals
+
+namespace {
+    struct Case {
+        char const * literal;
+        pypa::AstNumber::Type type;
+        int64_t integer;     // Integer
+        char const * str;    // Long
+        double floating;     // Float
+    };
+
+    Case const cases[] = {
+        {"0",                        pypa::AstNumber::Integer, 0, "", 0},
+        {"1",                        pypa::AstNumber::Integer, 1, "", 0},
+        {"07",                       pypa::AstNumber::Integer, 7, "", 0},
+        {"0o17",                     pypa::AstNumber::Integer, 15, "", 0},
+        {"0XfF",                     pypa::AstNumber::Integer, 255, "", 0},
+        {"0b101",                    pypa::AstNumber::Integer, 5, "", 0},
+        {"9223372036854775807",      pypa::AstNumber::Integer, INT64_MAX, "", 0},
+        {"0x7fffffffffffffff",       pypa::AstNumber::Integer, INT64_MAX, "", 0},
+        {"9223372036854775808",      pypa::AstNumber::Long, 0, "9223372036854775808", 0},
+        {"0xffffffffffffffff",       pypa::AstNumber::Long, 0, "18446744073709551615", 0},
+        {"01000000000000000000000",  pypa::AstNumber::Long, 0, "9223372036854775808", 0},
+        {"123456789012345678901234567890", pypa::AstNumber::Long, 0, "123456789012345678901234567890", 0},
+        {"0L",                       pypa::AstNumber::Long, 0, "0", 0},
+        {"10l",                      pypa::AstNumber::Long, 0, "10", 0},
+        {"0xffL",                    pypa::AstNumber::Long, 0, "255", 0},
+        {"0b11L",                    pypa::AstNumber::Long, 0, "3", 0},
+        {"0777L",                    pypa::AstNumber::Long, 0, "511", 0},
+        {"99999999999999999999L",    pypa::AstNumber::Long, 0, "99999999999999999999", 0},
+        {"2.5",                      pypa::AstNumber::Float, 0, "", 2.5},
+        {".5",                       pypa::AstNumber::Float, 0, "", 0.5},
+        {"1e3",                      pypa::AstNumber::Float, 0, "", 1000.},
+        {"1.5e-3",                   pypa::AstNumber::Float, 0, "", 0.0015},
+    };
+
+    struct LongCase {
+        char const * literal;
+        bool inline_optimizations;
+        bool negative;
+        std::vector<uint32_t> limbs;
+        char const * str;
+    };
+
+    LongCase const long_cases[] = {
+        {"9223372036854775808",             false, false, {0, 0x80000000}, "9223372036854775808"},
+        {"0xffffffffffffffff",              false, false, {0xffffffff, 0xffffffff}, "18446744073709551615"},
+        {"0x100000000L",                    false, false, {0, 1}, "4294967296"},
+        {"0b100000000000000000000000000000000L", false, false, {0, 1}, "4294967296"},
+        {"123456789012345678901234567890",  false, false, {0x4e3f0ad2, 0xc373e0ee, 0x8ee90ff6, 1}, "123456789012345678901234567890"},
+        {"0L",                              false, false, {}, "0"},
+        {"0xffL",                           false, false, {255}, "255"},
+        {"-1L",                             true,  true,  {1}, "-1"},
+        {"-0x10000000000000000",            true,  true,  {0, 0, 1}, "-18446744073709551616"},
+        {"- -1L",                           true,  false, {1}, "--1"},
+        {"-0L",                             true,  false, {}, "-0"},
+    };
+
+    // Parses `x = <literal>`, the value has to be a number
+    bool parse_number(std::string const & literal, bool inline_optimizations, pypa::AstArena & arena,
+                      pypa::AstModulePtr & ast, pypa::AstNumberPtr & number) {
+        std::string source = "x = " + literal + "\n";
+        pypa::SymbolTablePtr symbols;
+        pypa::ParserOptions options;
+        options.printerrors = false;
+        options.perform_inline_optimizations = inline_optimizations;
+        options.arena = &arena;
+        pypa::Lexer lexer(source.data(), source.size(), "<test>");
+        if (!pypa::parse(lexer, ast, symbols, options) || ast->body->items.size() != 1) {
+            fprintf(stderr, "%s: doesn't parse\n", literal.c_str());
+            return false;
+        }
+        auto assign = pypa::ast_cast<pypa::AstAssign>(ast->body->items.front());
+        if (assign->type != pypa::AstType::Assign || assign->value->type != pypa::AstType::Number) {
+            fprintf(stderr, "%s: not a number\n", literal.c_str());
+            return false;
+        }
+        number = pypa::ast_cast<pypa::AstNumber>(assign->value);
+        return true;
+    }
+
+    bool check(Case const & c) {
+        pypa::AstArena arena;
+        pypa::AstModulePtr ast;
+        pypa::AstNumberPtr number;
+        if (!parse_number(c.literal, false, arena, ast, number)) {
+            return false;
+        }
+        pypa::AstNumber const & n = *number;
+        bool ok = n.num_type == c.type;
+        switch (c.type) {
+        case pypa::AstNumber::Integer:
+            ok = ok && n.integer == c.integer;
+            break;
+        case pypa::AstNumber::Long:
+            ok = ok && n.str == c.str;
+            break;
+        case pypa::AstNumber::Float:
+            ok = ok && n.floating == c.floating;
+            break;
+        }
+        if (!ok) {
+            fprintf(stderr, "%s: got type %d, integer %lld, str '%s', floating %g\n", c.literal,
+                    int(n.num_type), (long long)n.integer, n.str.c_str(), n.floating);
+        }
+        return ok;
+    }
+
+    bool check_long(LongCase const & c) {
+        pypa::AstArena arena;
+        pypa::AstModulePtr ast;
+        pypa::AstNumberPtr number;
+        if (!parse_number(c.literal, c.inline_optimizations, arena, ast, number)) {
+            return false;
+        }
+        pypa::AstNumber const & n = *number;
+        if (n.num_type != pypa::AstNumber::Long || n.negative != c.negative || n.limbs != c.limbs || n.str != c.str) {
+            fprintf(stderr, "%s: got type %d, negative %d, %d limbs, str '%s'\n", c.literal,
+                    int(n.num_type), int(n.negative), int(n.limbs.size()), n.str.c_str());
+            return false;
+        }
+        return true;
+    }
+
+    // 2**2400 in hex and in decimal, long enough to be converted by GMP if
+    // it's used
+    bool check_round_trip() {
+        std::string hex = "0x1" + std::string(600, '0');
+        std::vector<uint32_t> limbs(76, 0);
+        limbs.back() = 1;
+        pypa::AstArena arena;
+        pypa::AstModulePtr ast;
+        pypa::AstNumberPtr from_hex, from_decimal;
+        if (!parse_number(hex, false, arena, ast, from_hex)) {
+            return false;
+        }
+        std::string decimal = from_hex->str;
+        pypa::AstModulePtr ast2;
+        if (!parse_number(decimal, false, arena, ast2, from_decimal)) {
+            return false;
+        }
+        bool ok = from_hex->limbs == limbs && from_decimal->limbs == limbs
+               && decimal.size() == 723 && decimal.compare(0, 10, "2964760347") == 0
+               && decimal.compare(713, 10, "9389413376") == 0 && from_decimal->str == decimal;
+        if (!ok) {
+            fprintf(stderr, "2**2400: got %d and %d limbs, str '%s'\n", int(from_hex->limbs.size()),
+                    int(from_decimal->limbs.size()), decimal.c_str());
+        }
+        return ok;
+    }
+}
+
+int main() {
+    int failures = 0;
+    for (Case const & c : cases) {
+        failures += check(c) ? 0 : 1;
+    }
+    for (LongCase const & c : long_cases) {
+        failures += check_long(c) ? 0 : 1;
+    }
+    failures += check_round_trip() ? 0 : 1;
+    printf("%d literals, %d failures\n",
+           int(sizeof(cases) / sizeof(cases[0]) + sizeof(long_cases) / sizeof(long_cases[0]) + 1), failures);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,446 @@
+// Copyright 2014 Vinzenz Feenstra
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <vector>
+
+#include <pypa/parser/parse_cache.hh>
+#include <pypa/parser/serialize.hh>
+
+#if defined(WIN32)
+#include <direct.h>
+#include <io.h>
+#include <process.h>
+#include <sys/utime.h>
+#else
+#include <dirent.h>
+#include <unistd.h>
+#include <utime.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#endif
+
+namespace pypa {
+namespace {
+    // Kept in line with AC_INIT in configure.ac
+    char const LibraryVersion[] = "0.1";
+    char const Extension[] = ".pypa-cache";
+
+    // An entry is an EntryHeader followed by the result of serialize(). The
+    // header has the whole key, a hit doesn't rely on the file name alone
+    struct EntryHeader {
+        char magic[8];
+        unsigned char source[ParseCache::DigestSize];
+        unsigned char options[ParseCache::DigestSize];
+        std::uint64_t length;
+        std::uint64_t payload;          // Hash of the serialized result
+        std::uint64_t payload_length;
+    };
+
+    // Changed with the layout of EntryHeader
+    char const EntryMagic[8] = {'p', 'y', 'p', 'a', 'c', 'a', 'c', '2'};
+
+    // SHA-256, for the key. Entries must not be mixed up with the ones of
+    // another source, which a 64 bit hash can't rule out
+    class Sha256 {
+    public:
+        Sha256()
+        : state_{0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19}
+        , block_{}
+        , used_(0)
+        , length_(0)
+        {}
+
+        void update(char const * data, std::size_t length) {
+            length_ += length;
+            while(length) {
+                std::size_t n = std::min(length, sizeof(block_) - used_);
+                std::memcpy(block_ + used_, data, n);
+                used_ += n;
+                data += n;
+                length -= n;
+                if(used_ == sizeof(block_)) {
+                    compress(block_);
+                    used_ = 0;
+                }
+            }
+        }
+
+        void finish(unsigned char (&digest)[ParseCache::DigestSize]) {
+            std::uint64_t bits = length_ * 8;
+            block_[used_++] = 0x80;
+            if(used_ > 56) {
+                std::memset(block_ + used_, 0, sizeof(block_) - used_);
+                compress(block_);
+                used_ = 0;
+            }
+            std::memset(block_ + used_, 0, 56 - used_);
+            for(int i = 0; i < 8; ++i) {
+                block_[63 - i] = (unsigned char)(bits >> (8 * i));
+            }
+            compress(block_);
+            for(int i = 0; i < 32; ++i) {
+                digest[i] = (unsigned char)(state_[i / 4] >> (24 - 8 * (i % 4)));
+            }
+        }
+
+    private:
+        static std::uint32_t rotr(std::uint32_t x, int n) {
+            return (x >> n) | (x << (32 - n));
+        }
+
+        void compress(unsigned char const * block) {
+            static std::uint32_t const k[64] = {
+                0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+                0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+                0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+                0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+                0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+                0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+                0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+                0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+            };
+            std::uint32_t w[64];
+            for(int i = 0; i < 16; ++i) {
+                w[i] = std::uint32_t(block[4 * i]) << 24 | std::uint32_t(block[4 * i + 1]) << 16
+                     | std::uint32_t(block[4 * i + 2]) << 8 | std::uint32_t(block[4 * i + 3]);
+            }
+            for(int i = 16; i < 64; ++i) {
+                std::uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+                std::uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+                w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+            }
+            std::uint32_t v[8];
+            std::memcpy(v, state_, sizeof(v));
+            for(int i = 0; i < 64; ++i) {
+                std::uint32_t s1 = rotr(v[4], 6) ^ rotr(v[4], 11) ^ rotr(v[4], 25);
+                std::uint32_t ch = (v[4] & v[5]) ^ (~v[4] & v[6]);
+                std::uint32_t t1 = v[7] + s1 + ch + k[i] + w[i];
+                std::uint32_t s0 = rotr(v[0], 2) ^ rotr(v[0], 13) ^ rotr(v[0], 22);
+                std::uint32_t maj = (v[0] & v[1]) ^ (v[0] & v[2]) ^ (v[1] & v[2]);
+                std::memmove(v + 1, v, 7 * sizeof(v[0]));
+                v[4] += t1;
+                v[0] = t1 + s0 + maj;
+            }
+            for(int i = 0; i < 8; ++i) {
+                state_[i] += v[i];
+            }
+        }
+
+    private:
+        std::uint32_t state_[8];
+        unsigned char block_[64];
+        std::size_t used_;
+        std::uint64_t length_;
+    };
+
+    void digest(char const * data, std::size_t length,
+                unsigned char (&out)[ParseCache::DigestSize]) {
+        Sha256 sha;
+        sha.update(data, length);
+        sha.finish(out);
+    }
+
+    // MurmurHash64A
+    std::uint64_t hash_bytes(char const * data, std::size_t length, std::uint64_t seed) {
+        std::uint64_t const m = 0xc6a4a7935bd1e995ULL;
+        int const r = 47;
+        std::uint64_t h = seed ^ (length * m);
+        char const * end = data + (length & ~std::size_t(7));
+        for(; data != end; data += 8) {
+            std::uint64_t k;
+            std::memcpy(&k, data, sizeof(k));
+            k *= m;
+            k ^= k >> r;
+            k *= m;
+            h ^= k;
+            h *= m;
+        }
+        std::size_t tail = length & 7;
+        if(tail) {
+            for(std::size_t i = 0; i < tail; ++i) {
+                h ^= std::uint64_t(static_cast<unsigned char>(data[i])) << (8 * i);
+            }
+            h *= m;
+        }
+        h ^= h >> r;
+        h *= m;
+        h ^= h >> r;
+        return h;
+    }
+
+    struct CacheFile {
+        std::string path;
+        std::uint64_t size;
+        std::time_t used;
+    };
+
+    bool has_extension(char const * name) {
+        std::size_t length = std::strlen(name);
+        std::size_t ext = sizeof(Extension) - 1;
+        return length > ext && std::strcmp(name + length - ext, Extension) == 0;
+    }
+
+    std::vector<CacheFile> list_files(std::string const & directory) {
+        std::vector<CacheFile> files;
+#if defined(WIN32)
+        struct _finddata64_t info;
+        intptr_t handle = _findfirst64((directory + "/*" + Extension).c_str(), &info);
+        if(handle == -1) {
+            return files;
+        }
+        do {
+            if(has_extension(info.name)) {
+                files.push_back({directory + "/" + info.name, std::uint64_t(info.size), std::time_t(info.time_write)});
+            }
+        } while(_findnext64(handle, &info) == 0);
+        _findclose(handle);
+#else
+        DIR * dir = ::opendir(directory.c_str());
+        if(!dir) {
+            return files;
+        }
+        while(struct dirent * e = ::readdir(dir)) {
+            if(!has_extension(e->d_name)) {
+                continue;
+            }
+            std::string path = directory + "/" + e->d_name;
+            struct stat st{};
+            if(::stat(path.c_str(), &st) == 0) {
+                files.push_back({path, std::uint64_t(st.st_size), st.st_mtime});
+            }
+        }
+        ::closedir(dir);
+#endif
+        return files;
+    }
+
+    bool read_file(std::string const & path, std::string & data) {
+        FILE * f = std::fopen(path.c_str(), "rb");
+        if(!f) {
+            return false;
+        }
+        bool ok = std::fseek(f, 0, SEEK_END) == 0;
+        long size = ok ? std::ftell(f) : -1;
+        ok = size >= 0 && std::fseek(f, 0, SEEK_SET) == 0;
+        if(ok) {
+            data.resize(std::size_t(size));
+            ok = std::fread(&data[0], 1, data.size(), f) == data.size();
+        }
+        std::fclose(f);
+        return ok;
+    }
+
+    bool write_file(std::string const & path, std::string const & data) {
+        FILE * f = std::fopen(path.c_str(), "wb");
+        if(!f) {
+            return false;
+        }
+        bool ok = std::fwrite(data.data(), 1, data.size(), f) == data.size();
+        ok = std::fclose(f) == 0 && ok;
+        if(!ok) {
+            std::remove(path.c_str());
+        }
+        return ok;
+    }
+
+    // Marks the entry as used for the eviction order
+    void touch(std::string const & path) {
+#if defined(WIN32)
+        _utime(path.c_str(), 0);
+#else
+        ::utime(path.c_str(), 0);
+#endif
+    }
+
+    unsigned long process_id() {
+#if defined(WIN32)
+        return (unsigned long)_getpid();
+#else
+        return (unsigned long)::getpid();
+#endif
+    }
+}
+
+ParseCache::ParseCache(std::string directory, std::uint64_t max_size)
+: directory_(std::move(directory))
+, max_size_(max_size)
+, mutex_()
+, size_(0)
+, temp_counter_(0)
+, hits_(0)
+, misses_(0)
+, stores_(0)
+, evictions_(0)
+{
+#if defined(WIN32)
+    _mkdir(directory_.c_str());
+#else
+    ::mkdir(directory_.c_str(), 0777);
+#endif
+    for(auto const & f : list_files(directory_)) {
+        size_ += f.size;
+    }
+}
+
+bool ParseCache::make_key(char const * data, std::size_t length,
+                          ParserOptions const & options, Key & key) {
+    // The output of a custom escape handler can't be part of the key
+    if(options.escape_handler) {
+        return false;
+    }
+    FutureFeatures const & f = options.initial_future_features;
+    char buffer[128];
+    int size = std::snprintf(buffer, sizeof(buffer), "%s %u %d%d%d%d%d%d %d%d%d%d%d%d%d %d",
+                             LibraryVersion, unsigned(SerializeFormatVersion),
+                             options.python3only, options.python3allowed, options.docstrings,
+                             options.handle_future_errors, options.perform_inline_optimizations,
+                             options.lazy_bodies,
+                             f.nested_scopes, f.generators, f.division, f.absolute_imports,
+                             f.with_statement, f.print_function, f.unicode_literals, f.last_line);
+    digest(data, length, key.source);
+    key.length = length;
+    digest(buffer, std::size_t(size), key.options);
+    return true;
+}
+
+std::string ParseCache::path(Key const & key) const {
+    // The whole source digest and a part of the options one, load() compares
+    // both in full
+    char name[2 * DigestSize + 18];
+    char * p = name;
+    *p++ = '/';
+    for(unsigned char c : key.source) {
+        p += std::snprintf(p, 3, "%02x", c);
+    }
+    *p++ = '-';
+    for(std::size_t i = 0; i < 8; ++i) {
+        p += std::snprintf(p, 3, "%02x", key.options[i]);
+    }
+    return directory_ + name + Extension;
+}
+
+bool ParseCache::load(Key const & key, String const & name, AstArena * arena,
+                      AstModulePtr & ast, SymbolTablePtr & symbols) {
+    std::string file = path(key);
+    std::string data;
+    EntryHeader header;
+    bool ok = read_file(file, data) && data.size() >= sizeof(header);
+    if(ok) {
+        std::memcpy(&header, data.data(), sizeof(header));
+        char const * payload = data.data() + sizeof(header);
+        std::size_t length = data.size() - sizeof(header);
+        ok = std::memcmp(header.magic, EntryMagic, sizeof(EntryMagic)) == 0
+          && std::memcmp(header.source, key.source, DigestSize) == 0
+          && std::memcmp(header.options, key.options, DigestSize) == 0
+          && header.length == key.length
+          && header.payload_length == length
+          && header.payload == hash_bytes(payload, length, 0)
+          && deserialize(payload, length, name, arena, ast, symbols);
+        if(!ok) {
+            // Truncated, from another version or from another key with the
+            // same file name, it's replaced by the next store
+            std::remove(file.c_str());
+        }
+    }
+    if(!ok) {
+        ++misses_;
+        return false;
+    }
+    touch(file);
+    ++hits_;
+    return true;
+}
+
+bool ParseCache::store(Key const & key, AstModule const & ast, SymbolTable const & symbols) {
+    EntryHeader header;
+    std::string data(sizeof(header), '\0');
+    serialize(ast, symbols, data);
+    std::memcpy(header.magic, EntryMagic, sizeof(EntryMagic));
+    std::memcpy(header.source, key.source, DigestSize);
+    std::memcpy(header.options, key.options, DigestSize);
+    header.length = key.length;
+    header.payload_length = data.size() - sizeof(header);
+    header.payload = hash_bytes(data.data() + sizeof(header), data.size() - sizeof(header), 0);
+    std::memcpy(&data[0], &header, sizeof(header));
+
+    std::string file = path(key);
+    std::uint64_t counter = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        counter = temp_counter_++;
+    }
+    char suffix[64];
+    std::snprintf(suffix, sizeof(suffix), ".%lu-%llu.tmp", process_id(), (unsigned long long)counter);
+    std::string temp = file + suffix;
+    if(!write_file(temp, data)) {
+        return false;
+    }
+#if defined(WIN32)
+    std::remove(file.c_str());
+#endif
+    if(std::rename(temp.c_str(), file.c_str()) != 0) {
+        std::remove(temp.c_str());
+        return false;
+    }
+    ++stores_;
+
+    bool full = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        size_ += data.size();
+        full = max_size_ && size_ > max_size_;
+    }
+    if(full) {
+        // Leaves some room, so not every store has to scan the directory
+        trim(max_size_ - max_size_ / 8);
+    }
+    return true;
+}
+
+void ParseCache::trim(std::uint64_t size) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<CacheFile> files = list_files(directory_);
+    std::sort(files.begin(), files.end(), [](CacheFile const & a, CacheFile const & b) {
+        return a.used < b.used;
+    });
+    std::uint64_t total = 0;
+    for(auto const & f : files) {
+        total += f.size;
+    }
+    for(auto const & f : files) {
+        if(total <= size) {
+            break;
+        }
+        if(std::remove(f.path.c_str()) == 0) {
+            total -= f.size;
+            ++evictions_;
+        }
+    }
+    size_ = total;
+}
+
+std::uint64_t ParseCache::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return size_;
+}
+
+ParseCache::Stats ParseCache::stats() const {
+    return {hits_.load(), misses_.load(), stores_.load(), evictions_.load()};
+}
+
+}
@@ -0,0 +1,97 @@
+// Copyright 2014 Vinzenz Feenstra
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#ifndef GUARD_PYPA_PARSER_PARSE_CACHE_HH_INCLUDED
+#define GUARD_PYPA_PARSER_PARSE_CACHE_HH_INCLUDED
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+#include <pypa/parser/parser.hh>
+
+namespace pypa {
+
+// Persistent cache of parse results in a directory, keyed by a digest of the
+// source, the ParserOptions affecting the result and the library version.
+// parse() uses it when ParserOptions::cache is set: on a hit the AST and the
+// symbol table are read from the cache without lexing or parsing, otherwise
+// the result is stored after parsing. Only sources the reader keeps in memory
+// (MMapReader, BufferReader) and parses without errors or warnings are
+// cached, parses with an escape_handler aren't cached at all.
+//
+// A cache can be shared between threads (e.g. parse_many() workers) and
+// processes, entries are written to a temporary file first and renamed.
+class ParseCache {
+public:
+    static std::size_t const DigestSize = 32;
+
+    // The digests are SHA-256, the entry stores them to be compared on load
+    struct Key {
+        unsigned char source[DigestSize];   // Digest of the source
+        std::uint64_t length;               // Length of the source
+        unsigned char options[DigestSize];  // Digest of the options and version
+    };
+
+    struct Stats {
+        std::uint64_t hits;
+        std::uint64_t misses;
+        std::uint64_t stores;
+        std::uint64_t evictions;
+    };
+
+    // Keeps the entries in `directory`, which is created if it doesn't
+    // exist. If `max_size` isn't 0 the least recently used entries are
+    // removed when the entries take up more than `max_size` bytes.
+    explicit ParseCache(std::string directory, std::uint64_t max_size = 0);
+
+    ParseCache(ParseCache const &) = delete;
+    ParseCache & operator=(ParseCache const &) = delete;
+
+    // Computes the key for parsing `data` with `options`, returns false if
+    // the result can't be cached
+    static bool make_key(char const * data, std::size_t length,
+                         ParserOptions const & options, Key & key);
+
+    // Reads the entry of `key`, see deserialize() for `name` and `arena`
+    bool load(Key const & key, String const & name, AstArena * arena,
+              AstModulePtr & ast, SymbolTablePtr & symbols);
+    bool store(Key const & key, AstModule const & ast, SymbolTable const & symbols);
+
+    // Removes the least recently used entries until the cache takes up at
+    // most `size` bytes
+    void trim(std::uint64_t size);
+
+    std::string const & directory() const { return directory_; }
+    std::uint64_t size() const;
+    Stats stats() const;
+
+private:
+    std::string path(Key const & key) const;
+
+private:
+    std::string directory_;
+    std::uint64_t max_size_;
+    mutable std::mutex mutex_;
+    std::uint64_t size_;            // Approximate, corrected by trim()
+    std::uint64_t temp_counter_;
+    std::atomic<std::uint64_t> hits_;
+    std::atomic<std::uint64_t> misses_;
+    std::atomic<std::uint64_t> stores_;
+    std::atomic<std::uint64_t> evictions_;
+};
+
+}
+
+#endif // GUARD_PYPA_PARSER_PARSE_CACHE_HH_INCLUDED
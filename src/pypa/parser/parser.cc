@@ -12,23 +12,34 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <algorithm>
 #include <cassert>
 #include <cstddef>
-
-#include <gmp.h>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <set>
+#include <string>
+#include <vector>
 
 #include <pypa/parser/apply.hh>
 #include <pypa/parser/parser_fwd.hh>
 #include <double-conversion/src/double-conversion.h>
 #include <pypa/ast/context_assign.hh>
+#include <pypa/ast/tree_walker.hh>
+#include <pypa/buffer_reader.hh>
+#include <pypa/parser/first_sets.hh>
+#include <pypa/parser/parse_cache.hh>
 
 namespace pypa {
 
-String make_string(String const & input, bool & unicode, bool & raw, bool ignore_escaping);
+String make_string(StringRef input, bool & unicode, bool & raw, bool ignore_escaping);
+bool limbs_from_digits(StringRef digits, int base, std::vector<uint32_t> & limbs);
+String limbs_to_decimal(std::vector<uint32_t> const & limbs);
 
 template< typename Container >
 void flatten(AstStmt s, Container & target) {
-    for(auto e : std::static_pointer_cast<AstSuite>(s)->items) {
+    for(auto e : ast_cast<AstSuite>(s)->items) {
         if(e && e->type == AstType::Suite) {
             flatten(e, target);
         }
@@ -39,13 +50,13 @@ void flatten(AstStmt s, Container & target) {
 }
 
 template<typename T>
-AstPtr error_transform(std::shared_ptr<T> const & t) {
+AstPtr error_transform(State & s, AstPtrT<T> const & t) {
     return t;
 }
 
 template<typename T>
-AstPtr error_transform(T const & t) {
-    return std::make_shared<T>(t);
+AstPtr error_transform(State & s, T const & t) {
+    return make_ast<T>(s.options.arena, t);
 }
 
 void report_error(State & s) {
@@ -71,7 +82,7 @@ void report_error(State & s) {
 
 #if 0
 void add_symbol_error(State & s, char const * message, int line, int column, int reported_line, char const * reported_file_name, char const * reported_function) {
-    TokenInfo ti = s.tok_cur;
+    TokenInfo ti = top(s);
     ti.line = line;
     ti.column = column;
     s.errors.push({ErrorType::SyntaxError, message, s.lexer->get_name(), ti, {}, s.lexer->get_line(line), reported_line, reported_file_name, reported_function });
@@ -100,55 +111,108 @@ void indentation_error_dbg(State & s, AstPtr ast, int line = -1, char const * fi
 }
 
 #ifdef _WIN32
-#define syntax_error(s, AST_ITEM, msg) syntax_error_dbg(s, error_transform(AST_ITEM), msg, __LINE__, __FILE__, __func__)
-#define indentation_error(s, AST_ITEM) indentation_error_dbg(s, error_transform(AST_ITEM), __LINE__, __FILE__, __func__)
+#define syntax_error(s, AST_ITEM, msg) syntax_error_dbg(s, error_transform(s, AST_ITEM), msg, __LINE__, __FILE__, __func__)
+#define indentation_error(s, AST_ITEM) indentation_error_dbg(s, error_transform(s, AST_ITEM), __LINE__, __FILE__, __func__)
 #else
-#define syntax_error(s, AST_ITEM, msg) syntax_error_dbg(s, error_transform(AST_ITEM), msg, __LINE__, __FILE__, __PRETTY_FUNCTION__)
-#define indentation_error(s, AST_ITEM) indentation_error_dbg(s, error_transform(AST_ITEM), __LINE__, __FILE__, __PRETTY_FUNCTION__)
+#define syntax_error(s, AST_ITEM, msg) syntax_error_dbg(s, error_transform(s, AST_ITEM), msg, __LINE__, __FILE__, __PRETTY_FUNCTION__)
+#define indentation_error(s, AST_ITEM) indentation_error_dbg(s, error_transform(s, AST_ITEM), __LINE__, __FILE__, __PRETTY_FUNCTION__)
 #endif
 
+// Value of the integer literal `digits` in `base` if it fits into int64_t.
+// The lexer only produces valid digits, other characters just make it fail.
+bool int64_from_base(StringRef digits, int base, int64_t & result) {
+    char const * it = digits.begin();
+    bool negative = it != digits.end() && *it == '-';
+    it += negative ? 1 : 0;
+    if(it == digits.end()) {
+        return false;
+    }
+    uint64_t const limit = uint64_t(INT64_MAX) + (negative ? 1 : 0);
+    uint64_t value = 0;
+    for(; it != digits.end(); ++it) {
+        unsigned digit = unsigned(base);
+        if(*it >= '0' && *it <= '9') {
+            digit = unsigned(*it - '0');
+        }
+        else if(*it >= 'a' && *it <= 'f') {
+            digit = unsigned(*it - 'a' + 10);
+        }
+        else if(*it >= 'A' && *it <= 'F') {
+            digit = unsigned(*it - 'A' + 10);
+        }
+        if(digit >= unsigned(base) || value > (limit - digit) / unsigned(base)) {
+            return false;
+        }
+        value = value * unsigned(base) + digit;
+    }
+    result = negative ? -int64_t(value - 1) - 1 : int64_t(value);
+    return true;
+}
+
 bool number_from_base(int64_t base, State & s, AstNumberPtr & ast) {
-    String const & value = top(s).value;
+    StringRef value = top(s).value;
     AstNumber & result = *ast;
 
-    MP_INT integ;
-    mpz_init_set_str(&integ, value.c_str(), base);
-
-    result.num_type = AstNumber::Integer;
-    pop(s);
-    bool long_post_fix = (top(s).value == "L" || top(s).value == "l");
-    if(!long_post_fix) {
-        unpop(s);
+    // The lexer keeps the suffix of long integers, see Lexer::get_long_suffix
+    bool long_post_fix = !value.empty() && (value[value.size() - 1] == 'L' || value[value.size() - 1] == 'l');
+    if(long_post_fix) {
+        value = StringRef(value.data(), value.size() - 1);
     }
-    if(long_post_fix || !mpz_fits_slong_p(&integ)) {
-        result.num_type = AstNumber::Long;
+
+    int64_t integer = 0;
+    if(!long_post_fix && int64_from_base(value, int(base), integer)) {
+        result.num_type = AstNumber::Integer;
+        result.integer = integer;
+        return true;
     }
 
-    if(result.num_type == AstNumber::Long) {
-        result.str.resize(mpz_sizeinbase(&integ, 10) + 2, 0);
-        mpz_get_str(&result.str[0], 10, &integ);
+    // Too large for int64_t or with the suffix
+    result.negative = !value.empty() && value[0] == '-';
+    StringRef digits = result.negative ? StringRef(value.data() + 1, value.size() - 1) : value;
+    if(!limbs_from_digits(digits, int(base), result.limbs)) {
+        result.limbs.clear();
+    }
+    if(result.limbs.empty()) {
+        result.negative = false;
+        if(!long_post_fix) {
+            // No digits at all, e.g. `0o`
+            result.num_type = AstNumber::Integer;
+            result.integer = 0;
+            return true;
+        }
+    }
+    result.num_type = AstNumber::Long;
+    if(base == 10 && !result.limbs.empty()) {
+        // Decimal digits can be taken as they are
+        while(digits.size() > 1 && digits[0] == '0') {
+            digits = StringRef(digits.data() + 1, digits.size() - 1);
+        }
+        result.str = digits.str();
     }
     else {
-        result.integer = mpz_get_si(&integ);
+        result.str = limbs_to_decimal(result.limbs);
+    }
+    if(result.negative) {
+        result.str.insert(result.str.begin(), '-');
     }
-    mpz_clear(&integ);
     return true;
 }
 
-bool string_to_double(String const & s, double & result) {
-    double_conversion::StringToDoubleConverter conv(0, 0.0, 0.0, 0, 0);
+bool string_to_double(StringRef s, double & result) {
+    // Has no state, StringToDouble() is const
+    static double_conversion::StringToDoubleConverter const conv(0, 0.0, 0.0, 0, 0);
     int length = int(s.size());
     int processed = 0;
-    result = conv.StringToDouble(s.c_str(), length, &processed);
+    result = conv.StringToDouble(s.data(), length, &processed);
     return length == processed;
 }
 
 bool number(State & s, AstNumberPtr & ast) {
     StateGuard guard(s, ast);
-    location(s, create(ast));
+    location(s, create(s, ast));
     int base = 0;
     if(is(s, Token::NumberFloat)) {
-        String const & dstr = top(s).value;
+        StringRef dstr = top(s).value;
         double result = 0;
         if(!string_to_double(dstr, result)) {
             syntax_error(s, ast, "Invalid floating point number");
@@ -178,10 +242,22 @@ bool number(State & s, AstNumberPtr & ast) {
     return false;
 }
 
+bool python3(State & s) {
+    return s.options.python3allowed || s.options.python3only;
+}
+
+bool starts_atom(State & s) {
+    return starts_atom(top(s), python3(s));
+}
+
+bool starts_test(State & s) {
+    return starts_test(top(s), python3(s));
+}
+
 bool get_name(State & s, AstExpr & ast) {
     StateGuard guard(s, ast);
     AstNamePtr name;
-    location(s, create(name));
+    location(s, create(s, name));
     ast = name;
     if(consume_value(s, Token::Identifier, name->id)) {
         return guard.commit();
@@ -189,53 +265,237 @@ bool get_name(State & s, AstExpr & ast) {
     return false;
 }
 
-template< typename Fun >
-bool generic_binop_expr(State & s, AstExpr & ast, TokenKind op, AstBinOpType op_type, Fun fun) {
-    StateGuard guard(s, ast);
-    if(fun(s, ast)) {
-        while(expect(s, op)) {
-            AstBinOpPtr bin;
-            location(s, create(bin));
-            bin->left = ast;
-            bin->op = op_type;
-            ast = bin;
-            if(!fun(s, bin->right)) {
-                syntax_error(s, ast, "Expected expression after operator");
-            }
-        }
-        return guard.commit();
+// Binding strength of the binary operators, weakest first. Each one stands
+// for the grammar rule the operator belongs to, from or_test down to term.
+// The operands of term are parsed by factor().
+enum class Precedence {
+    Or,         // or_test
+    And,        // and_test
+    Not,        // not_test, prefix only
+    Comparison, // comparison
+    BitOr,      // expr
+    BitXor,     // xor_expr
+    BitAnd,     // and_expr
+    Shift,      // shift_expr
+    Arith,      // arith_expr
+    Term        // term
+};
+
+// Precedence of the binary operator at the current token. `not` is taken as
+// a comparison operator here, comp_op() checks for the `in` following it.
+bool binary_operator(State & s, Precedence & precedence) {
+    switch(kind(top(s))) {
+    case TokenKind::Star:
+    case TokenKind::Slash:
+    case TokenKind::Percent:
+    case TokenKind::DoubleSlash:
+        precedence = Precedence::Term;
+        return true;
+    case TokenKind::Plus:
+    case TokenKind::Minus:
+        precedence = Precedence::Arith;
+        return true;
+    case TokenKind::LeftShift:
+    case TokenKind::RightShift:
+        precedence = Precedence::Shift;
+        return true;
+    case TokenKind::BinAnd:
+        precedence = Precedence::BitAnd;
+        return true;
+    case TokenKind::CircumFlex:
+        precedence = Precedence::BitXor;
+        return true;
+    case TokenKind::BinOr:
+        precedence = Precedence::BitOr;
+        return true;
+    case TokenKind::Less:
+    case TokenKind::Greater:
+    case TokenKind::EqualEqual:
+    case TokenKind::GreaterEqual:
+    case TokenKind::LessEqual:
+    case TokenKind::NotEqual:
+        precedence = Precedence::Comparison;
+        return true;
+    default:
+        break;
+    }
+    switch(token(top(s))) {
+    case Token::KeywordIn:
+    case Token::KeywordNot:
+    case Token::KeywordIs:
+        precedence = Precedence::Comparison;
+        return true;
+    case Token::KeywordAnd:
+        precedence = Precedence::And;
+        return true;
+    case Token::KeywordOr:
+        precedence = Precedence::Or;
+        return true;
+    default:
+        break;
     }
     return false;
 }
 
-template< typename Fun >
-bool generic_boolop_expr(State & s, AstExpr & ast, Token op, AstBoolOpType op_type, Fun fun) {
+bool operator_expr(State & s, AstExpr & ast, Precedence level);
+
+// Right hand side of an operator of `precedence`, everything binding tighter
+bool operand(State & s, AstExpr & ast, Precedence precedence) {
+    if(precedence == Precedence::Term) {
+        return factor(s, ast);
+    }
+    return operator_expr(s, ast, Precedence(int(precedence) + 1));
+}
+
+// Precedence climbing over the rules from or_test down to term, which each
+// used to be entered for every operand. Operators binding weaker than
+// `level` are left to the caller. The trees, node locations and reported
+// errors are the ones of the grammar rules.
+bool operator_expr(State & s, AstExpr & ast, Precedence level) {
     StateGuard guard(s, ast);
-    if(fun(s, ast)) {
-        if(is(s, op)) {
+    // Strongest operator that may follow, operands of weaker operators
+    // stop at stronger ones they failed to parse
+    Precedence strongest = Precedence::Term;
+    if(level <= Precedence::Not && is(s, Token::KeywordNot)) {
+        // expect(s, Token::KeywordNot) not_test
+        AstUnaryOpPtr unary;
+        location(s, create(s, unary));
+        pop(s);
+        unary->op = AstUnaryOpType::Not;
+        if(!operator_expr(s, unary->operand, Precedence::Not)) {
+            return false;
+        }
+        ast = unary;
+        strongest = Precedence::Not;
+    }
+    else if(!factor(s, ast)) {
+        return false;
+    }
+
+    Precedence precedence;
+    while(binary_operator(s, precedence) && precedence >= level && precedence <= strongest) {
+        strongest = precedence;
+        if(precedence == Precedence::Or || precedence == Precedence::And) {
+            // and_test (expect(s, Token::KeywordOr) and_test)*
+            // not_test (expect(s, Token::KeywordAnd) not_test)*
+            Token op = precedence == Precedence::Or ? Token::KeywordOr : Token::KeywordAnd;
             AstBoolOpPtr p;
-            location(s, create(p));
+            location(s, create(s, p));
             p->values.push_back(ast);
-            p->op = op_type;
+            p->op = precedence == Precedence::Or ? AstBoolOpType::Or : AstBoolOpType::And;
             ast = p;
             while(expect(s, op)) {
                 AstExpr tmp;
-                if(!fun(s, tmp)) {
+                if(!operand(s, tmp, precedence)) {
                     syntax_error(s, ast, "Expected expression after operator");
                     return false;
                 }
                 p->values.push_back(tmp);
             }
         }
-        return guard.commit();
+        else if(precedence == Precedence::Comparison) {
+            // expr (comp_op expr)*
+            AstCompareOpType op;
+            AstComparePtr ptr;
+            clone_location(ast, create(s, ptr));
+            ptr->left = ast;
+            ast = ptr;
+            while(comp_op(s, op)) {
+                ptr->operators.push_back(op);
+                AstExpr right;
+                if(!operand(s, right, precedence)) {
+                    syntax_error(s, ast, "Expected expression after comparison operator");
+                    return false;
+                }
+                ptr->comparators.push_back(right);
+            }
+            if(ptr->operators.empty()) {
+                // `not` without `in`
+                ast = ptr->left;
+                break;
+            }
+        }
+        else if(precedence <= Precedence::BitAnd) {
+            // xor_expr (expect(s, TokenKind::BinOr) xor_expr)*
+            // and_expr (expect(s, TokenKind::CircumFlex) and_expr)*
+            // shift_expr (expect(s, TokenKind::BinAnd) shift_expr)*
+            pop(s);
+            AstBinOpPtr bin;
+            location(s, create(s, bin));
+            bin->left = ast;
+            bin->op = precedence == Precedence::BitOr  ? AstBinOpType::BitOr
+                    : precedence == Precedence::BitXor ? AstBinOpType::BitXor
+                    : AstBinOpType::BitAnd;
+            ast = bin;
+            if(!operand(s, bin->right, precedence)) {
+                syntax_error(s, ast, "Expected expression after operator");
+            }
+        }
+        else if(precedence == Precedence::Shift) {
+            // arith_expr ((expect(s, TokenKind::LeftShift)||expect(s, TokenKind::RightShift)) arith_expr)*
+            AstBinOpPtr bin;
+            location(s, create(s, bin));
+            bin->left = ast;
+            bin->op = is(s, TokenKind::LeftShift) ? AstBinOpType::LeftShift : AstBinOpType::RightShift;
+            ast = bin;
+            pop(s);
+            if(!operand(s, bin->right, precedence)) {
+                syntax_error(s, ast, "Expected expression");
+                return false;
+            }
+        }
+        else if(precedence == Precedence::Arith) {
+            // term ((expect(s, TokenKind::Plus)||expect(s, TokenKind::Minus)) term)*
+            AstBinOpPtr ptr;
+            location(s, create(s, ptr));
+            ptr->left = ast;
+            ptr->op = is(s, TokenKind::Plus) ? AstBinOpType::Add : AstBinOpType::Sub;
+            ast = ptr;
+            pop(s);
+            if(!operand(s, ptr->right, precedence)) {
+                syntax_error(s, ast, "Expected expression after operator");
+                return false;
+            }
+            // Translating Number (+|-) Complex => Complex instead of BinOp
+            if(ptr->left && ptr->left->type == AstType::Number) {
+                if(ptr->right && ptr->right->type == AstType::Complex) {
+                    AstNumberPtr real = ast_cast<AstNumber>(ptr->left);
+                    AstComplexPtr p = ast_cast<AstComplex>(ptr->right);
+                    if(!p->real && !p->imag.empty() && p->imag[0] != '-' && p->imag[0] != '+') {
+                        p->real = real;
+                        p->imag = ((ptr->op == AstBinOpType::Sub) ? '-' : '+') + p->imag;
+                        ast = p;
+                    }
+                }
+            }
+        }
+        else {
+            // factor ((expect(s, TokenKind::Star)||expect(s, TokenKind::Slash)||expect(s, TokenKind::Percent)||expect(s, TokenKind::DoubleSlash)) factor)*
+            TokenKind k = kind(top(s));
+            pop(s);
+            AstBinOpPtr bin;
+            location(s, create(s, bin));
+            bin->left = ast;
+            switch(k) {
+            case TokenKind::Star:           bin->op = AstBinOpType::Mult; break;
+            case TokenKind::Slash:          bin->op = AstBinOpType::Div; break;
+            case TokenKind::Percent:        bin->op = AstBinOpType::Mod; break;
+            default:                        bin->op = AstBinOpType::FloorDiv; break;
+            }
+            ast = bin;
+            if(!operand(s, bin->right, precedence)) {
+                syntax_error(s, ast, "Expected expression after operator");
+                return false;
+            }
+        }
     }
-    return false;
+    return guard.commit();
 }
 
 bool dotted_as_names(State & s, AstExpr & ast) {
     StateGuard guard(s, ast);
     AstTuplePtr lst;
-    location(s, create(lst));
+    location(s, create(s, lst));
     ast = lst;
     AstExpr dotted;
     while(dotted_as_name(s, dotted)) {
@@ -256,7 +516,7 @@ bool dotted_as_names(State & s, AstExpr & ast) {
 bool import_as_name(State & s, AstExpr & ast) {
     StateGuard guard(s, ast);
     AstAliasPtr alias;
-    location(s, create(alias));
+    location(s, create(s, alias));
     ast = alias;
     if(get_name(s, alias->name))
     {
@@ -274,7 +534,7 @@ bool import_as_name(State & s, AstExpr & ast) {
 bool try_stmt(State & s, AstStmt & ast) {
     StateGuard guard(s, ast);
     AstTryExceptPtr try_except;
-    location(s, create(try_except));
+    location(s, create(s, try_except));
     ast = try_except;
     // (expect(s, Token::KeywordTry) expect(s, TokenKind::Colon)
     // -> suite
@@ -288,7 +548,7 @@ bool try_stmt(State & s, AstStmt & ast) {
     AstExpr clause;
     while(except_clause(s, clause)) {
         assert(clause->type == AstType::Except);
-        AstExceptPtr except = std::static_pointer_cast<AstExcept>(clause);
+        AstExceptPtr except = ast_cast<AstExcept>(clause);
         if(!expect(s, TokenKind::Colon)) {
             syntax_error(s, clause, "Expected `:`");
             return false;
@@ -316,7 +576,7 @@ bool try_stmt(State & s, AstStmt & ast) {
     // ||expect(s, Token::KeywordFinally) expect(s, TokenKind::Colon) suite))
     if(is(s, Token::KeywordFinally)) {
         AstTryFinallyPtr ptr;
-        location(s, create(ptr));
+        location(s, create(s, ptr));
         expect(s, Token::KeywordFinally);
         ast = ptr;
         if(!expect(s, TokenKind::Colon)) {
@@ -360,7 +620,7 @@ bool dotted_name_list(State & s, AstExpr & ast) {
     ast = names[0];
     for(auto it = names.begin() + 1; it != names.end(); ++it) {
         AstAttributePtr attr;
-        location(s, create(attr));
+        location(s, create(s, attr));
         attr->attribute = *it;
         attr->value = ast;
         ast = attr;
@@ -373,11 +633,11 @@ bool dotted_name(State & s, AstExpr & ast) {
     if(get_name(s, ast)) {
         if(expect(s, TokenKind::Dot)) {
             assert(ast && ast->type == AstType::Name);
-            AstNamePtr name = std::static_pointer_cast<AstName>(ast);
+            AstNamePtr name = ast_cast<AstName>(ast);
             AstExpr trailing_name;
             if(dotted_name(s, trailing_name)) {
                 assert(trailing_name && trailing_name->type == AstType::Name);
-                AstName & trail = *std::static_pointer_cast<AstName>(trailing_name);
+                AstName & trail = *ast_cast<AstName>(trailing_name);
                 name->id += "." + trail.id;
                 name->dotted = true;
                 return guard.commit();
@@ -395,16 +655,25 @@ bool dotted_name(State & s, AstExpr & ast) {
 
 
 bool small_stmt(State & s, AstStmt & ast) {
-    return print_stmt(s, ast)
-        || expr_stmt(s, ast)
-        || del_stmt(s, ast)
-        || pass_stmt(s, ast)
-        || flow_stmt(s, ast)
-        || import_stmt(s, ast)
-        || global_stmt(s, ast)
-        || exec_stmt(s, ast)
-        || assert_stmt(s, ast)
-    ;
+    // print_stmt || expr_stmt || del_stmt || pass_stmt || flow_stmt || import_stmt || global_stmt || exec_stmt || assert_stmt
+    // Chosen by FIRST(small_stmt), only `print` is a plain identifier
+    if(starts_flow_stmt(top(s))) {
+        return flow_stmt(s, ast);
+    }
+    switch(token(top(s))) {
+    case Token::KeywordDel:         return del_stmt(s, ast);
+    case Token::KeywordPass:        return pass_stmt(s, ast);
+    case Token::KeywordImport:
+    case Token::KeywordFrom:        return import_stmt(s, ast);
+    case Token::KeywordGlobal:      return global_stmt(s, ast);
+    case Token::KeywordExec:        return exec_stmt(s, ast);
+    case Token::KeywordAssert:      return assert_stmt(s, ast);
+    default:
+        break;
+    }
+    // FIRST(print_stmt) is part of FIRST(expr_stmt), which is FIRST(test)
+    return starts_test(s)
+        && (print_stmt(s, ast) || expr_stmt(s, ast));
 }
 
 bool augassign(State & s, AstBinOpType & op) {
@@ -440,7 +709,7 @@ bool augassign(State & s, AstBinOpType & op) {
 bool return_stmt(State & s, AstStmt & ast) {
     StateGuard guard(s, ast);
     AstReturnPtr ret;
-    location(s, create(ret));
+    location(s, create(s, ret));
     ast = ret;
     // expect(s, Token::KeywordReturn) [testlist]
     if(!expect(s, Token::KeywordReturn))
@@ -451,33 +720,15 @@ bool return_stmt(State & s, AstStmt & ast) {
     return guard.commit();
 }
 
-bool not_test(State & s, AstExpr & ast) {
-    StateGuard guard(s, ast);
-    AstUnaryOpPtr result;
-    location(s, create(result));
-    // expect(s, Token::KeywordNot) not_test || comparison
-    if(expect(s, Token::KeywordNot)) {
-        result->op = AstUnaryOpType::Not;
-        if(!not_test(s, result->operand)) {
-            return false;
-        }
-        ast = result;
-    }
-    else if(!comparison(s, ast)) {
-        return false;
-    }
-    return guard.commit();
-}
-
 bool testlist1(State & s, AstExpr & ast) {
     StateGuard guard(s, ast);
-    location(s, create(ast));
+    location(s, create(s, ast));
     if(!test(s, ast)) {
         return false;
     }
     if(is(s, TokenKind::Comma)) {
         AstTuplePtr exprs;
-        clone_location(ast, create(exprs));
+        clone_location(ast, create(s, exprs));
         exprs->elements.push_back(ast);
         ast = exprs;
         while(expect(s, TokenKind::Comma)) {
@@ -494,7 +745,7 @@ bool testlist1(State & s, AstExpr & ast) {
 bool testlist_safe(State & s, AstExpr & ast) {
     StateGuard guard(s, ast);
     AstTuplePtr exprs;
-    location(s, create(exprs));
+    location(s, create(s, exprs));
     ast = exprs;
     AstExpr temp;
     // old_test [(expect(s, TokenKind::Comma) old_test)+ [expect(s, TokenKind::Comma)]]
@@ -511,19 +762,75 @@ bool testlist_safe(State & s, AstExpr & ast) {
     return !exprs->elements.empty() && guard.commit();
 }
 
+// Tokens that can't continue an expression in a display
+bool ends_element(TokenInfo const & tok) {
+    switch(kind(tok)) {
+    case TokenKind::Comma:
+    case TokenKind::Colon:
+    case TokenKind::RightParen:
+    case TokenKind::RightBracket:
+    case TokenKind::RightBrace:
+        return true;
+    default:
+        return false;
+    }
+}
+
+// test() for the elements of list, tuple, set and dict displays. Numbers,
+// signed numbers, names and runs of strings directly followed by the end of
+// the element are built by atom() or factor(), the rules test() would end up
+// in. Data modules consist of little else.
+bool display_element(State & s, AstExpr & ast) {
+    if(!s.options.literal_elements) {
+        return test(s, ast);
+    }
+    std::size_t length = 1;
+    switch(kind(top(s))) {
+    case TokenKind::Plus:
+    case TokenKind::Minus:
+    case TokenKind::Tilde:
+        if(!is(peek(s, 1), TokenKind::Number) || !ends_element(peek(s, 2))) {
+            return test(s, ast);
+        }
+        ++s.stats.literal_elements;
+        return factor(s, ast);
+    case TokenKind::Number:
+        break;
+    case TokenKind::String:
+        while(is(peek(s, length), TokenKind::String)) {
+            ++length;
+        }
+        break;
+    default:
+        if(!is(s, Token::Identifier)) {
+            return test(s, ast);
+        }
+        break;
+    }
+    if(!ends_element(peek(s, length))) {
+        return test(s, ast);
+    }
+    ++s.stats.literal_elements;
+    if(!atom(s, ast)) {
+        ast.reset();
+        return false;
+    }
+    return true;
+}
+
 bool testlist_comp(State & s, AstExpr & ast) {
     StateGuard guard(s, ast);
     AstTuplePtr exprs;
-    location(s, create(exprs));
+    location(s, create(s, exprs));
     ast = exprs;
     AstExpr tmp;
     // test ( comp_for || (expect(s, TokenKind::Comma) test)* [expect(s, TokenKind::Comma)] )
-    if(!test(s, tmp)) {
+    if(!display_element(s, tmp)) {
         return false;
     }
     if(is(s, Token::KeywordFor)) {
         AstGeneratorPtr gener;
-        location(s, create(gener));
+        location(s, create(s, gener));
         ast = gener;
         gener->element = tmp;
         if(!comp_for(s, gener->generators)) {
@@ -537,7 +844,7 @@ bool testlist_comp(State & s, AstExpr & ast) {
             if(!expect(s, TokenKind::Comma)) {
                 break;
             }
-            if(!test(s, tmp)) {
+            if(!display_element(s, tmp)) {
                 last_was_comma = true;
                 break;
             }
@@ -554,7 +861,7 @@ bool testlist_comp(State & s, AstExpr & ast) {
 bool except_clause(State & s, AstExpr & ast) {
     StateGuard guard(s, ast);
     AstExceptPtr except;
-    location(s, create(except));
+    location(s, create(s, except));
     ast = except;
     // expect(s, Token::KeywordExcept) [test [(expect(s, Token::KeywordAs) || expect(s, TokenKind::Comma)) test]]
     if(!expect(s, Token::KeywordExcept)) {
@@ -576,12 +883,12 @@ bool except_clause(State & s, AstExpr & ast) {
 bool listmaker(State & s, AstExpr & ast) {
     StateGuard guard(s, ast);
     AstListPtr ptr;
-    location(s, create(ptr));
+    location(s, create(s, ptr));
     // test ( list_for || (expect(s, TokenKind::Comma) test)* [expect(s, TokenKind::Comma)] )
-    if(test(s, ast)) {
+    if(display_element(s, ast)) {
         if(is(s, Token::KeywordFor)) {
             AstListCompPtr comp;
-            location(s, create(comp));
+            location(s, create(s, comp));
             comp->element = ast;
             ast = comp;
             if(!list_for(s, comp->generators)) {
@@ -593,7 +900,7 @@ bool listmaker(State & s, AstExpr & ast) {
             ast = ptr;
             while(expect(s, TokenKind::Comma)) {
                 AstExpr tmp;
-                if(!test(s, tmp)) {
+                if(!display_element(s, tmp)) {
                     break;
                 }
                 ptr->elements.push_back(tmp);
@@ -614,7 +921,7 @@ bool old_test(State & s, AstExpr & ast) {
 bool break_stmt(State & s, AstStmt & ast) {
     StateGuard guard(s, ast);
     AstBreakPtr brk;
-    location(s, create(brk));
+    location(s, create(s, brk));
     ast = brk;
     if(!expect(s, Token::KeywordBreak)) {
         return false;
@@ -625,7 +932,7 @@ bool break_stmt(State & s, AstStmt & ast) {
 bool with_stmt(State & s, AstStmt & ast, bool is_inner) {
     StateGuard guard(s, ast);
     AstWithPtr with;
-    location(s, create(with));
+    location(s, create(s, with));
     ast = with;
     // expect(s, Token::KeywordWith) with_item (expect(s, TokenKind::Comma) with_item)*  expect(s, TokenKind::Colon) suite
     if(!is_inner && !expect(s, Token::KeywordWith)) {
@@ -710,7 +1017,7 @@ bool raise_stmt(State & s, AstStmt & ast) {
     }
     StateGuard guard(s, ast);
     AstRaisePtr raise;
-    location(s, create(raise));
+    location(s, create(s, raise));
     ast = raise;
 
     if(test(s, raise->arg0)) {
@@ -732,6 +1039,9 @@ bool raise_stmt(State & s, AstStmt & ast) {
 }
 
 bool atom(State & s, AstExpr & ast) {
+    if(!starts_atom(s)) {
+        return false;
+    }
     StateGuard guard(s);
     // expect(s, TokenKind::LeftParen) [yield_expr||testlist_comp] expect(s, TokenKind::RightParen)
     if(expect(s, TokenKind::LeftParen)) {
@@ -740,7 +1050,7 @@ bool atom(State & s, AstExpr & ast) {
         }
         else if(!yield_expr(s, ast)) {
             AstTuplePtr ptr;
-            location(s, create(ptr));
+            location(s, create(s, ptr));
             ast = ptr;
         }
         if(!expect(s, TokenKind::RightParen)) {
@@ -752,7 +1062,7 @@ bool atom(State & s, AstExpr & ast) {
     else if(expect(s, TokenKind::LeftBracket)) {
         if(!listmaker(s, ast) || !ast) {
             AstListPtr ptr;
-            location(s, create(ptr));
+            location(s, create(s, ptr));
             ast = ptr;
         }
         if(!expect(s, TokenKind::RightBracket)) {
@@ -764,7 +1074,7 @@ bool atom(State & s, AstExpr & ast) {
     else if(expect(s, TokenKind::LeftBrace)) {
         if(!dictorsetmaker(s, ast)) {
             AstDictPtr ptr;
-            location(s, create(ptr));
+            location(s, create(s, ptr));
             ast = ptr;
         }
         if(!expect(s, TokenKind::RightBrace)) {
@@ -775,7 +1085,7 @@ bool atom(State & s, AstExpr & ast) {
     // ||expect(s, TokenKind::BackQuote) testlist1 expect(s, TokenKind::BackQuote)
     else if(expect(s, TokenKind::BackQuote)) {
         AstReprPtr ptr;
-        location(s, create(ptr));
+        location(s, create(s, ptr));
         ast = ptr;
         if(!testlist1(s, ptr->value)) {
             return false;
@@ -786,14 +1096,14 @@ bool atom(State & s, AstExpr & ast) {
         }
     }
     // ||expect(s, Token::Identifier)
-    else if(get_name(s, ast)) {
+    else if(is(s, Token::Identifier) && get_name(s, ast)) {
         // OK
     }
     // || NUMBER
     else if(is(s, TokenKind::Number)) {
         if(is(s, Token::NumberComplex)) {
             AstComplexPtr ptr;
-            location(s, create(ptr));
+            location(s, create(s, ptr));
             ast = ptr;
             if(!consume_value(s, Token::NumberComplex, ptr->imag)) {
                 assert("This should not happen at this point" && false);
@@ -819,7 +1129,7 @@ bool atom(State & s, AstExpr & ast) {
                 }
                 else {
                     AstComplexPtr cplx;
-                    location(s, create(cplx));
+                    location(s, create(s, cplx));
                     ast = cplx;
                     cplx->real = ptr;
                     if(!consume_value(s, Token::NumberComplex, cplx->imag)) {
@@ -837,7 +1147,7 @@ bool atom(State & s, AstExpr & ast) {
     // || STRING+
     else if(is(s, Token::String)) {
         AstStrPtr str;
-        location(s, create(str));
+        location(s, create(s, str));
         ast = str;
         str->unicode = s.future_features.unicode_literals;
         bool use_external_escape_handler = bool(s.options.escape_handler);
@@ -861,14 +1171,14 @@ bool atom(State & s, AstExpr & ast) {
     /*
     else if(is(s, Token::KeywordTrue) || is(s, Token::KeywordFalse)) {
         AstBoolPtr ptr;
-        location(s, create(ptr));
+        location(s, create(s, ptr));
         ast = ptr;
         ptr->value = is(s, Token::KeywordTrue);
         expect(s, Token::KeywordTrue) || expect(s, Token::KeywordFalse);
     }*/
     /*else if(is(s, Token::KeywordNone)) {
         AstNonePtr ptr;
-        location(s, create(ptr));
+        location(s, create(s, ptr));
         ast = ptr;
         expect(s, Token::KeywordNone);
     }*/
@@ -877,7 +1187,7 @@ bool atom(State & s, AstExpr & ast) {
         if(expect(s, TokenKind::Dot)) {
             if(expect(s, TokenKind::Dot)) {
                 AstEllipsisObjectPtr ptr;
-                location(s, create(ptr));
+                location(s, create(s, ptr));
                 ast = ptr;
             }
             else {
@@ -923,7 +1233,7 @@ bool parameters(State & s, AstArguments & ast) {
 bool dotted_as_name(State & s, AstExpr & ast) {
     StateGuard guard(s, ast);
     AstAliasPtr alias;
-    location(s, create(alias));
+    location(s, create(s, alias));
     ast = alias;
     // dotted_name [expect(s, Token::KeywordAs) expect(s, Token::Identifier)]
     if(!dotted_name(s, alias->name)) {
@@ -940,7 +1250,7 @@ bool dotted_as_name(State & s, AstExpr & ast) {
 
 bool arglist(State & s, AstArguments & ast) {
     StateGuard guard(s);
-    // location(s, create(ast));
+    // location(s, create(s, ast));
     // (argument expect(s, TokenKind::Comma))* (argument [expect(s, TokenKind::Comma)]||expect(s, TokenKind::Star) test (expect(s, TokenKind::Comma) argument)* [expect(s, TokenKind::Comma) expect(s, TokenKind::DoubleStar) test]||expect(s, TokenKind::DoubleStar) test)
     AstExpr item;
     while(!(is(s, TokenKind::Star) || is(s, TokenKind::DoubleStar)) && argument(s, item)) {
@@ -995,35 +1305,10 @@ bool arglist(State & s, AstArguments & ast) {
     return guard.commit();
 }
 
-bool shift_expr(State & s, AstExpr & ast) {
-    StateGuard guard(s, ast);
-    // arith_expr ((expect(s, TokenKind::LeftShift)||expect(s, TokenKind::RightShift)) arith_expr)*
-    if(!arith_expr(s, ast)) {
-        return false;
-    }
-    while(is(s, TokenKind::LeftShift) || is(s, TokenKind::RightShift)) {
-        AstBinOpPtr bin;
-        location(s, create(bin));
-        bin->left = ast;
-        ast = bin;
-        if(expect(s, TokenKind::LeftShift)) {
-            bin->op = AstBinOpType::LeftShift;
-        }
-        else if(expect(s, TokenKind::RightShift)) {
-            bin->op = AstBinOpType::RightShift;
-        }
-        if(!arith_expr(s, bin->right)){
-            syntax_error(s, ast, "Expected expression");
-            return false;
-        }
-    }
-    return guard.commit();
-}
-
 bool exprlist(State & s, AstExpr & ast) {
     StateGuard guard(s, ast);
     AstTuplePtr exprs;
-    location(s, create(exprs));
+    location(s, create(s, exprs));
     exprs->context = AstContext::Store;
     ast = exprs;
     // expr (expect(s, TokenKind::Comma) expr)* [expect(s, TokenKind::Comma)]
@@ -1043,7 +1328,7 @@ bool exprlist(State & s, AstExpr & ast) {
 bool simple_stmt(State & s, AstStmt & ast) {
     StateGuard guard(s, ast);
     AstSuitePtr suite_;
-    location(s, create(suite_));
+    location(s, create(s, suite_));
     ast = suite_;
     // small_stmt (expect(s, TokenKind::SemiColon) small_stmt)* [expect(s, TokenKind::SemiColon)] expect(s, Token::NewLine)
     AstStmt tmp;
@@ -1087,7 +1372,7 @@ bool simple_stmt(State & s, AstStmt & ast) {
 bool exec_stmt(State & s, AstStmt & ast) {
     StateGuard guard(s, ast);
     AstExecPtr exec;
-    location(s, create(exec));
+    location(s, create(s, exec));
     ast = exec;
     // expect(s, Token::KeywordExec) expr [expect(s, Token::KeywordIn) test [expect(s, TokenKind::Comma) test]]
     if(!expect(s, Token::KeywordExec)) {
@@ -1118,7 +1403,7 @@ bool factor(State & s, AstExpr & ast) {
     if(is(s, TokenKind::Plus)||is(s, TokenKind::Minus)||is(s, TokenKind::Tilde)) {
         // AstUnaryOpType::
         AstUnaryOpPtr unary;
-        location(s, create(unary));
+        location(s, create(s, unary));
         ast = unary;
         if(expect(s, TokenKind::Plus)) {
             unary->op = AstUnaryOpType::Add;
@@ -1134,7 +1419,7 @@ bool factor(State & s, AstExpr & ast) {
             if(unary->operand && unary->op == AstUnaryOpType::Sub) {
                 if(s.options.perform_inline_optimizations) {
                     if(unary->operand->type == AstType::Number) {
-                        AstNumberPtr p = std::static_pointer_cast<AstNumber>(unary->operand);
+                        AstNumberPtr p = ast_cast<AstNumber>(unary->operand);
                         switch(p->num_type) {
                         case AstNumber::Float:
                             p->floating *= -1.;
@@ -1144,13 +1429,14 @@ bool factor(State & s, AstExpr & ast) {
                             break;
                         case AstNumber::Long:
                             p->str = '-' + p->str;
+                            p->negative = !p->negative && !p->limbs.empty();
                             break;
                         }
                         ast = p;
                     }
                 }
                 if(unary->operand->type == AstType::Complex) {
-                    AstComplexPtr p = std::static_pointer_cast<AstComplex>(unary->operand);
+                    AstComplexPtr p = ast_cast<AstComplex>(unary->operand);
                     if(p->real) {
                         switch(p->real->num_type) {
                         case AstNumber::Float:
@@ -1161,6 +1447,7 @@ bool factor(State & s, AstExpr & ast) {
                             break;
                         case AstNumber::Long:
                             p->real->str = '-' + p->real->str;
+                            p->real->negative = !p->real->negative && !p->real->limbs.empty();
                             break;
                         }
                     }
@@ -1179,12 +1466,21 @@ bool factor(State & s, AstExpr & ast) {
 }
 
 bool test(State & s, AstExpr & ast) {
+    if(!starts_test(s)) {
+        ast.reset();
+        return false;
+    }
     StateGuard guard(s, ast);
     // or_test [expect(s, Token::KeywordIf) or_test expect(s, Token::KeywordElse) test] || lambdef
-    if(or_test(s, ast)) {
+    if(is(s, Token::KeywordLambda)) {
+        if(!lambdef(s, ast)) {
+            return false;
+        }
+    }
+    else if(or_test(s, ast)) {
         if(expect(s, Token::KeywordIf)) {
             AstIfExprPtr ifexpr;
-            location(s, create(ifexpr));
+            location(s, create(s, ifexpr));
             ifexpr->body = ast;
             ast = ifexpr;
             if(!or_test(s, ifexpr->test)) {
@@ -1201,7 +1497,7 @@ bool test(State & s, AstExpr & ast) {
             }
         }
     }
-    else if(!lambdef(s, ast)){
+    else {
         return false;
     }
     return guard.commit();
@@ -1210,7 +1506,7 @@ bool test(State & s, AstExpr & ast) {
 bool global_stmt(State & s, AstStmt & ast) {
     StateGuard guard(s, ast);
     AstGlobalPtr ptr;
-    location(s, create(ptr));
+    location(s, create(s, ptr));
     ast = ptr;
     // expect(s, Token::KeywordGlobal) expect(s, Token::Identifier) (expect(s, TokenKind::Comma) expect(s, Token::Identifier))*
     if(expect(s, Token::KeywordGlobal)) {
@@ -1223,7 +1519,7 @@ bool global_stmt(State & s, AstStmt & ast) {
         if(item->type != AstType::Name) {
             return false;
         }
-        ptr->names.push_back(std::static_pointer_cast<AstName>(item));
+        ptr->names.push_back(ast_cast<AstName>(item));
         while(expect(s, TokenKind::Comma)) {
             if(!get_name(s, item)) {
                 syntax_error(s, ast, "Expected identifier after `,`");
@@ -1234,7 +1530,7 @@ bool global_stmt(State & s, AstStmt & ast) {
                 syntax_error(s, ast, "Expected identifier after `,`");
                 return false;
             }
-            ptr->names.push_back(std::static_pointer_cast<AstName>(item));
+            ptr->names.push_back(ast_cast<AstName>(item));
         }
         return guard.commit();
     }
@@ -1246,7 +1542,7 @@ bool subscript(State & s, AstSliceTypePtr & ast) {
     // expect(s, TokenKind::Dot) expect(s, TokenKind::Dot) expect(s, TokenKind::Dot) || test || [test] expect(s, TokenKind::Colon) [test] [sliceop]
     if(is(s, TokenKind::Dot)) {
         AstEllipsisPtr ellipsis;
-        location(s, create(ellipsis));
+        location(s, create(s, ellipsis));
         if(!(expect(s, TokenKind::Dot) && expect(s, TokenKind::Dot) && expect(s, TokenKind::Dot))) {
             syntax_error(s, ast, "Invalid syntax");
             return false;
@@ -1255,11 +1551,11 @@ bool subscript(State & s, AstSliceTypePtr & ast) {
     }
     else {
         AstIndexPtr index;
-        location(s, create(index));
+        location(s, create(s, index));
         testlist1(s, index->value);
         if(expect(s, TokenKind::Colon)) {
             AstSlicePtr slice;
-            clone_location(index, create(slice));
+            clone_location(index, create(s, slice));
             slice->lower = index->value;
             test(s, slice->upper);
             sliceop(s, slice->step);
@@ -1286,14 +1582,14 @@ bool decorated(State & s, AstStmt & ast) {
     AstStmt cls_or_fun;
     if(funcdef(s, cls_or_fun)) {
         assert(cls_or_fun && cls_or_fun->type == AstType::FunctionDef);
-        AstFunctionDef & fun = *std::static_pointer_cast<AstFunctionDef>(cls_or_fun);
+        AstFunctionDef & fun = *ast_cast<AstFunctionDef>(cls_or_fun);
         fun.line = dec[0]->line;
         fun.column = dec[0]->column;
         fun.decorators.swap(dec);
     }
     else if(classdef(s, cls_or_fun)) {
         assert(cls_or_fun && cls_or_fun->type == AstType::ClassDef);
-        AstClassDef & cls = *std::static_pointer_cast<AstClassDef>(cls_or_fun);
+        AstClassDef & cls = *ast_cast<AstClassDef>(cls_or_fun);
         cls.line = dec[0]->line;
         cls.column = dec[0]->column;
         cls.decorators.swap(dec);
@@ -1316,50 +1612,53 @@ bool decorators(State & s, AstExprList & decorators) {
 
 bool compound_stmt(State & s, AstStmt & ast) {
     // if_stmt || while_stmt || for_stmt || try_stmt || with_stmt || funcdef || classdef || decorated
-    return if_stmt(s, ast)
-        || while_stmt(s, ast)
-        || for_stmt(s, ast)
-        || try_stmt(s, ast)
-        || with_stmt(s, ast)
-        || funcdef(s, ast)
-        || classdef(s, ast)
-        || decorated(s, ast)
-    ;
-}
-
-bool and_expr(State & s, AstExpr & ast) {
-    return generic_binop_expr(s, ast, TokenKind::BinAnd, AstBinOpType::BitAnd, shift_expr);
+    switch(token(top(s))) {
+    case Token::KeywordIf:          return if_stmt(s, ast);
+    case Token::KeywordWhile:       return while_stmt(s, ast);
+    case Token::KeywordFor:         return for_stmt(s, ast);
+    case Token::KeywordTry:         return try_stmt(s, ast);
+    case Token::KeywordWith:        return with_stmt(s, ast);
+    case Token::KeywordDef:         return funcdef(s, ast);
+    case Token::KeywordClass:       return classdef(s, ast);
+    case Token::DelimAt:            return decorated(s, ast);
+    default:                        return false;
+    }
 }
 
 bool flow_stmt(State & s, AstStmt & ast) {
-    return break_stmt(s, ast)
-        || continue_stmt(s, ast)
-        || return_stmt(s, ast)
-        || raise_stmt(s, ast)
-        || yield_stmt(s, ast)
-        ;
+    // break_stmt || continue_stmt || return_stmt || raise_stmt || yield_stmt
+    switch(token(top(s))) {
+    case Token::KeywordBreak:       return break_stmt(s, ast);
+    case Token::KeywordContinue:    return continue_stmt(s, ast);
+    case Token::KeywordReturn:      return return_stmt(s, ast);
+    case Token::KeywordRaise:       return raise_stmt(s, ast);
+    case Token::KeywordYield:       return yield_stmt(s, ast);
+    default:                        return false;
+    }
 }
 
 
 bool yield_expr(State & s, AstExpr & ast) {
+    if(!is(s, Token::KeywordYield)) {
+        ast.reset();
+        return false;
+    }
     StateGuard guard(s, ast);
     AstYieldExprPtr ptr;
-    location(s, create(ptr));
+    location(s, create(s, ptr));
     ast = ptr;
-    if(!expect(s, Token::KeywordYield)) {
-        return false;
-    }
+    expect(s, Token::KeywordYield);
     testlist(s, ptr->args);
     return guard.commit();
 }
 
 bool power(State & s, AstExpr & ast) {
     StateGuard guard(s, ast);
-    // location(s, create(ast));
+    // location(s, create(s, ast));
     // atom trailer* [expect(s, TokenKind::DoubleStar) factor]
     if(atom(s, ast)) {
         AstExpr expr;
-        while(trailer(s, expr, ast)) {
+        while(starts_trailer(top(s)) && trailer(s, expr, ast)) {
             ast = expr;
         }
         if(expr) {
@@ -1368,7 +1667,7 @@ bool power(State & s, AstExpr & ast) {
 
         if(expect(s, TokenKind::DoubleStar)) {
             AstBinOpPtr ptr;
-            location(s, create(ptr));
+            location(s, create(s, ptr));
             ptr->left = ast;
             ast = ptr;
             ptr->op = AstBinOpType::Power;
@@ -1383,15 +1682,16 @@ bool power(State & s, AstExpr & ast) {
 }
 
 bool print_stmt(State & s, AstStmt & ast) {
+    if(!is(s, Token::Identifier) || top(s).value != "print") {
+        ast.reset();
+        return false;
+    }
     StateGuard guard(s, ast);
     AstPrintPtr ptr;
-    location(s, create(ptr));
+    location(s, create(s, ptr));
     ast = ptr;
     ptr->newline = true;
     // 'print' ( [ test (expect(s, TokenKind::Comma) test)* [expect(s, TokenKind::Comma)] ] ||expect(s, TokenKind::RightShift) test [ (expect(s, TokenKind::Comma) test)+ [expect(s, TokenKind::Comma)] ] )
-    if(top(s).value != "print") {
-        return false;
-    }
     // Consume 'print'
     pop(s);
 
@@ -1460,7 +1760,7 @@ bool subscriptlist(State & s, AstExtSlice & ast) {
 bool testlist(State & s, AstExpr & ast) {
     StateGuard guard(s, ast);
     AstTuplePtr ptr;
-    location(s, create(ptr));
+    location(s, create(s, ptr));
     ast = ptr;
     // test (expect(s, TokenKind::Comma) test)* [expect(s, TokenKind::Comma)]
     AstExpr temp;
@@ -1487,7 +1787,7 @@ bool testlist(State & s, AstExpr & ast) {
 bool classdef(State & s, AstStmt & ast) {
     StateGuard guard(s, ast);
     AstClassDefPtr ptr;
-    location(s, create(ptr));
+    location(s, create(s, ptr));
     ast = ptr;
     // expect(s, Token::KeywordClass) expect(s, Token::Identifier)
     // [expect(s, TokenKind::LeftParen) [testlist] expect(s, TokenKind::RightParen)]
@@ -1518,11 +1818,19 @@ bool classdef(State & s, AstStmt & ast) {
 }
 
 bool stmt(State & s, AstStmt & ast) {
-    return simple_stmt(s, ast)
-        || compound_stmt(s, ast);
+    // simple_stmt || compound_stmt
+    // FIRST(simple_stmt) and FIRST(compound_stmt) don't overlap
+    if(starts_compound_stmt(top(s))) {
+        return compound_stmt(s, ast);
+    }
+    return simple_stmt(s, ast);
 }
 
 bool argument(State & s, AstExpr & ast) {
+    if(!starts_test(s)) {
+        ast.reset();
+        return false;
+    }
     StateGuard guard(s, ast);
     // test [comp_for] || test expect(s, TokenKind::Equal) test
     AstExpr first;
@@ -1531,7 +1839,7 @@ bool argument(State & s, AstExpr & ast) {
     }
     if(!is(s, TokenKind::Equal)) {
         AstGeneratorPtr ptr;
-        location(s, create(ptr));
+        location(s, create(s, ptr));
         ast = ptr;
         ptr->element = first;
         if(!comp_for(s, ptr->generators)) {
@@ -1541,7 +1849,7 @@ bool argument(State & s, AstExpr & ast) {
     else {
         expect(s, TokenKind::Equal);
         AstKeywordPtr ptr;
-        location(s, create(ptr));
+        location(s, create(s, ptr));
         ast = ptr;
         ptr->name = first;
         if(!test(s, ptr->value)) {
@@ -1555,7 +1863,7 @@ bool argument(State & s, AstExpr & ast) {
 bool assert_stmt(State & s, AstStmt & ast) {
     StateGuard guard(s, ast);
     AstAssertPtr ptr;
-    location(s, create(ptr));
+    location(s, create(s, ptr));
     ast = ptr;
     // expect(s, Token::KeywordAssert) test [expect(s, TokenKind::Comma) test]
     if(!expect(s, Token::KeywordAssert)) return false;
@@ -1575,7 +1883,7 @@ bool assert_stmt(State & s, AstStmt & ast) {
 bool for_stmt(State & s, AstStmt & ast) {
     StateGuard guard(s, ast);
     AstForPtr ptr;
-    location(s, create(ptr));
+    location(s, create(s, ptr));
     ast = ptr;
     // expect(s, Token::KeywordFor) exprlist expect(s, Token::KeywordIn) testlist expect(s, TokenKind::Colon) suite [expect(s, Token::KeywordElse) expect(s, TokenKind::Colon) suite]
     if(!expect(s, Token::KeywordFor)) {
@@ -1613,15 +1921,10 @@ bool for_stmt(State & s, AstStmt & ast) {
     return guard.commit();
 }
 
-bool and_test(State & s, AstExpr & ast) {
-    // not_test (expect(s, Token::KeywordAnd) not_test)*
-    return generic_boolop_expr(s, ast, Token::KeywordAnd, AstBoolOpType::And, not_test);
-}
-
 bool lambdef(State & s, AstExpr & ast) {
     StateGuard guard(s, ast);
     AstLambdaPtr ptr;
-    location(s, create(ptr));
+    location(s, create(s, ptr));
     ast = ptr;
     // expect(s, Token::KeywordLambda) [varargslist] expect(s, TokenKind::Colon) test
     if(!expect(s, Token::KeywordLambda)) {
@@ -1642,11 +1945,11 @@ bool lambdef(State & s, AstExpr & ast) {
 void make_docstring(State & s, AstSuitePtr & suite_) {
     if(s.options.docstrings && !suite_->items.empty() && suite_->items.front()) {
         if(suite_->items.front()->type == AstType::ExpressionStatement) {
-            AstExpressionStatementPtr exprstmt = std::static_pointer_cast<AstExpressionStatement>(suite_->items.front());
+            AstExpressionStatementPtr exprstmt = ast_cast<AstExpressionStatement>(suite_->items.front());
             if(exprstmt->expr && exprstmt->expr->type == AstType::Str) {
-                AstStrPtr txt = std::static_pointer_cast<AstStr>(exprstmt->expr);
+                AstStrPtr txt = ast_cast<AstStr>(exprstmt->expr);
                 AstDocStringPtr ptr;
-                clone_location(txt, create(ptr));
+                clone_location(txt, create(s, ptr));
                 ptr->doc = txt->value;
                 ptr->unicode = txt->unicode;
                 suite_->items[0] = ptr;
@@ -1660,7 +1963,7 @@ bool suite(State & s, AstStmt & ast) {
     if(expect(s, Token::NewLine)) {
         StateGuard guard(s, ast);
         AstSuitePtr suite_;
-        location(s, create(suite_));
+        location(s, create(s, suite_));
         ast = suite_;
         // Consume any new lines inbetween
         while(expect(s, Token::NewLine));
@@ -1698,10 +2001,81 @@ bool suite(State & s, AstStmt & ast) {
     return false;
 }
 
+bool lazy_suite(State & s, AstStmt & ast) {
+    // expect(s, Token::NewLine) expect(s, Token::Indent) with the block
+    // skipped by balancing expect(s, Token::Indent) and expect(s, Token::Dedent)
+    if(!s.options.lazy_bodies || !is(s, Token::NewLine)) {
+        return false;
+    }
+    StateGuard guard(s, ast);
+    while(expect(s, Token::NewLine));
+    if(!is(s, Token::Indent)) {
+        return false;
+    }
+    AstLazySuitePtr lazy;
+    location(s, create(s, lazy));
+    ast = lazy;
+    expect(s, Token::Indent);
+
+    // The docstring is parsed right away, outlines need it
+    if(s.options.docstrings && is(s, TokenKind::String)) {
+        AstSuitePtr head;
+        create(s, head);
+        AstStmt first;
+        if(stmt(s, first) && first) {
+            head->items.push_back(first);
+            make_docstring(s, head);
+            if(head->items.front()->type == AstType::DocString) {
+                lazy->items.push_back(head->items.front());
+            }
+        }
+    }
+
+    int depth = 1;
+    uint64_t end = 0;
+    while(depth > 0 && !is(s, Token::End)) {
+        if(is(s, Token::Indent)) {
+            ++depth;
+        }
+        else if(is(s, Token::Dedent)) {
+            --depth;
+            end = top(s).line;
+        }
+        pop(s);
+    }
+    // Dedents at the end carry the line number of the last line, which is
+    // also the one of the line before if it isn't terminated
+    std::size_t next = s.position;
+    while(is(s.tokens->get(next), Token::Dedent)) {
+        ++next;
+    }
+    if(is(s.tokens->get(next), Token::End)) {
+        end = s.tokens->get(next).line + 2;
+    }
+
+    // Tokens report the number of the line following theirs
+    char const * data = 0;
+    std::size_t length = 0;
+    if(!s.lines && s.lexer->get_source(data, length)) {
+        s.lines.reset(new LineStarts(data, length));
+    }
+    if(s.lines) {
+        std::size_t begin = s.lines->offset_of(std::size_t(lazy->line - 1));
+        lazy->source.assign(s.lines->data() + begin, s.lines->offset_of(std::size_t(end - 1)) - begin);
+    }
+    else {
+        for(uint64_t line = uint64_t(lazy->line); line < end; ++line) {
+            lazy->source += s.lexer->get_line(int(line));
+            lazy->source += '\n';
+        }
+    }
+    return guard.commit();
+}
+
 bool funcdef(State & s, AstStmt & ast) {
     StateGuard guard(s, ast);
     AstFunctionDefPtr ptr;
-    location(s, create(ptr));
+    location(s, create(s, ptr));
     ast = ptr;
     // expect(s, Token::KeywordDef) expect(s, Token::Identifier) parameters expect(s, TokenKind::Colon) suite
     if(!expect(s, Token::KeywordDef)) {
@@ -1720,7 +2094,7 @@ bool funcdef(State & s, AstStmt & ast) {
         syntax_error(s, ast, "Expected `:`");
         return false;
     }
-    if(!suite(s, ptr->body)) {
+    if(!lazy_suite(s, ptr->body) && !suite(s, ptr->body)) {
         return false;
     }
     return guard.commit();
@@ -1729,7 +2103,7 @@ bool funcdef(State & s, AstStmt & ast) {
 bool expr_stmt(State & s, AstStmt & ast) {
     StateGuard guard(s);
     AstExpressionStatementPtr ptr;
-    location(s, create(ptr));
+    location(s, create(s, ptr));
     ast = ptr;
     AstExpr target;
     if(testlist(s, target)) {
@@ -1761,7 +2135,7 @@ bool expr_stmt(State & s, AstStmt & ast) {
             }
 
             AstAugAssignPtr ptr;
-            location(s, create(ptr));
+            location(s, create(s, ptr));
             ast = ptr;
             ptr->target = target;
             ptr->op = op;
@@ -1796,7 +2170,7 @@ bool expr_stmt(State & s, AstStmt & ast) {
                     case AstType::List:
                         break;
                     case AstType::Tuple:
-                        if(!std::static_pointer_cast<AstTuple>(target)->elements.empty()) {
+                        if(!ast_cast<AstTuple>(target)->elements.empty()) {
                             break; // Break on non empty tuples only
                         }
                         // fallthrough
@@ -1807,7 +2181,7 @@ bool expr_stmt(State & s, AstStmt & ast) {
                     return true;
                 };
                 AstAssignPtr ptr;
-                location(s, create(ptr));
+                location(s, create(s, ptr));
                 if(!check_assign(target)) {
                     return false;
                 }
@@ -1830,8 +2204,6 @@ bool expr_stmt(State & s, AstStmt & ast) {
                     }
                     ptr->value = value;
                 }
-                for(AstPtr target : ptr->targets) {
-                }
             }
         }
     }
@@ -1846,7 +2218,7 @@ bool expr_stmt(State & s, AstStmt & ast) {
 bool old_lambdef(State & s, AstExpr & ast) {
     StateGuard guard(s, ast);
     AstLambdaPtr ptr;
-    location(s, create(ptr));
+    location(s, create(s, ptr));
     ast = ptr;
     // expect(s, Token::KeywordLambda) [varargslist] expect(s, TokenKind::Colon) old_test
     if(!expect(s, Token::KeywordLambda)) {
@@ -1867,7 +2239,7 @@ bool old_lambdef(State & s, AstExpr & ast) {
 bool continue_stmt(State & s, AstStmt & ast) {
     StateGuard guard(s, ast);
     AstContinuePtr ptr;
-    location(s, create(ptr));
+    location(s, create(s, ptr));
     ast = ptr;
     if(!expect(s, Token::KeywordContinue)) {
         return false;
@@ -1878,7 +2250,7 @@ bool continue_stmt(State & s, AstStmt & ast) {
 bool decorator(State & s, AstExpr & ast) {
     StateGuard guard(s, ast);
     AstCallPtr ptr;
-    location(s, create(ptr));
+    location(s, create(s, ptr));
     ast = ptr;
     // expect(s, TokenKind::At) dotted_name
     // [ expect(s, TokenKind::LeftParen) [arglist] expect(s, TokenKind::RightParen) ] expect(s, Token::NewLine)
@@ -1911,7 +2283,7 @@ bool else_stmt(State & s, AstStmt & ast) {
     // (expect(s, Token::KeywordElIf) test expect(s, TokenKind::Colon) suite)*
     if(expect(s, Token::KeywordElIf)) {
         AstIfPtr if_;
-        location(s, create(if_));
+        location(s, create(s, if_));
         ast = if_;
 
         if(!test(s, if_->test)) {
@@ -1947,7 +2319,7 @@ bool else_stmt(State & s, AstStmt & ast) {
 bool if_stmt(State & s, AstStmt & ast) {
     StateGuard guard(s, ast);
     AstIfPtr if_;
-    location(s, create(if_));
+    location(s, create(s, if_));
     ast = if_;
     // expect(s, Token::KeywordIf) test expect(s, TokenKind::Colon) suite
     if(!expect(s, Token::KeywordIf)) {
@@ -1974,72 +2346,15 @@ bool sliceop(State & s, AstExpr & ast) {
         return false;
     }
     if(!test(s, ast)) {
-        location(s, create<AstNone>(ast));
-    }
-    return guard.commit();
-}
-
-bool comparison(State & s, AstExpr & ast) {
-    StateGuard guard(s, ast);
-    // expr (comp_op expr)*
-    if(!expr(s, ast)) {
-        return false;
-    }
-    AstCompareOpType op;
-    AstComparePtr ptr;
-    clone_location(ast, create(ptr));
-    ptr->left = ast;
-    ast = ptr;
-    while(comp_op(s, op)) {
-        ptr->operators.push_back(op);
-        AstExpr right;
-        if(!expr(s, right)) {
-            syntax_error(s, ast, "Expected expression after comparison operator");
-            return false;
-        }
-        ptr->comparators.push_back(right);
-    }
-    if(ptr->operators.empty() && ptr->comparators.empty()) {
-        ast = ptr->left;
+        location(s, create<AstNone>(s, ast));
     }
     return guard.commit();
 }
 
-bool term(State & s, AstExpr & ast) {
-    StateGuard guard(s, ast);
-    // factor (( factor)*
-    if(factor(s, ast)) {
-        while(is(s, TokenKind::Star) || is(s, TokenKind::Slash) || is(s, TokenKind::Percent) || is(s, TokenKind::DoubleSlash)) {
-            TokenKind k = kind(top(s));
-            pop(s);
-
-            AstBinOpPtr bin;
-            location(s, create(bin));
-            bin->left = ast;
-            ast = bin;
-            switch(k) {
-            case TokenKind::Star:           bin->op = AstBinOpType::Mult; break;
-            case TokenKind::Slash:          bin->op = AstBinOpType::Div; break;
-            case TokenKind::Percent:        bin->op = AstBinOpType::Mod; break;
-            case TokenKind::DoubleSlash:    bin->op = AstBinOpType::FloorDiv; break;
-            default: // WTF?
-                assert(false && "This should not happen. Unexpected token type received.");
-                return false;
-            }
-            if(!factor(s, bin->right)) {
-                syntax_error(s, ast, "Expected expression after operator");
-                return false;
-            }
-        }
-        return guard.commit();
-    }
-    return false;
-}
-
 bool pass_stmt(State & s, AstStmt & ast) {
     StateGuard guard(s, ast);
     AstPassPtr pass_;
-    location(s, create(pass_));
+    location(s, create(s, pass_));
     ast = pass_;
     if(!expect(s, Token::KeywordPass)) {
             return false;
@@ -2047,25 +2362,21 @@ bool pass_stmt(State & s, AstStmt & ast) {
     return guard.commit();
 }
 
-bool xor_expr(State & s, AstExpr & ast) {
-    return generic_binop_expr(s, ast, TokenKind::CircumFlex, AstBinOpType::BitXor, and_expr);
-}
-
 bool or_test(State & s, AstExpr & ast) {
-    return generic_boolop_expr(s, ast, Token::KeywordOr, AstBoolOpType::Or, and_test);
+    return operator_expr(s, ast, Precedence::Or);
 }
 
 bool dictorsetmaker(State & s, AstExpr & ast) {
     StateGuard guard(s, ast);
     AstExpr first, second;
     // ((test expect(s, TokenKind::Colon) test (comp_for || (expect(s, TokenKind::Comma) test expect(s, TokenKind::Colon) test)* [expect(s, TokenKind::Comma)])) ||(test (comp_for || (expect(s, TokenKind::Comma) test)* [expect(s, TokenKind::Comma)])))
-    if(test(s, first)) {
+    if(display_element(s, first)) {
         if(expect(s, TokenKind::Colon)) {
             // Dict
             AstDictPtr ptr;
-            location(s, create(ptr));
+            location(s, create(s, ptr));
             ast = ptr;
-            if(!test(s, second)) {
+            if(!display_element(s, second)) {
                 syntax_error(s, ast, "Expected expression after `:`");
                 return false;
             }
@@ -2076,7 +2387,7 @@ bool dictorsetmaker(State & s, AstExpr & ast) {
             if(is(s, Token::KeywordFor)) {
                 ptr.reset();
                 AstDictCompPtr comp;
-                location(s, create(comp));
+                location(s, create(s, comp));
                 ast = comp;
                 comp->key = first;
                 comp->value = second;
@@ -2088,14 +2399,14 @@ bool dictorsetmaker(State & s, AstExpr & ast) {
                 second.reset();
                 // Dict definition
                 while(expect(s, TokenKind::Comma)) {
-                    if(!test(s, first)) {
+                    if(!display_element(s, first)) {
                         break;
                     }
                     if(!expect(s, TokenKind::Colon)) {
                         syntax_error(s, ast, "Expected `:`");
                         return false;
                     }
-                    if(!test(s, second)) {
+                    if(!display_element(s, second)) {
                         syntax_error(s, ast, "Expected expression after `:`");
                         return false;
                     }
@@ -2114,7 +2425,7 @@ bool dictorsetmaker(State & s, AstExpr & ast) {
             if(is(s, Token::KeywordFor)) {
                 // Set Comprehension
                 AstSetCompPtr ptr;
-                location(s, create(ptr));
+                location(s, create(s, ptr));
                 ast = ptr;
                 ptr->element = first;
                 if(!comp_for(s, ptr->generators)) {
@@ -2125,11 +2436,11 @@ bool dictorsetmaker(State & s, AstExpr & ast) {
             else {
                 // Set definition
                 AstSetPtr ptr;
-                location(s, create(ptr));
+                location(s, create(s, ptr));
                 ast = ptr;
                 ptr->elements.push_back(first);
                 while(expect(s, TokenKind::Comma)) {
-                    if(!test(s, first)) {
+                    if(!display_element(s, first)) {
                         break;
                     }
                     ptr->elements.push_back(first);
@@ -2140,20 +2451,20 @@ bool dictorsetmaker(State & s, AstExpr & ast) {
     } else {
         // Empty Dict
         AstDictPtr ptr;
-        location(s, create(ptr));
+        location(s, create(s, ptr));
         ast = ptr;
     }
     return guard.commit();
 }
 
 bool expr(State & s, AstExpr & ast) {
-    return generic_binop_expr(s, ast, TokenKind::BinOr, AstBinOpType::BitOr, xor_expr);
+    return operator_expr(s, ast, Precedence::BitOr);
 }
 
 bool del_stmt(State & s, AstStmt & ast) {
     StateGuard guard(s, ast);
     AstDeletePtr del;
-    location(s, create(del));
+    location(s, create(s, del));
     ast = del;
     // expect(s, Token::KeywordDel) exprlist
     if(!expect(s, Token::KeywordDel)) {
@@ -2170,7 +2481,7 @@ bool del_stmt(State & s, AstStmt & ast) {
 bool while_stmt(State & s, AstStmt & ast) {
     StateGuard guard(s, ast);
     AstWhilePtr ptr;
-    location(s, create(ptr));
+    location(s, create(s, ptr));
     ast = ptr;
     // expect(s, Token::KeywordWhile) test expect(s, TokenKind::Colon) suite [expect(s, Token::KeywordElse) expect(s, TokenKind::Colon) suite]
     if(!expect(s, Token::KeywordWhile)) {
@@ -2202,7 +2513,7 @@ bool while_stmt(State & s, AstStmt & ast) {
 bool fplist(State & s, AstExpr & ast) {
     StateGuard guard(s, ast);
     AstTuplePtr tuple;
-    location(s, create(tuple));
+    location(s, create(s, tuple));
     ast = tuple;
     // fpdef (expect(s, TokenKind::Comma) fpdef)* [expect(s, TokenKind::Comma)]
     AstExpr temp;
@@ -2226,7 +2537,7 @@ bool fplist(State & s, AstExpr & ast) {
 
 bool fpdef(State & s, AstExpr & ast) {
     StateGuard guard(s, ast);
-    location(s, create(ast));
+    location(s, create(s, ast));
     // expect(s, Token::Identifier) || expect(s, TokenKind::LeftParen) fplist expect(s, TokenKind::RightParen)
     if(!get_name(s, ast)) {
         if(expect(s, TokenKind::LeftParen)) {
@@ -2303,7 +2614,7 @@ bool trailer(State & s, AstExpr & ast, AstExpr target) {
     // expect(s, TokenKind::LeftParen) [arglist] expect(s, TokenKind::RightParen)
     if(is(s, TokenKind::LeftParen)) {
         AstCallPtr ptr;
-        location(s, create(ptr));
+        location(s, create(s, ptr));
         ast = ptr;
         ptr->function = target;
         expect(s, TokenKind::LeftParen);
@@ -2316,12 +2627,12 @@ bool trailer(State & s, AstExpr & ast, AstExpr target) {
     // || expect(s, TokenKind::LeftBracket) subscriptlist expect(s, TokenKind::RightBracket)
     else if(is(s, TokenKind::LeftBracket)) {
         AstSubscriptPtr ptr;
-        location(s, create(ptr));
+        location(s, create(s, ptr));
         ast = ptr;
         ptr->value = target;
         expect(s, TokenKind::LeftBracket);
         AstExtSlicePtr slice_ptr;
-        create(slice_ptr);
+        create(s, slice_ptr);
         ptr->slice = slice_ptr;
         if(!subscriptlist(s, *slice_ptr)) {
             syntax_error(s, ast, "Expected expression within `[]`");
@@ -2338,7 +2649,7 @@ bool trailer(State & s, AstExpr & ast, AstExpr target) {
     // || expect(s, TokenKind::Dot) expect(s, Token::Identifier)
     else if(is(s, TokenKind::Dot)) {
         AstAttributePtr ptr;
-        location(s, create(ptr));
+        location(s, create(s, ptr));
         ast = ptr;
         ptr->value = target;
         expect(s, TokenKind::Dot);
@@ -2373,7 +2684,7 @@ bool import_from(State & s, AstStmt & ast) {
 
     StateGuard guard(s, ast);
     AstImportFromPtr impfrom;
-    location(s, create(impfrom));
+    location(s, create(s, impfrom));
     ast = impfrom;
     impfrom->level = 0;
     bool is_future_import = false;
@@ -2388,7 +2699,7 @@ bool import_from(State & s, AstStmt & ast) {
         }
         if(impfrom->level == 0) {
             assert(impfrom->module->type == AstType::Name);
-            is_future_import = std::static_pointer_cast<AstName>(impfrom->module)->id == "__future__";
+            is_future_import = ast_cast<AstName>(impfrom->module)->id == "__future__";
         }
         //    expect(s, Token::KeywordImport)
         if(!expect(s, Token::KeywordImport)) {
@@ -2402,11 +2713,11 @@ bool import_from(State & s, AstStmt & ast) {
                 return false;
             }
             AstNamePtr ptr;
-            location(s, create(ptr));
+            location(s, create(s, ptr));
             expect(s, TokenKind::Star);
             ptr->id = "*";
             AstAliasPtr alias;
-            clone_location(ptr, create(alias));
+            clone_location(ptr, create(s, alias));
             alias->name = ptr;
             impfrom->names = alias;
             // ok
@@ -2436,10 +2747,10 @@ bool import_from(State & s, AstStmt & ast) {
                     return false;
                 }
                 assert(e->type == AstType::Alias || e->type == AstType::Name);
-                auto n = e->type == AstType::Name ? e : std::static_pointer_cast<AstAlias>(e)->name;
+                auto n = e->type == AstType::Name ? e : ast_cast<AstAlias>(e)->name;
                 if(n) {
                     assert(n->type == AstType::Name);
-                    auto & name = *std::static_pointer_cast<AstName>(n);
+                    auto & name = *ast_cast<AstName>(n);
                     bool found = false;
                     while(iter && iter->name) {
                         if(name.id == iter->name) {
@@ -2459,7 +2770,7 @@ bool import_from(State & s, AstStmt & ast) {
 
             bool failure = false;
             if(impfrom->names->type == AstType::Tuple) {
-                for(auto e : std::static_pointer_cast<AstTuple>(impfrom->names)->elements) {
+                for(auto e : ast_cast<AstTuple>(impfrom->names)->elements) {
                     if(!future_check(e)) {
                         if(s.options.handle_future_errors) {
                             failure = true;
@@ -2487,7 +2798,7 @@ bool import_from(State & s, AstStmt & ast) {
 bool import_as_names(State & s, AstExpr & ast) {
     StateGuard guard(s, ast);
     AstTuplePtr exprs;
-    location(s, create(exprs));
+    location(s, create(s, exprs));
     ast = exprs;
     // import_as_name (expect(s, TokenKind::Comma) import_as_name)* [expect(s, TokenKind::Comma)]
     AstExpr alias;
@@ -2510,7 +2821,7 @@ bool import_as_names(State & s, AstExpr & ast) {
 bool import_name(State & s, AstStmt & ast) {
     StateGuard guard(s, ast);
     AstImportPtr imp;
-    location(s, create(imp));
+    location(s, create(s, imp));
     ast = imp;
     // expect(s, Token::KeywordImport) dotted_as_names
     if(!expect(s, Token::KeywordImport)) {
@@ -2528,43 +2839,6 @@ bool import_stmt(State & s, AstStmt & ast) {
         || import_from(s, ast);
 }
 
-bool arith_expr(State & s, AstExpr & ast) {
-    StateGuard guard(s);
-    // term ((expect(s, TokenKind::Plus)||expect(s, TokenKind::Minus)) term)*
-    if(!term(s, ast)) {
-        return false;
-    }
-    while(is(s, TokenKind::Plus) || is(s, TokenKind::Minus)) {
-        AstBinOpPtr ptr;
-        location(s, create(ptr));
-        ptr->left = ast;
-        ast = ptr;
-        if(expect(s, TokenKind::Plus)) {
-            ptr->op = AstBinOpType::Add;
-        }
-        else if(expect(s, TokenKind::Minus)) {
-            ptr->op = AstBinOpType::Sub;
-        }
-        if(!term(s, ptr->right)) {
-            syntax_error(s, ast, "Expected expression after operator");
-            return false;
-        }
-        // Translating Number (+|-) Complex => Complex instead of BinOp
-        if(ptr->left && ptr->left->type == AstType::Number) {
-            if(ptr->right && ptr->right->type == AstType::Complex) {
-                AstNumberPtr real = std::static_pointer_cast<AstNumber>(ptr->left);
-                AstComplexPtr p = std::static_pointer_cast<AstComplex>(ptr->right);
-                if(!p->real && !p->imag.empty() && p->imag[0] != '-' && p->imag[0] != '+') {
-                    p->real = real;
-                    p->imag = ((ptr->op == AstBinOpType::Sub) ? '-' : '+') + p->imag;
-                    ast = p;
-                }
-            }
-        }
-    }
-    return guard.commit();
-}
-
 bool list_if(State & s, AstExpr & ast) {
     StateGuard guard(s, ast);
     // expect(s, Token::KeywordIf) old_test [list_iter]
@@ -2584,7 +2858,7 @@ bool list_for(State & s, AstExprList & ast) {
         return false;
     }
     AstComprPtr compr;
-    location(s, create(compr));
+    location(s, create(s, compr));
     // expect(s, Token::KeywordFor) exprlist expect(s, Token::KeywordIn) testlist_safe [list_iter]
     while(expect(s, Token::KeywordFor)) {
         if(!exprlist(s, compr->target)) {
@@ -2607,19 +2881,19 @@ bool list_for(State & s, AstExprList & ast) {
 
         ast.push_back(compr);
         compr.reset();
-        location(s, create(compr));
+        location(s, create(s, compr));
     }
     return guard.commit();
 }
 
 bool comp_for(State & s, AstExprList & ast) {
-    StateGuard guard(s);
     // expect(s, Token::KeywordFor) exprlist expect(s, Token::KeywordIn) or_test [comp_iter]
     if(!is(s, Token::KeywordFor)) {
         return false;
     }
+    StateGuard guard(s);
     AstComprPtr compr;
-    location(s, create(compr));
+    location(s, create(s, compr));
     while(expect(s, Token::KeywordFor)) {
         if(!exprlist(s, compr->target)) {
             syntax_error(s, compr, "Expected expression after `for`");
@@ -2642,7 +2916,7 @@ bool comp_for(State & s, AstExprList & ast) {
 
         ast.push_back(compr);
         compr.reset();
-        location(s, create(compr));
+        location(s, create(s, compr));
     }
     return guard.commit();
 }
@@ -2663,7 +2937,7 @@ bool comp_if(State & s, AstExpr & ast) {
 bool yield_stmt(State & s, AstStmt & ast) {
     StateGuard guard(s, ast);
     AstYieldPtr ptr;
-    location(s, create(ptr));
+    location(s, create(s, ptr));
     ast = ptr;
     if(!yield_expr(s, ptr->yield)) {
         return false;
@@ -2674,10 +2948,10 @@ bool yield_stmt(State & s, AstStmt & ast) {
 #if 0
 bool eval_input(State & s, AstModulePtr & ast) {
     StateGuard guard(s, ast);
-    location(s, create(ast));
-    location(s, create(ast->body));
+    location(s, create(s, ast));
+    location(s, create(s, ast->body));
     AstExpressionStatementPtr expr;
-    location(s, create(expr));
+    location(s, create(s, expr));
     ast->body->items.push_back(expr);
     ast->kind = AstModuleKind::Expression;
 
@@ -2698,8 +2972,8 @@ bool eval_input(State & s, AstModulePtr & ast) {
 
 bool single_input(State & s, AstModulePtr & ast) {
     StateGuard guard(s, ast);
-    location(s, create(ast));
-    location(s, create(ast->body));
+    location(s, create(s, ast));
+    location(s, create(s, ast->body));
     ast->kind = AstModuleKind::Interactive;
     // expect(s, Token::NewLine) || simple_stmt || compound_stmt expect(s, Token::NewLine)
     if(expect(s, Token::NewLine)) {
@@ -2719,10 +2993,10 @@ bool single_input(State & s, AstModulePtr & ast) {
 }
 #endif
 
-bool file_input(State & s, AstModulePtr & ast) {
+bool file_input(State & s, AstModulePtr & ast, bool module_docstring) {
     StateGuard guard(s, ast);
-    location(s, create(ast));
-    location(s, create(ast->body));
+    location(s, create(s, ast));
+    location(s, create(s, ast->body));
     ast->kind = AstModuleKind::Module;
     // (expect(s, Token::NewLine) || stmt)* expect(s, Token::End)
     while(!is(s, Token::End)) {
@@ -2744,7 +3018,7 @@ bool file_input(State & s, AstModulePtr & ast) {
             return false;
         }
     }
-    if(ast) {
+    if(ast && module_docstring) {
         make_docstring(s, ast->body);
     }
     return guard.commit();
@@ -2772,14 +3046,48 @@ bool parse(Lexer & lexer,
            AstModulePtr & ast,
            SymbolTablePtr & symbols,
            ParserOptions options /*= ParserOptions()*/) {
+    ParseCache::Key key;
+    char const * source = 0;
+    std::size_t length = 0;
+    bool cached = options.cache && lexer.get_source(source, length)
+               && ParseCache::make_key(source, length, options, key);
+    if(cached && options.cache->load(key, lexer.get_name(), options.arena, ast, symbols)) {
+        return true;
+    }
+
+    // Results with errors or warnings aren't stored, they'd get lost on a hit
+    bool clean = true;
+    if(cached) {
+        auto handler = options.error_handler;
+        options.error_handler = [&clean, handler](Error e) {
+            clean = false;
+            if(handler) {
+                handler(e);
+            }
+        };
+    }
+    TokenStream tokens(lexer);
+    bool result = parse(tokens, ast, symbols, options);
+    if(cached && result && clean && ast && symbols) {
+        options.cache->store(key, *ast, *symbols);
+    }
+    return result;
+}
+
+bool parse(TokenStream & tokens,
+           AstModulePtr & ast,
+           SymbolTablePtr & symbols,
+           ParserOptions options /*= ParserOptions()*/) {
     State state;
-    state.lexer = &lexer;
-    state.tok_cur = lexer.next();
+    state.lexer = &tokens.lexer();
+    state.tokens = &tokens;
+    seek(state, 0);
     state.options = options;
     state.future_features = options.initial_future_features;
+    StatsReport report_stats(state);
 
     if(is(state, Token::EncodingError)) {
-        syntax_error(state, AstPtr(), state.tok_cur.value.c_str());
+        syntax_error(state, AstPtr(), top(state).value.str().c_str());
         return false;
     }
 
@@ -2790,4 +3098,558 @@ bool parse(Lexer & lexer,
     return false;
 }
 
+
+namespace {
+    // Drops a block of a statement passed to the handler from the table,
+    // the nodes identifying it are going away
+    void forget_block(SymbolTable & table, SymbolTableEntryPtr const & entry) {
+        table.symbols.erase(entry->id);
+        for(auto const & child : entry->children) {
+            forget_block(table, child);
+        }
+    }
+}
+
+bool parse_statements(Lexer & lexer,
+                      StatementHandler on_statement,
+                      ParserOptions options /*= ParserOptions()*/) {
+    TokenStream tokens(lexer);
+    State state;
+    state.lexer = &lexer;
+    state.tokens = &tokens;
+    seek(state, 0);
+    state.options = options;
+    state.future_features = options.initial_future_features;
+    StatsReport report_stats(state);
+
+    if(is(state, Token::EncodingError)) {
+        syntax_error(state, AstPtr(), top(state).value.str().c_str());
+        return false;
+    }
+
+    // Only the module node and its (empty) body outlive the statements
+    AstArena module_arena;
+    AstArena statement_arena;
+    AstModulePtr module;
+    state.options.arena = &module_arena;
+    location(state, create(state, module));
+    location(state, create(state, module->body));
+    module->kind = AstModuleKind::Module;
+    state.options.arena = &statement_arena;
+
+    SymbolTablePtr symbols = std::make_shared<SymbolTable>();
+    symbols->file_name = lexer.get_name();
+    symbols->enter_block(BlockType::Module, symbols->file_name, *module);
+    symbols->current->unoptimized = OptimizeFlag_TopLevel;
+    auto add_err = [&state](Error e) {
+        e.file_name = state.lexer->get_name();
+        e.line = state.lexer->get_line(e.cur.line);
+        state.errors.push(e);
+        report_error(state);
+    };
+
+    // Same as file_input(), but with the body holding one statement at a time
+    AstStmtList & items = module->body->items;
+    bool first = true;
+    while(!is(state, Token::End)) {
+        AstStmt statement;
+        if(expect(state, Token::NewLine)) {
+            continue;
+        }
+        if(!stmt(state, statement)) {
+            syntax_error(state, module, "invalid syntax");
+            return false;
+        }
+        if(statement && statement->type == AstType::Suite) {
+            flatten(statement, items);
+        }
+        else {
+            items.push_back(statement);
+        }
+        if(first) {
+            make_docstring(state, module->body);
+            first = false;
+        }
+
+        symbols->future_features = state.future_features;
+        for(auto const & item : items) {
+            std::size_t blocks = symbols->module->children.size();
+            if(item) {
+                add_statement_from_ast(symbols, *item, add_err);
+            }
+            on_statement(item, symbols);
+            while(symbols->module->children.size() > blocks) {
+                forget_block(*symbols, symbols->module->children.back());
+                symbols->module->children.pop_back();
+            }
+        }
+
+        // Nothing before the current token is looked at again
+        items.clear();
+        statement = AstStmt();
+        while(!state.errors.empty()) {
+            state.errors.pop();
+        }
+        tokens.discard(state.position);
+        statement_arena.clear();
+    }
+    symbols->leave_block();
+    return true;
+}
+
+
+namespace {
+    int count_line_ends(char const * begin, char const * end) {
+        int count = 0;
+        for(; begin != end; ++begin) {
+            count += is_line_end(*begin) ? 1 : 0;
+        }
+        return count;
+    }
+
+    // First token of a statement, decorators included. A try statement with
+    // a finally clause is located at `finally`, without except clauses its
+    // start isn't known.
+    Ast const * statement_start(AstStmt const & stmt) {
+        AstExprList const * decorators = 0;
+        if(stmt->type == AstType::FunctionDef) {
+            decorators = &ast_cast<AstFunctionDef>(stmt)->decorators;
+        }
+        else if(stmt->type == AstType::ClassDef) {
+            decorators = &ast_cast<AstClassDef>(stmt)->decorators;
+        }
+        else if(stmt->type == AstType::TryFinally) {
+            AstStmt const & body = ast_cast<AstTryFinally>(stmt)->body;
+            return body && body->type == AstType::TryExcept ? statement_start(body) : 0;
+        }
+        if(decorators && !decorators->empty() && decorators->front()
+           && decorators->front()->line < stmt->line) {
+            return decorators->front().get();
+        }
+        return stmt.get();
+    }
+
+    // 0 if the start isn't known
+    int statement_line(AstStmt const & stmt) {
+        Ast const * start = statement_start(stmt);
+        return start ? start->line : 0;
+    }
+
+    struct shift_lines {
+        int delta;
+        // Only nodes from this line on are moved
+        int from;
+
+        template< typename T >
+        typename std::enable_if<std::is_base_of<Ast, T>::value, bool>::type
+        operator()(T & a) {
+            // Nodes which aren't located keep line 0
+            Ast & node = a;
+            if(node.line != 0 && int(node.line) >= from) {
+                node.line += delta;
+            }
+            return true;
+        }
+
+        template< typename T >
+        typename std::enable_if<!std::is_base_of<Ast, T>::value, bool>::type
+        operator()(T &) {
+            return true;
+        }
+    };
+
+    bool has_coding_declaration(std::string const & source) {
+        // Only the first two lines may declare the encoding
+        std::size_t second = source.find('\n');
+        std::size_t end = second == std::string::npos ? second : source.find('\n', second + 1);
+        return source.substr(0, end).find("coding") != std::string::npos;
+    }
+
+    bool ends_with_continuation(char const * begin, char const * end) {
+        if(end != begin && is_line_end(end[-1])) {
+            --end;
+        }
+        if(end != begin && end[-1] == '\r') {
+            --end;
+        }
+        return end != begin && end[-1] == '\\';
+    }
+
+    // Statements [first, last) of a suite, the source from `begin` (the
+    // start of line `begin_line`) to `end` holds them
+    struct StatementRange {
+        std::size_t first;
+        std::size_t last;
+        std::size_t begin;
+        std::size_t end;
+        std::size_t begin_line;
+    };
+
+    // Narrows `range` to the statements of `items` the edit from `offset` to
+    // `edit_end` touches. A statement which starts a line of its own starts
+    // at the beginning of the line, the range runs from the last one starting
+    // before the edit to the first one starting behind it. Statements on the
+    // line `previous` or before don't start a line of their own. With
+    // `from_start` the first statement starts at range.begin, otherwise one
+    // starting before the edit has to be found.
+    bool touched_statements(AstStmtList const & items, LineStarts & lines, std::size_t size,
+                            int previous, std::size_t offset, std::size_t edit_end,
+                            bool from_start, StatementRange & range) {
+        bool found = from_start;
+        range.last = items.size();
+        for(std::size_t i = 0; i < items.size(); ++i) {
+            if(!items[i]) {
+                return false;
+            }
+            // Tokens report the number of the line following theirs
+            int line = statement_line(items[i]);
+            if(line <= previous || line < 2) {
+                continue;
+            }
+            previous = line;
+            std::size_t start = lines.offset_of(std::size_t(line - 1));
+            if((from_start && i == 0) || start >= size || lines.before_unterminated_last_line(start)) {
+                continue;
+            }
+            if(start <= offset) {
+                range.first = i;
+                range.begin = start;
+                range.begin_line = std::size_t(line - 1);
+                found = true;
+            }
+            else if(start > edit_end) {
+                range.last = i;
+                range.end = start;
+                break;
+            }
+        }
+        return found;
+    }
+
+    // Leading whitespace of the first line from `begin` on which holds more
+    // than whitespace and a comment
+    std::string indentation(std::string const & source, std::size_t begin) {
+        while(begin < source.size()) {
+            std::size_t text = source.find_first_not_of(" \t\f", begin);
+            if(text == std::string::npos) {
+                break;
+            }
+            if(source[text] != '#' && !is_line_end(source[text])) {
+                return source.substr(begin, text - begin);
+            }
+            begin = source.find('\n', text);
+            begin = begin == std::string::npos ? source.size() : begin + 1;
+        }
+        return std::string();
+    }
+
+    // Suites holding the statements of the bodies of a compound statement
+    void statement_bodies(AstStmt const & stmt, std::vector<AstSuitePtr> & bodies) {
+        auto add = [&bodies](AstStmt const & body) {
+            if(!body) {
+                return;
+            }
+            if(body->type == AstType::Suite) {
+                bodies.push_back(ast_cast<AstSuite>(body));
+            }
+            else {
+                // elif, the inner statements of with and try/except/finally
+                statement_bodies(body, bodies);
+            }
+        };
+        switch(stmt->type) {
+        case AstType::FunctionDef:
+            add(ast_cast<AstFunctionDef>(stmt)->body);
+            break;
+        case AstType::ClassDef:
+            add(ast_cast<AstClassDef>(stmt)->body);
+            break;
+        case AstType::If:
+            add(ast_cast<AstIf>(stmt)->body);
+            add(ast_cast<AstIf>(stmt)->orelse);
+            break;
+        case AstType::For:
+            add(ast_cast<AstFor>(stmt)->body);
+            add(ast_cast<AstFor>(stmt)->orelse);
+            break;
+        case AstType::While:
+            add(ast_cast<AstWhile>(stmt)->body);
+            add(ast_cast<AstWhile>(stmt)->orelse);
+            break;
+        case AstType::With:
+            add(ast_cast<AstWith>(stmt)->body);
+            break;
+        case AstType::TryExcept:
+            add(ast_cast<AstTryExcept>(stmt)->body);
+            for(AstExceptPtr const & handler : ast_cast<AstTryExcept>(stmt)->handlers) {
+                if(handler) {
+                    add(handler->body);
+                }
+            }
+            add(ast_cast<AstTryExcept>(stmt)->orelse);
+            break;
+        case AstType::TryFinally:
+            add(ast_cast<AstTryFinally>(stmt)->body);
+            add(ast_cast<AstTryFinally>(stmt)->final_body);
+            break;
+        default:
+            break;
+        }
+    }
+
+    // The statements of a block lexed on its own, after a line break
+    // expect(s, Token::NewLine)* expect(s, Token::Indent) stmt+ expect(s, Token::Dedent) expect(s, Token::End)
+    bool indented_block(State & s, AstSuitePtr & suite_) {
+        while(expect(s, Token::NewLine));
+        location(s, create(s, suite_));
+        if(is(s, Token::EncodingError) || !expect(s, Token::Indent)) {
+            syntax_error(s, suite_, "invalid syntax");
+            return false;
+        }
+        AstStmt stmt_;
+        while(stmt(s, stmt_)) {
+            if(stmt_->type == AstType::Suite) {
+                flatten(stmt_, suite_->items);
+            }
+            else {
+                suite_->items.push_back(stmt_);
+            }
+            stmt_.reset();
+        }
+        if(!expect(s, Token::Dedent) && !is(s, Token::End)) {
+            indentation_error(s, suite_);
+            return false;
+        }
+        if(suite_->items.empty() || !is(s, Token::End)) {
+            syntax_error(s, suite_, "invalid syntax");
+            return false;
+        }
+        return true;
+    }
+}
+
+bool reparse(std::string & source,
+             TextEdit const & edit,
+             AstModulePtr & ast,
+             SymbolTablePtr & symbols,
+             ParserOptions options /*= ParserOptions()*/) {
+    std::size_t offset = std::min(edit.offset, source.size());
+    std::size_t length = std::min(edit.length, source.size() - offset);
+    String name = symbols ? symbols->file_name : String();
+    bool confined = ast && ast->body && symbols;
+
+    // Find the top level statements the edit touches. While that's a single
+    // compound statement, the statements of its body the edit touches are
+    // taken instead, as long as other statements of the body precede and
+    // follow them: the suite is located at its first statement, and the
+    // following one delimits the last. An edit of the first or last
+    // statement of a body takes the enclosing statement.
+    StatementRange range = {0, 0, 0, source.size(), 1};
+    AstSuitePtr suite_;     // Suite holding the range, the module body if not set
+    std::set<Ast const *> changed;
+    std::size_t top = 0;    // Top level statement holding the range
+    int next_line = 0;      // Line of the statement following the range
+    if(confined) {
+        LineStarts lines(source.data(), source.size());
+        std::size_t edit_end = offset + length;
+        confined = touched_statements(ast->body->items, lines, source.size(), 0,
+                                      offset, edit_end, true, range);
+        top = range.first;
+        AstStmtList * items = &ast->body->items;
+        bool narrowed = confined;
+        while(narrowed && range.last == range.first + 1) {
+            AstStmt const & owner = (*items)[range.first];
+            std::vector<AstSuitePtr> bodies;
+            statement_bodies(owner, bodies);
+            narrowed = false;
+            for(AstSuitePtr const & body : bodies) {
+                StatementRange inner = {0, 0, 0, 0, 0};
+                // Statements on the line of the compound statement follow
+                // the colon
+                if(touched_statements(body->items, lines, source.size(), statement_line(owner),
+                                      offset, edit_end, false, inner)
+                   && inner.first > 0 && inner.last < body->items.size()) {
+                    changed.insert(owner.get());
+                    suite_ = body;
+                    items = &body->items;
+                    range = inner;
+                    narrowed = true;
+                    break;
+                }
+            }
+        }
+        if(confined && range.last < items->size()) {
+            next_line = statement_line((*items)[range.last]);
+        }
+    }
+
+    int line_delta = count_line_ends(edit.text.data(), edit.text.data() + edit.text.size())
+                   - count_line_ends(source.data() + offset, source.data() + offset + length);
+    source.replace(offset, length, edit.text);
+    std::size_t begin = range.begin;
+    std::size_t end = range.end + edit.text.size() - length;
+
+    confined = confined
+        && std::search(source.begin() + begin, source.begin() + end,
+                       "__future__", "__future__" + 10) == source.begin() + end
+        && (begin == 0 || !has_coding_declaration(source))
+        && (end == source.size() || !ends_with_continuation(source.data() + begin, source.data() + end));
+
+    if(confined) {
+        // A body is lexed after a line break like in expand_body(), its
+        // first line is reported as line 3
+        std::string block = suite_ ? '\n' + source.substr(begin, end - begin) : std::string();
+        Lexer lexer(suite_ ? block.data() : source.data() + begin,
+                    suite_ ? block.size() : end - begin, name);
+        TokenStream tokens(lexer);
+        State state;
+        state.lexer = &lexer;
+        state.tokens = &tokens;
+        seek(state, 0);
+        state.options = options;
+        state.options.printerrors = false;
+        StatsReport report_stats(state);
+        bool failed = false;
+        state.options.error_handler = [&failed](Error) { failed = true; };
+        state.future_features = symbols->future_features;
+
+        AstModulePtr region;
+        AstSuitePtr replacement;
+        int shift = int(range.begin_line) - (suite_ ? 2 : 1);
+        if(suite_) {
+            // The statements have to stay in the suite, indented like the
+            // statement following them
+            confined = indentation(source, begin) == indentation(source, end)
+                && indented_block(state, replacement);
+        }
+        else {
+            confined = !is(state, Token::EncodingError)
+                && file_input(state, region, range.first == 0);
+            replacement = confined ? region->body : AstSuitePtr();
+        }
+
+        if(confined && !failed) {
+            AstStmtList & items = suite_ ? suite_->items : ast->body->items;
+            if(shift != 0) {
+                walk_tree(replacement->items, shift_lines{shift, 0});
+            }
+            if(line_delta != 0 && next_line != 0) {
+                // Everything from the following statement on moves
+                AstStmtList & module_items = ast->body->items;
+                for(std::size_t i = top; i < module_items.size(); ++i) {
+                    if(module_items[i]) {
+                        walk_tree(*module_items[i], shift_lines{line_delta, next_line});
+                    }
+                }
+            }
+            items.erase(items.begin() + range.first, items.begin() + range.last);
+            items.insert(items.begin() + range.first, replacement->items.begin(), replacement->items.end());
+            if(range.first == 0 && !suite_) {
+                // The module is located at its first token, and the first
+                // statement might be a docstring now
+                clone_location(*region, *ast);
+                clone_location(*region->body, *ast->body);
+                make_docstring(state, ast->body);
+            }
+
+            state.options = options;
+            SymbolTablePtr table = std::make_shared<SymbolTable>();
+            table->future_features = symbols->future_features;
+            table->file_name = name;
+            int first_line = int(range.begin_line) + 1;
+            int last_line = next_line != 0 ? next_line + line_delta : std::numeric_limits<int>::max();
+            update_from_ast(table, symbols, *ast, changed, first_line, last_line,
+                            [&state, &name, shift](Error e) {
+                                e.file_name = name;
+                                e.line = state.lexer->get_line(e.cur.line - shift);
+                                state.errors.push(e);
+                                report_error(state);
+                            });
+            symbols = table;
+            return true;
+        }
+    }
+
+    Lexer lexer(source.data(), source.size(), name);
+    return parse(lexer, ast, symbols, options);
+}
+
+namespace {
+    struct collect_lazy_bodies {
+        std::vector<AstFunctionDef *> * functions;
+
+        bool operator()(AstFunctionDef & f) {
+            if(f.body && f.body->type == AstType::LazySuite) {
+                functions->push_back(&f);
+            }
+            return true;
+        }
+
+        template< typename T >
+        bool operator()(T &) {
+            return true;
+        }
+    };
+}
+
+bool expand_body(AstFunctionDef & function,
+                 SymbolTable const & symbols,
+                 ParserOptions options /*= ParserOptions()*/) {
+    if(!function.body || function.body->type != AstType::LazySuite) {
+        return true;
+    }
+    AstLazySuitePtr lazy = ast_cast<AstLazySuite>(function.body);
+    // The lexer counts whitespace at the very start of a source unlike the
+    // indentation after a line break, a tab would move the columns of the
+    // first line. Starting with a line break puts it in the state it was in
+    // when it reached the body in the module.
+    std::string source = '\n' + lazy->source;
+    Lexer lexer(source.data(), source.size(), symbols.file_name);
+    TokenStream tokens(lexer);
+    State state;
+    state.lexer = &lexer;
+    state.tokens = &tokens;
+    seek(state, 0);
+    state.options = options;
+    state.future_features = symbols.future_features;
+    StatsReport report_stats(state);
+
+    // The body is lexed on its own after the line break, its first line is
+    // reported as line 3 like the second line of a module. Errors are
+    // reported with the lines of the module.
+    int shift = lazy->line - 3;
+    State report;
+    report.options = options;
+    state.options.printerrors = false;
+    state.options.error_handler = [&report, shift](Error e) {
+        e.cur.line += shift;
+        report.errors.push(e);
+        report_error(report);
+    };
+
+    AstSuitePtr suite_;
+    if(!indented_block(state, suite_)) {
+        return false;
+    }
+    make_docstring(state, suite_);
+    if(shift != 0) {
+        walk_tree(*suite_, shift_lines{shift, 0});
+    }
+    function.body = suite_;
+    return true;
+}
+
+bool expand_bodies(Ast & tree,
+                   SymbolTable const & symbols,
+                   ParserOptions options /*= ParserOptions()*/) {
+    options.lazy_bodies = false;
+    std::vector<AstFunctionDef *> functions;
+    walk_tree(tree, collect_lazy_bodies{&functions});
+    bool result = true;
+    for(AstFunctionDef * f : functions) {
+        result = expand_body(*f, symbols, options) && result;
+    }
+    return result;
+}
+
 }
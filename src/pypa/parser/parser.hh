@@ -14,15 +14,39 @@
 #ifndef GUARD_PYPA_PARSER_PARSER_HH_INCLUDED
 #define GUARD_PYPA_PARSER_PARSER_HH_INCLUDED
 
+#include <cstdint>
 #include <functional>
+#include <string>
 
 #include <pypa/ast/ast.hh>
 #include <pypa/lexer/lexer.hh>
+#include <pypa/lexer/token_stream.hh>
 #include <pypa/parser/symbol_table.hh>
 #include <pypa/types.hh>
 
 namespace pypa {
 
+class ParseCache;
+
+// Counters of the work done by the parser, see ParserOptions::stats
+struct ParseStats {
+    ParseStats()
+    : savepoints(0), reverts(0), literal_elements(0)
+    {}
+
+    std::uint64_t savepoints;   // Rule attempts that could be reverted
+    std::uint64_t reverts;      // Rule attempts that were reverted
+    std::uint64_t literal_elements; // Display elements built directly
+                                    // (literal_elements option)
+
+    ParseStats & operator+=(ParseStats const & o) {
+        savepoints += o.savepoints;
+        reverts += o.reverts;
+        literal_elements += o.literal_elements;
+        return *this;
+    }
+};
+
 struct ParserOptions {
     ParserOptions()
     : python3only(false)
@@ -33,6 +57,11 @@ struct ParserOptions {
     , handle_future_errors(true)
     , error_handler()
     , perform_inline_optimizations(false)
+    , lazy_bodies(false)
+    , literal_elements(true)
+    , stats(0)
+    , arena(0)
+    , cache(0)
     {}
 
     bool python3only;          // If it is parsing python3
@@ -54,13 +83,106 @@ struct ParserOptions {
                               )> escape_handler;
     bool perform_inline_optimizations; // If inline optimizations should be
                                        // performed
+    bool lazy_bodies;          // Function bodies spanning lines are kept as
+                               // AstLazySuite and parsed by expand_body().
+                               // Syntax errors in them are only found then.
+    bool literal_elements;     // Builds numbers, strings and names in list,
+                               // tuple, set and dict displays without going
+                               // through the expression rules. The tree is
+                               // the same, this is for generated data
+                               // modules with huge literals.
+    ParseStats * stats;        // The counters of each parse are added to
+                               // it, optional
+    AstArena * arena;          // Owns the AST nodes, required when built with
+                               // PYPA_AST_ARENA and ignored otherwise. Must
+                               // outlive the resulting AST
+    ParseCache * cache;        // Results are looked up in and stored to the
+                               // cache by parse(Lexer &, ...), optional
 };
 
+// Thread safety: parse() only uses the state reachable from its arguments,
+// the lexer tables are constexpr data. Concurrent calls are safe as long as
+// they don't share a Lexer, TokenStream or AstArena. options.error_handler
+// and options.escape_handler are called on the parsing thread.
 bool parse(Lexer & lexer,
            AstModulePtr & ast,
            SymbolTablePtr & symbols,
            ParserOptions options = ParserOptions());
 
+// Parses the tokens of `tokens`, reading them from its lexer as needed.
+// A stream filled with TokenStream::read_all() can be parsed repeatedly.
+bool parse(TokenStream & tokens,
+           AstModulePtr & ast,
+           SymbolTablePtr & symbols,
+           ParserOptions options = ParserOptions());
+
+// Parses the body of `function` if it was kept as AstLazySuite (see
+// ParserOptions::lazy_bodies) and replaces it by the parsed suite. With
+// options.lazy_bodies the function bodies in it stay lazy in turn.
+// `symbols` is the table of the module, its file name and __future__
+// features are used, it isn't updated: blocks of functions parsed lazily
+// only know the parameters. New nodes are created in options.arena, as for
+// reparse(). Returns false and keeps the lazy body if it doesn't parse.
+bool expand_body(AstFunctionDef & function,
+                 SymbolTable const & symbols,
+                 ParserOptions options = ParserOptions());
+
+// Expands all lazy function bodies in `tree`, including the nested ones
+bool expand_bodies(Ast & tree,
+                   SymbolTable const & symbols,
+                   ParserOptions options = ParserOptions());
+
+// Called by parse_statements() for every top level statement. `symbols` is
+// the table of the module parsed so far, it has the module block and the
+// blocks of `statement`.
+typedef std::function<void(AstStmt const & statement,
+                           SymbolTablePtr const & symbols)> StatementHandler;
+
+// Streaming variant of parse(Lexer &, ...) for very large modules. Instead
+// of building the module, every top level statement is passed to
+// `on_statement` as soon as it's parsed, afterwards the parser drops its
+// references to the statement, its symbol table blocks and its tokens.
+// Memory use stays proportional to the largest statement (and the number of
+// module level names) as long as the lexer doesn't keep the source itself,
+// i.e. with a mapped file or a caller owned buffer. Their line index is only
+// built when a line is looked up for an error or a lazy suite.
+// Statements separated by ';' are passed one by one, a module docstring is
+// converted as by parse(). Parsing stops at the first syntax error, the
+// statements before it were passed already. options.cache isn't used.
+// In PYPA_AST_ARENA builds options.arena isn't used either: the nodes come
+// from an arena which is cleared after every statement, so they're only
+// valid during the call.
+bool parse_statements(Lexer & lexer,
+                      StatementHandler on_statement,
+                      ParserOptions options = ParserOptions());
+
+// Replaces `length` bytes at `offset` with `text`
+struct TextEdit {
+    std::size_t offset;
+    std::size_t length;
+    std::string text;
+};
+
+// Applies `edit` to `source`, the text `ast` and `symbols` were parsed from,
+// and updates both for the new text. Only the statements touched by the edit
+// are lexed and parsed again: the top level statements, or the statements of
+// a suite (function, class, if, for, ...) if other statements of the suite
+// precede and follow them. The other statements are kept and moved to their
+// new lines, the symbol table blocks of the kept statements are copied from
+// `symbols`, the blocks holding the parsed ones are rebuilt. The previous
+// table isn't modified.
+// If the edit can't be confined to these statements (e.g. it opens a string
+// or bracket, touches a __future__ import or doesn't parse) the whole source
+// is parsed instead. Errors are reported for the parsed statements only.
+// New nodes are created in options.arena, it has to be the arena the nodes
+// of `ast` live in (or outlive it). `ast` and `symbols` are updated in place,
+// the result is the same as parsing the new source with parse().
+bool reparse(std::string & source,
+             TextEdit const & edit,
+             AstModulePtr & ast,
+             SymbolTablePtr & symbols,
+             ParserOptions options = ParserOptions());
+
 }
 
 #endif // GUARD_PYPA_PARSER_PARSER_HH_INCLUDED
@@ -18,11 +18,8 @@
 
 namespace pypa {
 
-    bool and_expr(State & s, AstExpr & ast);
-    bool and_test(State & s, AstExpr & ast);
     bool arglist(State & s, AstArguments & ast);
     bool argument(State & s, AstExpr & ast);
-    bool arith_expr(State & s, AstExpr & ast);
     bool assert_stmt(State & s, AstStmt & ast);
     bool atom(State & s, AstExpr & ast);
 #if 0
@@ -33,7 +30,6 @@ namespace pypa {
     bool comp_for(State & s, AstExprList & ast);
     bool comp_if(State & s, AstExpr & ast);
     bool comp_op(State & s, AstCompareOpType & op);
-    bool comparison(State & s, AstExpr & ast);
     bool compound_stmt(State & s, AstStmt & ast);
     bool continue_stmt(State & s, AstStmt & ast);
     bool decorated(State & s, AstStmt & ast);
@@ -54,7 +50,7 @@ namespace pypa {
     bool expr_stmt(State & s, AstStmt & ast);
     bool exprlist(State & s, AstExpr & ast);
     bool factor(State & s, AstExpr & ast);
-    bool file_input(State & s, AstModulePtr & ast);
+    bool file_input(State & s, AstModulePtr & ast, bool module_docstring = true);
     bool flow_stmt(State & s, AstStmt & ast);
     bool for_stmt(State & s, AstStmt & ast);
     bool fpdef(State & s, AstExpr & ast);
@@ -68,10 +64,10 @@ namespace pypa {
     bool import_name(State & s, AstStmt & ast);
     bool import_stmt(State & s, AstStmt & ast);
     bool lambdef(State & s, AstExpr & ast);
+    bool lazy_suite(State & s, AstStmt & ast);
     bool list_for(State & s, AstExprList & ast);
     bool list_if(State & s, AstExpr & ast);
     bool listmaker(State & s, AstExpr & ast);
-    bool not_test(State & s, AstExpr & ast);
     bool old_lambdef(State & s, AstExpr & ast);
     bool old_test(State & s, AstExpr & ast);
     bool or_test(State & s, AstExpr & ast);
@@ -81,7 +77,6 @@ namespace pypa {
     bool print_stmt(State & s, AstStmt & ast);
     bool raise_stmt(State & s, AstStmt & ast);
     bool return_stmt(State & s, AstStmt & ast);
-    bool shift_expr(State & s, AstExpr & ast);
     bool simple_stmt(State & s, AstStmt & ast);
 #if 0
     bool single_input(State & s, AstModulePtr & ast);
@@ -92,7 +87,6 @@ namespace pypa {
     bool subscript(State & s, AstSliceTypePtr & ast);
     bool subscriptlist(State & s, AstExtSlice & ast);
     bool suite(State & s, AstStmt & ast);
-    bool term(State & s, AstExpr & ast);
     bool test(State & s, AstExpr & ast);
     bool testlist(State & s, AstExpr & ast);
     bool testlist1(State & s, AstExpr & ast);
@@ -105,7 +99,6 @@ namespace pypa {
     bool varargslist(State & s, AstArguments & ast);
     bool while_stmt(State & s, AstStmt & ast);
     bool with_stmt(State & s, AstStmt & ast);
-    bool xor_expr(State & s, AstExpr & ast);
     bool yield_expr(State & s, AstExpr & ast);
     bool yield_stmt(State & s, AstStmt & ast);
 
@@ -0,0 +1,106 @@
+// Copyright 2014 Vinzenz Feenstra
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include <pypa/parser/test_helper.hh>
+
+// Differential test of reparse() against parsing the edited source
+//
+//   reparse-test files...  - applies a series of edits to each file, after
+//                            every edit the AST and symbol table updated by
+//                            reparse() have to match a full parse, the table
+//                            it replaced has to stay as it was
+
+using pypa::test::Parsed;
+
+namespace {
+    std::string print(Parsed const & parsed) {
+        if (!parsed.success) {
+            return "failed";
+        }
+        std::string result = parsed.tree();
+        if (parsed.symbols && parsed.symbols->module) {
+            result += pypa::test::describe(parsed.symbols->module);
+        }
+        return result;
+    }
+
+    // Edits around the start of `line`, each pair restores the source
+    std::vector<pypa::TextEdit> edits_at(std::string const & source, std::size_t start) {
+        std::size_t end = source.find('\n', start);
+        end = end == std::string::npos ? source.size() : end;
+        std::string line = source.substr(start, end - start);
+        std::size_t middle = start + (end - start) / 2;
+        std::vector<pypa::TextEdit> edits = {
+            {start, 0, "x = 1\n"}, {start, 6, ""},
+            {start, 0, "\n\n"}, {start, 2, ""},
+            {start, end - start, ""}, {start, 0, line},
+            {middle, 0, "a"}, {middle, 1, ""},
+            {middle, 0, "("}, {middle, 1, ""},
+            {middle, 0, "'''"}, {middle, 3, ""},
+            {start, 0, "  "}, {start, 2, ""},
+        };
+        if (end != source.size()) {
+            edits.push_back({end, 1, ""});
+            edits.push_back({end, 0, "\n"});
+        }
+        return edits;
+    }
+
+    int check_file(char const * file) {
+        std::string source = pypa::test::read_file(file);
+
+        Parsed incremental;
+        incremental.parse(source);
+        if (!incremental.success) {
+            printf("%s: skipped, doesn't parse\n", file);
+            return 0;
+        }
+        std::vector<std::size_t> starts(1, 0);
+        for (std::size_t i = 0; i + 1 < source.size(); ++i) {
+            if (source[i] == '\n') {
+                starts.push_back(i + 1);
+            }
+        }
+        std::size_t count = 0;
+        for (std::size_t start : starts) {
+            for (auto const & edit : edits_at(source, start)) {
+                Parsed expected;
+                std::string text = source;
+                text.replace(edit.offset, edit.length, edit.text);
+                expected.parse(text);
+
+                pypa::SymbolTablePtr previous = incremental.symbols;
+                std::string previous_symbols = previous && previous->module ? pypa::test::describe(previous->module) : "";
+                incremental.success = pypa::reparse(source, edit, incremental.ast, incremental.symbols,
+                                                    incremental.options());
+                ++count;
+                if (source != text || print(incremental) != print(expected)) {
+                    fprintf(stderr, "%s: edit %zu (+%zu -%zu '%s') differs\n", file, count,
+                            edit.offset, edit.length, edit.text.c_str());
+                    return 1;
+                }
+                if (previous && previous->module && pypa::test::describe(previous->module) != previous_symbols) {
+                    fprintf(stderr, "%s: edit %zu (+%zu -%zu '%s') changed the previous symbol table\n",
+                            file, count, edit.offset, edit.length, edit.text.c_str());
+                    return 1;
+                }
+            }
+        }
+        printf("%s: %zu edits\n", file, count);
+        return 0;
+    }
+}
+
+int main(int argc, char const ** argv) {
+    return pypa::test::run(argc, argv, check_file);
+}
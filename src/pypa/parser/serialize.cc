@@ -0,0 +1,1056 @@
+// Copyright 2014 Vinzenz Feenstra
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <type_traits>
+#include <unordered_set>
+#include <unordered_map>
+#include <vector>
+
+#include <pypa/parser/serialize.hh>
+#include <pypa/ast/visitor.hh>
+#include <pypa/mmap_reader.hh>
+
+namespace pypa {
+namespace {
+    // Layout, in native byte order. All sections are 4 byte aligned, so the
+    // encoding can be used straight from a mapped file.
+    //
+    //   Header
+    //   NodeRecord nodes[nodes]                children before their parents,
+    //                                          the module is the last one
+    //   uint32_t   slots[slots]                member values of the nodes
+    //   uint32_t   string_offsets[strings + 1]
+    //   uint32_t   symbols[symbols]            see Writer::table()
+    //   char       string_data[string_bytes]   padded to 4 bytes
+    //
+    // The members of a node are stored in consecutive slots starting at
+    // NodeRecord::slots, in the order of its PYPA_AST_MEMBERS list:
+    //
+    //   node pointer       index of the node's record + 1, 0 for null
+    //   node held by value index of its record + 1 (flagged NodeFlag_ByValue)
+    //   std::vector        first slot and number of slots of the elements
+    //   String             index into the string table
+    //   bool, ints, enums  the value (int, uint32_t)
+    //   double, int64_t    raw bytes, two slots
+    enum : uint32_t {
+        Magic   = 0x41505950, // "PYPA"
+        Version = SerializeFormatVersion
+    };
+
+    struct Header {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t nodes;
+        uint32_t slots;
+        uint32_t strings;
+        uint32_t string_bytes;
+        uint32_t symbols;
+        uint32_t reserved;
+    };
+
+    enum NodeFlags {
+        NodeFlag_ByValue = 1 << 0
+    };
+
+    struct NodeRecord {
+        uint16_t type;
+        uint16_t flags;
+        uint32_t line;
+        uint32_t column;
+        uint32_t slots;
+    };
+
+    static_assert(sizeof(Header) == 32 && sizeof(NodeRecord) == 16, "Unexpected padding");
+
+    struct Sections {
+        Header const * header;
+        NodeRecord const * nodes;
+        uint32_t const * slots;
+        uint32_t const * string_offsets;
+        uint32_t const * symbols;
+        char const * string_data;
+    };
+
+    // Checks the header and the size of `data`, which has to be aligned
+    bool locate(char const * data, std::size_t length, Sections & s) {
+        if(length < sizeof(Header)) {
+            return false;
+        }
+        Header const & header = *reinterpret_cast<Header const *>(data);
+        uint64_t size = sizeof(Header)
+                      + uint64_t(header.nodes) * sizeof(NodeRecord)
+                      + (uint64_t(header.slots) + header.strings + 1 + header.symbols) * sizeof(uint32_t)
+                      + header.string_bytes;
+        if(header.magic != Magic || header.version != Version || size > length) {
+            return false;
+        }
+        s.header = &header;
+        s.nodes = reinterpret_cast<NodeRecord const *>(data + sizeof(Header));
+        s.slots = reinterpret_cast<uint32_t const *>(s.nodes + header.nodes);
+        s.string_offsets = s.slots + header.slots;
+        s.symbols = s.string_offsets + header.strings + 1;
+        s.string_data = reinterpret_cast<char const *>(s.symbols + header.symbols);
+        return true;
+    }
+
+    enum EntryFlags {
+        EntryFlag_Nested            = 1 << 0,
+        EntryFlag_ReturnsValue      = 1 << 1,
+        EntryFlag_Varargs           = 1 << 2,
+        EntryFlag_Varkw             = 1 << 3,
+        EntryFlag_Generator         = 1 << 4,
+        EntryFlag_InLoop            = 1 << 5,
+        EntryFlag_InFinally         = 1 << 6,
+        EntryFlag_FreeVars          = 1 << 7,
+        EntryFlag_ChildFreeVars     = 1 << 8
+    };
+
+    enum FutureFlags {
+        FutureFlag_NestedScopes     = 1 << 0,
+        FutureFlag_Generators       = 1 << 1,
+        FutureFlag_Division         = 1 << 2,
+        FutureFlag_AbsoluteImports  = 1 << 3,
+        FutureFlag_WithStatement    = 1 << 4,
+        FutureFlag_PrintFunction    = 1 << 5,
+        FutureFlag_UnicodeLiterals  = 1 << 6
+    };
+
+    inline uint32_t flag(bool value, uint32_t f) {
+        return value ? f : 0;
+    }
+
+    class Writer {
+    public:
+        std::vector<NodeRecord> nodes;
+        std::vector<uint32_t> slots;
+        std::vector<uint32_t> string_offsets;
+        std::string string_data;
+        std::vector<uint32_t> symbols;
+
+        Writer(SymbolTable const & t)
+        : string_offsets(1, 0)
+        , depth_(0)
+        {
+            for(auto const & e : t.symbols) {
+                block_ids_.insert(e.first);
+            }
+        }
+
+        uint32_t string(String const & s) {
+            auto it = string_ids_.find(s);
+            if(it != string_ids_.end()) {
+                return it->second;
+            }
+            uint32_t id = uint32_t(string_offsets.size() - 1);
+            string_data += s;
+            string_offsets.push_back(uint32_t(string_data.size()));
+            string_ids_.emplace(s, id);
+            return id;
+        }
+
+        // Writes the record of `t` after the records of its children,
+        // returns its index + 1
+        template< typename T >
+        uint32_t add(T & t, uint16_t flags);
+        uint32_t node(Ast & a);
+
+        void table(SymbolTable const & t);
+
+        // Scratch buffer for the slots of a node or list being written, the
+        // nodes and lists nested in it get their own
+        std::vector<uint32_t> & enter() {
+            if(depth_ == scratch_.size()) {
+                scratch_.emplace_back();
+            }
+            scratch_[depth_].clear();
+            return scratch_[depth_++];
+        }
+
+        void leave() {
+            --depth_;
+        }
+
+    private:
+        void entry(SymbolTableEntry const & e);
+
+        uint32_t node_id(void const * p) const {
+            auto it = node_ids_.find(p);
+            return it == node_ids_.end() ? 0 : it->second;
+        }
+
+        std::unordered_map<String, uint32_t> string_ids_;
+        // Nodes with a symbol table block and the indexes they got
+        std::unordered_set<void const *> block_ids_;
+        std::unordered_map<void const *, uint32_t> node_ids_;
+        std::deque<std::vector<uint32_t>> scratch_;
+        std::size_t depth_;
+    };
+
+    struct encode_member {
+        Writer * w;
+        std::vector<uint32_t> * out;
+        // ast_member_visit::apply() passes the node itself first
+        bool self_;
+
+        template< typename T >
+        typename std::enable_if<std::is_base_of<Ast, T>::value, bool>::type
+        operator()(T & t) {
+            if(self_) {
+                self_ = false;
+            }
+            else {
+                out->push_back(w->add(t, NodeFlag_ByValue));
+            }
+            return true;
+        }
+
+        template< typename T >
+        bool operator()(AstPtrT<T> & t) {
+            out->push_back(t ? w->node(*t) : 0);
+            return true;
+        }
+
+        template< typename T >
+        bool operator()(std::vector<T> & t) {
+            std::vector<uint32_t> & items = w->enter();
+            encode_member item{w, &items, false};
+            for(auto & e : t) {
+                item(e);
+            }
+            out->push_back(uint32_t(w->slots.size()));
+            out->push_back(uint32_t(items.size()));
+            w->slots.insert(w->slots.end(), items.begin(), items.end());
+            w->leave();
+            return true;
+        }
+
+        template< typename T >
+        typename std::enable_if<std::is_enum<T>::value, bool>::type
+        operator()(T & t) {
+            out->push_back(uint32_t(t));
+            return true;
+        }
+
+        bool operator()(String & t) {
+            out->push_back(w->string(t));
+            return true;
+        }
+
+        bool operator()(bool & t) {
+            out->push_back(t ? 1 : 0);
+            return true;
+        }
+
+        bool operator()(int & t) {
+            out->push_back(uint32_t(t));
+            return true;
+        }
+
+        bool operator()(uint32_t & t) {
+            out->push_back(t);
+            return true;
+        }
+
+        bool operator()(double & t) {
+            return raw(&t, sizeof(t));
+        }
+
+        bool operator()(int64_t & t) {
+            return raw(&t, sizeof(t));
+        }
+
+        template< std::size_t N >
+        bool operator()(char (&t)[N]) {
+            return raw(t, N);
+        }
+
+        bool raw(void const * p, std::size_t size) {
+            for(std::size_t i = 0; i < size; i += sizeof(uint32_t)) {
+                uint32_t v = 0;
+                std::memcpy(&v, static_cast<char const *>(p) + i, std::min(sizeof(v), size - i));
+                out->push_back(v);
+            }
+            return true;
+        }
+    };
+
+    struct add_node {
+        Writer * w;
+
+        template< typename T >
+        uint32_t operator()(T & t) {
+            return w->add(t, 0);
+        }
+    };
+
+    template< typename T >
+    uint32_t Writer::add(T & t, uint16_t flags) {
+        std::vector<uint32_t> & members = enter();
+        ast_member_visit<AstIDByType<T>::Id>::apply(t, encode_member{this, &members, true});
+        Ast const & a = t;
+        nodes.push_back({uint16_t(a.type), flags, a.line, a.column, uint32_t(slots.size())});
+        slots.insert(slots.end(), members.begin(), members.end());
+        leave();
+        if(block_ids_.count(&a)) {
+            node_ids_[&a] = uint32_t(nodes.size());
+        }
+        return uint32_t(nodes.size());
+    }
+
+    uint32_t Writer::node(Ast & a) {
+        return visit<uint32_t>(add_node{this}, a);
+    }
+
+    // future features, future last line, current class, 1 if there's a
+    // module entry followed by the module entry
+    void Writer::table(SymbolTable const & t) {
+        FutureFeatures const & f = t.future_features;
+        symbols.push_back(flag(f.nested_scopes, FutureFlag_NestedScopes)
+                        | flag(f.generators, FutureFlag_Generators)
+                        | flag(f.division, FutureFlag_Division)
+                        | flag(f.absolute_imports, FutureFlag_AbsoluteImports)
+                        | flag(f.with_statement, FutureFlag_WithStatement)
+                        | flag(f.print_function, FutureFlag_PrintFunction)
+                        | flag(f.unicode_literals, FutureFlag_UnicodeLiterals));
+        symbols.push_back(uint32_t(f.last_line));
+        symbols.push_back(string(t.current_class));
+        symbols.push_back(t.module ? 1 : 0);
+        if(t.module) {
+            entry(*t.module);
+        }
+    }
+
+    // id (node index + 1), type, name, flags, start line, temp name count,
+    // unoptimized, opt last line, the number of symbols followed by (name,
+    // flags) pairs, the number of variables followed by their names and the
+    // number of children followed by the children. Symbols and variables are
+    // sorted by name to get the same encoding for the same table.
+    void Writer::entry(SymbolTableEntry const & e) {
+        symbols.insert(symbols.end(), {
+            node_id(e.id),
+            uint32_t(e.type),
+            string(e.name),
+            flag(e.is_nested, EntryFlag_Nested)
+            | flag(e.returns_value, EntryFlag_ReturnsValue)
+            | flag(e.has_varargs, EntryFlag_Varargs)
+            | flag(e.has_varkw, EntryFlag_Varkw)
+            | flag(e.is_generator, EntryFlag_Generator)
+            | flag(e.in_loop, EntryFlag_InLoop)
+            | flag(e.in_finally, EntryFlag_InFinally)
+            | flag(e.has_free_vars, EntryFlag_FreeVars)
+            | flag(e.child_has_free_vars, EntryFlag_ChildFreeVars),
+            uint32_t(e.start_line),
+            uint32_t(e.temp_name_count),
+            e.unoptimized,
+            uint32_t(e.opt_last_line)
+        });
+
+        typedef std::pair<String const, uint32_t> Symbol;
+        std::vector<Symbol const *> sorted;
+        for(auto const & s : e.symbols) {
+            sorted.push_back(&s);
+        }
+        std::sort(sorted.begin(), sorted.end(), [](Symbol const * a, Symbol const * b) {
+            return a->first < b->first;
+        });
+        symbols.push_back(uint32_t(sorted.size()));
+        for(auto s : sorted) {
+            symbols.push_back(string(s->first));
+            symbols.push_back(s->second);
+        }
+
+        std::vector<String> variables(e.variables.begin(), e.variables.end());
+        std::sort(variables.begin(), variables.end());
+        symbols.push_back(uint32_t(variables.size()));
+        for(auto const & v : variables) {
+            symbols.push_back(string(v));
+        }
+
+        symbols.push_back(uint32_t(e.children.size()));
+        for(auto const & child : e.children) {
+            entry(*child);
+        }
+    }
+
+    template< typename T >
+    void append(std::string & out, T const * data, std::size_t count) {
+        out.append(reinterpret_cast<char const *>(data), count * sizeof(T));
+    }
+
+    // Whether a node of type `type` can be held by an AstPtrT<T>
+    template< typename T >
+    bool holds(AstType type) {
+        switch(type) {
+#undef PYPA_AST_TYPE
+#define PYPA_AST_TYPE(X) case AstType::X: return std::is_base_of<T, AstTypeByID<AstType::X>::Type>::value;
+#   include <pypa/ast/ast_type.inl>
+#undef PYPA_AST_TYPE
+        default:
+            break;
+        }
+        return false;
+    }
+
+    AstPtr create(AstType type, AstArena * arena) {
+        switch(type) {
+#undef PYPA_AST_TYPE
+#define PYPA_AST_TYPE(X) case AstType::X: return make_ast<AstTypeByID<AstType::X>::Type>(arena);
+#   include <pypa/ast/ast_type.inl>
+#undef PYPA_AST_TYPE
+        default:
+            break;
+        }
+        return AstPtr();
+    }
+
+    class Decoder {
+    public:
+        Decoder(Sections const & s, AstArena * arena)
+        : ok(true)
+        , arena(arena)
+        , header(*s.header)
+        , nodes(s.nodes)
+        , slots(s.slots)
+        , string_offsets(s.string_offsets)
+        , symbols(s.symbols)
+        , string_data(s.string_data)
+        , symbol_pos_(symbols)
+        {}
+
+        bool ok;
+        AstArena * arena;
+        Header header;
+        NodeRecord const * nodes;
+        uint32_t const * slots;
+        uint32_t const * string_offsets;
+        uint32_t const * symbols;
+        char const * string_data;
+        // The nodes decoded so far, null for nodes held by value
+        std::vector<AstPtr> built;
+
+        void string(uint32_t id, String & s) {
+            if(id >= header.strings || string_offsets[id] > string_offsets[id + 1]
+                                    || string_offsets[id + 1] > header.string_bytes) {
+                ok = false;
+                return;
+            }
+            s.assign(string_data + string_offsets[id], string_offsets[id + 1] - string_offsets[id]);
+        }
+
+        template< typename T >
+        void fill(T & t, NodeRecord const & r);
+        AstModulePtr tree();
+        void table(SymbolTable & t);
+
+    private:
+        uint32_t next_symbol() {
+            if(symbol_pos_ == symbols + header.symbols) {
+                ok = false;
+                return 0;
+            }
+            return *symbol_pos_++;
+        }
+
+        String symbol_string() {
+            String s;
+            string(next_symbol(), s);
+            return s;
+        }
+
+        SymbolTableEntryPtr entry(SymbolTable & t);
+
+        uint32_t const * symbol_pos_;
+    };
+
+    struct decode_member {
+        Decoder * d;
+        uint32_t const ** pos;
+        uint32_t const * end;
+        bool self_;
+
+        uint32_t next() {
+            if(*pos == end) {
+                d->ok = false;
+                return 0;
+            }
+            return *(*pos)++;
+        }
+
+        template< typename T >
+        typename std::enable_if<std::is_base_of<Ast, T>::value, bool>::type
+        operator()(T & t) {
+            if(self_) {
+                self_ = false;
+                return true;
+            }
+            uint32_t id = next();
+            if(id == 0 || id > d->built.size() || !(d->nodes[id - 1].flags & NodeFlag_ByValue)
+                       || d->nodes[id - 1].type != uint16_t(AstIDByType<T>::Id)) {
+                d->ok = false;
+                return true;
+            }
+            d->fill(t, d->nodes[id - 1]);
+            return true;
+        }
+
+        template< typename T >
+        bool operator()(AstPtrT<T> & t) {
+            uint32_t id = next();
+            if(id == 0) {
+                t.reset();
+            }
+            else if(id > d->built.size() || !d->built[id - 1] || !holds<T>(d->built[id - 1]->type)) {
+                d->ok = false;
+            }
+            else {
+                t = ast_cast<T>(d->built[id - 1]);
+            }
+            return true;
+        }
+
+        template< typename T >
+        bool operator()(std::vector<T> & t) {
+            uint64_t first = next();
+            uint64_t count = next();
+            if(first + count > d->header.slots) {
+                d->ok = false;
+                return true;
+            }
+            uint32_t const * items = d->slots + first;
+            decode_member item{d, &items, items + count, false};
+            t.clear();
+            t.reserve(std::size_t(count));
+            while(items != item.end && d->ok) {
+                T e = T();
+                item(e);
+                t.push_back(e);
+            }
+            return true;
+        }
+
+        template< typename T >
+        typename std::enable_if<std::is_enum<T>::value, bool>::type
+        operator()(T & t) {
+            t = T(next());
+            return true;
+        }
+
+        bool operator()(String & t) {
+            d->string(next(), t);
+            return true;
+        }
+
+        bool operator()(bool & t) {
+            t = next() != 0;
+            return true;
+        }
+
+        bool operator()(int & t) {
+            t = int(next());
+            return true;
+        }
+
+        bool operator()(uint32_t & t) {
+            t = next();
+            return true;
+        }
+
+        bool operator()(double & t) {
+            return raw(&t, sizeof(t));
+        }
+
+        bool operator()(int64_t & t) {
+            return raw(&t, sizeof(t));
+        }
+
+        template< std::size_t N >
+        bool operator()(char (&t)[N]) {
+            return raw(t, N);
+        }
+
+        bool raw(void * p, std::size_t size) {
+            for(std::size_t i = 0; i < size; i += sizeof(uint32_t)) {
+                uint32_t v = next();
+                std::memcpy(static_cast<char *>(p) + i, &v, std::min(sizeof(v), size - i));
+            }
+            return true;
+        }
+    };
+
+    struct fill_node {
+        Decoder * d;
+        NodeRecord const * r;
+
+        template< typename T >
+        void operator()(T & t) {
+            d->fill(t, *r);
+        }
+    };
+
+    template< typename T >
+    void Decoder::fill(T & t, NodeRecord const & r) {
+        if(r.slots > header.slots) {
+            ok = false;
+            return;
+        }
+        uint32_t const * pos = slots + r.slots;
+        ast_member_visit<AstIDByType<T>::Id>::apply(t, decode_member{this, &pos, slots + header.slots, true});
+        Ast & a = t;
+        a.line = r.line;
+        a.column = r.column;
+    }
+
+    AstModulePtr Decoder::tree() {
+        built.reserve(header.nodes);
+        for(uint32_t i = 0; i < header.nodes && ok; ++i) {
+            AstPtr node;
+            if(!(nodes[i].flags & NodeFlag_ByValue)) {
+                node = create(AstType(nodes[i].type), arena);
+                if(!node) {
+                    ok = false;
+                    break;
+                }
+                visit(fill_node{this, &nodes[i]}, *node);
+            }
+            built.push_back(node);
+        }
+        if(!ok || built.empty() || !built.back() || built.back()->type != AstType::Module) {
+            ok = false;
+            return AstModulePtr();
+        }
+        return ast_cast<AstModule>(built.back());
+    }
+
+    void Decoder::table(SymbolTable & t) {
+        uint32_t future = next_symbol();
+        FutureFeatures & f = t.future_features;
+        f.nested_scopes     = (future & FutureFlag_NestedScopes) != 0;
+        f.generators        = (future & FutureFlag_Generators) != 0;
+        f.division          = (future & FutureFlag_Division) != 0;
+        f.absolute_imports  = (future & FutureFlag_AbsoluteImports) != 0;
+        f.with_statement    = (future & FutureFlag_WithStatement) != 0;
+        f.print_function    = (future & FutureFlag_PrintFunction) != 0;
+        f.unicode_literals  = (future & FutureFlag_UnicodeLiterals) != 0;
+        f.last_line         = int(next_symbol());
+        t.current_class = symbol_string();
+        if(next_symbol() && ok) {
+            t.module = entry(t);
+            t.current = t.module;
+        }
+    }
+
+    SymbolTableEntryPtr Decoder::entry(SymbolTable & t) {
+        auto e = std::make_shared<SymbolTableEntry>();
+        uint32_t id = next_symbol();
+        e->id = id && id <= built.size() ? built[id - 1].get() : 0;
+        e->type = BlockType(next_symbol());
+        e->name = symbol_string();
+        uint32_t flags = next_symbol();
+        e->is_nested            = (flags & EntryFlag_Nested) != 0;
+        e->returns_value        = (flags & EntryFlag_ReturnsValue) != 0;
+        e->has_varargs          = (flags & EntryFlag_Varargs) != 0;
+        e->has_varkw            = (flags & EntryFlag_Varkw) != 0;
+        e->is_generator         = (flags & EntryFlag_Generator) != 0;
+        e->in_loop              = (flags & EntryFlag_InLoop) != 0;
+        e->in_finally           = (flags & EntryFlag_InFinally) != 0;
+        e->has_free_vars        = (flags & EntryFlag_FreeVars) != 0;
+        e->child_has_free_vars  = (flags & EntryFlag_ChildFreeVars) != 0;
+        e->start_line       = int(next_symbol());
+        e->temp_name_count  = int(next_symbol());
+        e->unoptimized      = next_symbol();
+        e->opt_last_line    = int(next_symbol());
+        t.symbols[e->id] = e;
+
+        for(uint32_t count = next_symbol(); count && ok; --count) {
+            String name = symbol_string();
+            e->symbols[name] = next_symbol();
+        }
+        for(uint32_t count = next_symbol(); count && ok; --count) {
+            e->variables.insert(symbol_string());
+        }
+        for(uint32_t count = next_symbol(); count && ok; --count) {
+            e->children.push_back(entry(t));
+        }
+        return e;
+    }
+}
+
+void serialize(AstModule const & ast, SymbolTable const & symbols, std::string & out) {
+    Writer w(symbols);
+    // The encoder only reads the nodes, apply() needs them non const
+    w.add(const_cast<AstModule &>(ast), 0);
+    w.table(symbols);
+
+    Header header = {
+        Magic,
+        Version,
+        uint32_t(w.nodes.size()),
+        uint32_t(w.slots.size()),
+        uint32_t(w.string_offsets.size() - 1),
+        uint32_t(w.string_data.size()),
+        uint32_t(w.symbols.size()),
+        0
+    };
+    append(out, &header, 1);
+    append(out, w.nodes.data(), w.nodes.size());
+    append(out, w.slots.data(), w.slots.size());
+    append(out, w.string_offsets.data(), w.string_offsets.size());
+    append(out, w.symbols.data(), w.symbols.size());
+    out += w.string_data;
+    out.append((4 - w.string_data.size() % 4) % 4, '\0');
+}
+
+bool deserialize(char const * data, std::size_t length, String const & name,
+                 AstArena * arena, AstModulePtr & ast, SymbolTablePtr & symbols) {
+    if(reinterpret_cast<std::uintptr_t>(data) % alignof(Header) != 0) {
+        std::vector<uint32_t> aligned(length / sizeof(uint32_t) + 1);
+        std::memcpy(aligned.data(), data, length);
+        return deserialize(reinterpret_cast<char const *>(aligned.data()), length, name,
+                           arena, ast, symbols);
+    }
+    Sections sections;
+    if(!locate(data, length, sections)) {
+        return false;
+    }
+
+    Decoder decoder(sections, arena);
+    AstModulePtr module = decoder.tree();
+    SymbolTablePtr table = std::make_shared<SymbolTable>();
+    table->file_name = name;
+    if(decoder.ok) {
+        decoder.table(*table);
+    }
+    if(!decoder.ok) {
+        return false;
+    }
+    if(table->module) {
+        table->module->name = name;
+    }
+    ast = module;
+    symbols = table;
+    return true;
+}
+
+bool serialize_to_file(AstModule const & ast, SymbolTable const & symbols,
+                       std::string const & path) {
+    std::string data;
+    serialize(ast, symbols, data);
+    FILE * f = std::fopen(path.c_str(), "wb");
+    if(!f) {
+        return false;
+    }
+    bool ok = std::fwrite(data.data(), 1, data.size(), f) == data.size();
+    return std::fclose(f) == 0 && ok;
+}
+
+namespace {
+    // Where a member of a node type is found in the node's slots
+    struct MemberLayout {
+        SerializedKind kind;
+        SerializedKind element;     // Kind of the list elements
+        uint32_t slot;
+        uint32_t slots;
+    };
+
+    struct TypeLayout {
+        std::vector<MemberLayout> members;
+        char const * const * names;
+    };
+
+    template< typename T >
+    SerializedKind element_kind(AstPtrT<T> *) {
+        return SerializedKind::Node;
+    }
+
+    template< typename T >
+    typename std::enable_if<std::is_enum<T>::value, SerializedKind>::type
+    element_kind(T *) {
+        return SerializedKind::Value;
+    }
+
+    inline SerializedKind element_kind(uint32_t *) {
+        return SerializedKind::Value;
+    }
+
+    // Same order and slot counts as encode_member
+    struct layout_member {
+        TypeLayout * layout;
+        uint32_t * slot;
+        bool self_;
+
+        void add(SerializedKind kind, uint32_t slots,
+                 SerializedKind element = SerializedKind::Invalid) {
+            layout->members.push_back({kind, element, *slot, slots});
+            *slot += slots;
+        }
+
+        template< typename T >
+        typename std::enable_if<std::is_base_of<Ast, T>::value, bool>::type
+        operator()(T &) {
+            if(self_) {
+                self_ = false;
+            }
+            else {
+                add(SerializedKind::Node, 1);
+            }
+            return true;
+        }
+
+        template< typename T >
+        bool operator()(AstPtrT<T> &) {
+            add(SerializedKind::Node, 1);
+            return true;
+        }
+
+        template< typename T >
+        bool operator()(std::vector<T> &) {
+            add(SerializedKind::List, 2, element_kind(static_cast<T *>(0)));
+            return true;
+        }
+
+        template< typename T >
+        typename std::enable_if<std::is_enum<T>::value, bool>::type
+        operator()(T &) {
+            add(SerializedKind::Value, 1);
+            return true;
+        }
+
+        bool operator()(String &) {
+            add(SerializedKind::String, 1);
+            return true;
+        }
+
+        bool operator()(bool &) {
+            add(SerializedKind::Value, 1);
+            return true;
+        }
+
+        bool operator()(int &) {
+            add(SerializedKind::Value, 1);
+            return true;
+        }
+
+        bool operator()(uint32_t &) {
+            add(SerializedKind::Value, 1);
+            return true;
+        }
+
+        bool operator()(double &) {
+            add(SerializedKind::Float, 2);
+            return true;
+        }
+
+        bool operator()(int64_t &) {
+            add(SerializedKind::Integer, 2);
+            return true;
+        }
+
+        template< std::size_t N >
+        bool operator()(char (&)[N]) {
+            add(SerializedKind::Raw, (N + 3) / 4);
+            return true;
+        }
+    };
+
+    template< AstType Id >
+    TypeLayout type_layout() {
+        typename AstTypeByID<Id>::Type node;
+        TypeLayout layout;
+        uint32_t slot = 0;
+        ast_member_visit<Id>::apply(node, layout_member{&layout, &slot, true});
+        layout.names = ast_member_names<Id>::get();
+        return layout;
+    }
+
+    std::vector<TypeLayout> type_layouts() {
+        std::vector<TypeLayout> layouts;
+#undef PYPA_AST_TYPE
+#define PYPA_AST_TYPE(X) layouts.push_back(type_layout<AstType::X>());
+#   include <pypa/ast/ast_type.inl>
+#undef PYPA_AST_TYPE
+        return layouts;
+    }
+
+    // Indexed by AstType, null for unknown types
+    TypeLayout const * layout_of(uint16_t type) {
+        static std::vector<TypeLayout> const layouts = type_layouts();
+        return type < layouts.size() ? &layouts[type] : 0;
+    }
+
+    NodeRecord const & record(char const * nodes, std::size_t index) {
+        return reinterpret_cast<NodeRecord const *>(nodes)[index];
+    }
+}
+
+AstType SerializedNode::type() const {
+    return ast_ ? AstType(record(ast_->nodes_, index_).type) : AstType::Invalid;
+}
+
+uint32_t SerializedNode::line() const {
+    return ast_ ? record(ast_->nodes_, index_).line : 0;
+}
+
+uint32_t SerializedNode::column() const {
+    return ast_ ? record(ast_->nodes_, index_).column : 0;
+}
+
+std::size_t SerializedNode::member_count() const {
+    TypeLayout const * layout = ast_ ? layout_of(record(ast_->nodes_, index_).type) : 0;
+    return layout ? layout->members.size() : 0;
+}
+
+char const * SerializedNode::member_name(std::size_t i) const {
+    return i < member_count() ? layout_of(record(ast_->nodes_, index_).type)->names[i] : 0;
+}
+
+SerializedMember SerializedNode::member(std::size_t i) const {
+    if(i >= member_count()) {
+        return SerializedMember();
+    }
+    NodeRecord const & r = record(ast_->nodes_, index_);
+    MemberLayout const & m = layout_of(r.type)->members[i];
+    uint64_t first = uint64_t(r.slots) + m.slot;
+    if(first + m.slots > ast_->slot_count_) {
+        return SerializedMember();
+    }
+    uint32_t const * slots = ast_->slots_ + first;
+    if(m.kind != SerializedKind::List) {
+        return SerializedMember(ast_, m.kind, m.element, slots, m.slots);
+    }
+    // Lists refer to the slots of their elements
+    if(uint64_t(slots[0]) + slots[1] > ast_->slot_count_) {
+        return SerializedMember();
+    }
+    return SerializedMember(ast_, m.kind, m.element, ast_->slots_ + slots[0], slots[1]);
+}
+
+SerializedMember SerializedNode::member(char const * name) const {
+    for(std::size_t i = 0, count = member_count(); i < count; ++i) {
+        if(std::strcmp(member_name(i), name) == 0) {
+            return member(i);
+        }
+    }
+    return SerializedMember();
+}
+
+SerializedNode SerializedMember::node() const {
+    if(kind_ != SerializedKind::Node || slots_[0] == 0 || slots_[0] > ast_->node_count_) {
+        return SerializedNode();
+    }
+    return SerializedNode(ast_, slots_[0] - 1);
+}
+
+std::size_t SerializedMember::size() const {
+    return kind_ == SerializedKind::List ? size_ : 0;
+}
+
+SerializedMember SerializedMember::at(std::size_t i) const {
+    if(kind_ != SerializedKind::List || i >= size_) {
+        return SerializedMember();
+    }
+    return SerializedMember(ast_, element_, SerializedKind::Invalid, slots_ + i, 1);
+}
+
+StringRef SerializedMember::string() const {
+    if(kind_ != SerializedKind::String || slots_[0] >= ast_->string_count_) {
+        return StringRef();
+    }
+    uint32_t begin = ast_->string_offsets_[slots_[0]];
+    uint32_t end = ast_->string_offsets_[slots_[0] + 1];
+    if(begin > end || end > ast_->string_bytes_) {
+        return StringRef();
+    }
+    return StringRef(ast_->string_data_ + begin, end - begin);
+}
+
+uint32_t SerializedMember::value() const {
+    return kind_ == SerializedKind::Value ? slots_[0] : 0;
+}
+
+int64_t SerializedMember::integer() const {
+    int64_t result = 0;
+    if((kind_ == SerializedKind::Integer || kind_ == SerializedKind::Raw) && size_ * 4 >= sizeof(result)) {
+        std::memcpy(&result, slots_, sizeof(result));
+    }
+    return result;
+}
+
+double SerializedMember::floating() const {
+    double result = 0;
+    if((kind_ == SerializedKind::Float || kind_ == SerializedKind::Raw) && size_ * 4 >= sizeof(result)) {
+        std::memcpy(&result, slots_, sizeof(result));
+    }
+    return result;
+}
+
+SerializedAst::SerializedAst()
+: file_()
+, data_(0)
+, length_(0)
+, nodes_(0)
+, slots_(0)
+, string_offsets_(0)
+, string_data_(0)
+, node_count_(0)
+, slot_count_(0)
+, string_count_(0)
+, string_bytes_(0)
+{}
+
+SerializedAst::~SerializedAst()
+{}
+
+bool SerializedAst::open(char const * data, std::size_t length) {
+    Sections s;
+    if(reinterpret_cast<std::uintptr_t>(data) % alignof(Header) != 0 || !locate(data, length, s)) {
+        return false;
+    }
+    data_ = data;
+    length_ = length;
+    nodes_ = reinterpret_cast<char const *>(s.nodes);
+    slots_ = s.slots;
+    string_offsets_ = s.string_offsets;
+    string_data_ = s.string_data;
+    node_count_ = s.header->nodes;
+    slot_count_ = s.header->slots;
+    string_count_ = s.header->strings;
+    string_bytes_ = s.header->string_bytes;
+    return true;
+}
+
+bool SerializedAst::open(std::string const & path) {
+    file_.reset(new MMapReader(path));
+    char const * data = 0;
+    std::size_t length = 0;
+    return file_->get_source(data, length) && open(data, length);
+}
+
+SerializedNode SerializedAst::node(std::size_t index) const {
+    return index < node_count_ ? SerializedNode(this, index) : SerializedNode();
+}
+
+SerializedNode SerializedAst::root() const {
+    return node_count_ ? SerializedNode(this, node_count_ - 1) : SerializedNode();
+}
+
+bool SerializedAst::materialize(String const & name, AstArena * arena,
+                                AstModulePtr & ast, SymbolTablePtr & symbols) const {
+    return data_ && deserialize(data_, length_, name, arena, ast, symbols);
+}
+
+}
@@ -0,0 +1,168 @@
+// Copyright 2014 Vinzenz Feenstra
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#ifndef GUARD_PYPA_PARSER_SERIALIZE_HH_INCLUDED
+#define GUARD_PYPA_PARSER_SERIALIZE_HH_INCLUDED
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include <pypa/ast/ast.hh>
+#include <pypa/parser/symbol_table.hh>
+
+namespace pypa {
+
+// Version of the encoding written by serialize()
+enum : unsigned {
+    SerializeFormatVersion = 3
+};
+
+// Appends the binary encoding of `ast` and the symbol table built for it to
+// `out`. The members of every node type are taken from its PYPA_AST_MEMBERS
+// list, see serialize.cc for the layout.
+void serialize(AstModule const & ast, SymbolTable const & symbols, std::string & out);
+
+// Rebuilds the AST and the symbol table from the result of serialize(). The
+// nodes are created in `arena` (PYPA_AST_ARENA builds), `name` becomes the
+// file name of the symbol table. Returns false if `data` isn't a complete
+// encoding written by this version of the library.
+bool deserialize(char const * data, std::size_t length, String const & name,
+                 AstArena * arena, AstModulePtr & ast, SymbolTablePtr & symbols);
+
+// Writes the result of serialize() to the file `path`
+bool serialize_to_file(AstModule const & ast, SymbolTable const & symbols,
+                       std::string const & path);
+
+class MMapReader;
+class SerializedAst;
+class SerializedMember;
+
+// Kind of a member in the encoding, by the type of the member
+enum class SerializedKind {
+    Invalid,
+    Node,       // Node pointer or node held by value
+    List,       // std::vector of node pointers, enums or uint32_t
+    String,
+    Value,      // bool, int, uint32_t or enum
+    Integer,    // int64_t
+    Float,      // double
+    Raw         // Other fixed size data, e.g. AstNumber::data
+};
+
+// A node of a SerializedAst, its members are the ones of the node type's
+// PYPA_AST_MEMBERS list, in that order
+class SerializedNode {
+public:
+    SerializedNode() : ast_(0), index_(0) {}
+
+    explicit operator bool() const { return ast_ != 0; }
+
+    AstType type() const;
+    uint32_t line() const;
+    uint32_t column() const;
+    // Position in the node table, children come before their parents
+    std::size_t index() const { return index_; }
+
+    std::size_t member_count() const;
+    char const * member_name(std::size_t i) const;
+    SerializedMember member(std::size_t i) const;
+    // The member called `name`, an Invalid member if there's none
+    SerializedMember member(char const * name) const;
+
+private:
+    friend class SerializedAst;
+    friend class SerializedMember;
+    SerializedNode(SerializedAst const * ast, std::size_t index) : ast_(ast), index_(index) {}
+
+    SerializedAst const * ast_;
+    std::size_t index_;
+};
+
+// A member value or list element. The accessor matching kind() has to be
+// used, the others return empty values.
+class SerializedMember {
+public:
+    SerializedMember()
+    : ast_(0), kind_(SerializedKind::Invalid), element_(SerializedKind::Invalid), slots_(0), size_(0)
+    {}
+
+    SerializedKind kind() const { return kind_; }
+
+    SerializedNode node() const;                // An invalid node for null
+    std::size_t size() const;                   // Number of list elements
+    SerializedMember at(std::size_t i) const;   // List element
+    StringRef string() const;                   // A view into the encoding
+    uint32_t value() const;
+    int64_t integer() const;                    // Also for Raw
+    double floating() const;                    // Also for Raw
+
+private:
+    friend class SerializedNode;
+    SerializedMember(SerializedAst const * ast, SerializedKind kind, SerializedKind element,
+                     uint32_t const * slots, std::size_t size)
+    : ast_(ast), kind_(kind), element_(element), slots_(slots), size_(size) {}
+
+    SerializedAst const * ast_;
+    SerializedKind kind_;
+    SerializedKind element_;    // Kind of the list elements
+    uint32_t const * slots_;
+    std::size_t size_;          // Number of slots
+};
+
+// Read only access to the result of serialize(), e.g. in a mapped file,
+// without creating AST nodes. The encoding is walked in place, strings are
+// handed out as views into it.
+class SerializedAst {
+public:
+    SerializedAst();
+    ~SerializedAst();
+
+    SerializedAst(SerializedAst const &) = delete;
+    SerializedAst & operator=(SerializedAst const &) = delete;
+
+    // Uses `data`, which has to be 4 byte aligned and outlive the
+    // SerializedAst. Returns false if it isn't an encoding of this version.
+    bool open(char const * data, std::size_t length);
+    // Maps the file `path`, see serialize_to_file()
+    bool open(std::string const & path);
+
+    std::size_t size() const { return node_count_; }
+    SerializedNode node(std::size_t index) const;
+    SerializedNode root() const;                // The module
+
+    // Same as deserialize()
+    bool materialize(String const & name, AstArena * arena,
+                     AstModulePtr & ast, SymbolTablePtr & symbols) const;
+
+private:
+    friend class SerializedNode;
+    friend class SerializedMember;
+
+    std::unique_ptr<MMapReader> file_;
+    char const * data_;
+    std::size_t length_;
+    char const * nodes_;
+    uint32_t const * slots_;
+    uint32_t const * string_offsets_;
+    char const * string_data_;
+    uint32_t node_count_;
+    uint32_t slot_count_;
+    uint32_t string_count_;
+    uint32_t string_bytes_;
+};
+
+}
+
+#endif // GUARD_PYPA_PARSER_SERIALIZE_HH_INCLUDED
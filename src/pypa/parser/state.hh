@@ -16,74 +16,149 @@
 
 #include <pypa/parser/parser.hh>
 #include <pypa/parser/future_features.hh>
+#include <pypa/lexer/token_stream.hh>
+#include <memory>
 #include <string>
 #include <stack>
+#include <vector>
 
 namespace pypa {
 namespace {
+    inline bool is_line_end(char c) {
+        return c == '\n' || c == '\x0c';
+    }
+
+    // Line starts of a source as the Reader counts lines, found on demand
+    class LineStarts {
+        char const * data_;
+        std::size_t size_;
+        std::size_t scanned_;
+        std::vector<std::size_t> starts_;
+    public:
+        LineStarts(char const * data, std::size_t size)
+        : data_(data), size_(size), scanned_(0), starts_(1, 0)
+        {}
+
+        char const * data() const {
+            return data_;
+        }
+
+        // Offset of line `line`, the size of the source if there's no such line
+        std::size_t offset_of(std::size_t line) {
+            while(starts_.size() < line && scanned_ < size_) {
+                step();
+            }
+            return line <= starts_.size() ? starts_[line - 1] : size_;
+        }
+
+        // Tokens on the last line get the same line number as the ones on
+        // the line before if the source doesn't end with a line end. A
+        // statement with that line number can't be located.
+        bool before_unterminated_last_line(std::size_t line_start) const {
+            char const * end = data_ + size_;
+            char const * p = data_ + line_start;
+            while(p != end && !is_line_end(*p)) {
+                ++p;
+            }
+            if(p == end || ++p == end) {
+                return false;
+            }
+            while(p != end && !is_line_end(*p)) {
+                ++p;
+            }
+            return p == end;
+        }
+
+    private:
+        void step() {
+            if(is_line_end(data_[scanned_++])) {
+                starts_.push_back(scanned_);
+            }
+        }
+    };
+
     struct State {
         Lexer *                 lexer;
-        std::stack<TokenInfo>   tokens;
-        std::stack<TokenInfo>   popped;
-        std::stack<std::size_t> savepoints;
+        // tokens->get(position) is the current token, it's cached in
+        // tok_cur. Backtracking just moves position back.
+        TokenStream *           tokens;
+        std::size_t             position;
         TokenInfo               tok_cur;
+        std::vector<std::size_t> savepoints;
         std::stack<Error>       errors;
         ParserOptions           options;
         FutureFeatures          future_features;
+        // Lines of lexer->get_source(), set up by lazy_suite()
+        std::unique_ptr<LineStarts> lines;
+        // Added to options.stats by StatsReport
+        ParseStats              stats;
     };
 
-    inline TokenInfo pop(State & s) {
-        s.popped.push(s.tok_cur);
-        if(s.tokens.empty()) {
-            s.tok_cur = s.lexer->next();
-        }
-        else {
-            s.tok_cur = s.tokens.top();
-            s.tokens.pop();
-        }
+    inline void seek(State & s, std::size_t position) {
+        s.position = position;
+        s.tok_cur = s.tokens->get(position);
+    }
 
+    inline TokenInfo const & pop(State & s) {
+        seek(s, s.position + 1);
         return s.tok_cur;
     }
 
+    // Token `offset` tokens after the current one, doesn't move
+    inline TokenInfo peek(State & s, std::size_t offset) {
+        return s.tokens->get(s.position + offset);
+    }
+
     inline void unpop(State & s) {
-        s.tokens.push(s.tok_cur);
-        s.tok_cur = s.popped.top();
-        s.popped.pop();
+        seek(s, s.position - 1);
     }
 
     inline void save(State & s) {
-        s.savepoints.push(s.popped.size());
+        s.savepoints.push_back(s.position);
+        ++s.stats.savepoints;
     }
 
     inline void revert(State & s) {
+        ++s.stats.reverts;
         if(!s.savepoints.empty()) {
-            while(s.popped.size() != s.savepoints.top()) {
-                unpop(s);
+            if(s.position != s.savepoints.back()) {
+                seek(s, s.savepoints.back());
             }
-            s.savepoints.pop();
+            s.savepoints.pop_back();
         }
     }
 
     inline void pop_savepoint(State & s) {
         if(!s.savepoints.empty()) {
-            s.savepoints.pop();
+            s.savepoints.pop_back();
         }
     }
 
+    // Reverts the token state and resets the result slot unless committed.
+    // The slot is kept as a plain pointer with a matching reset function,
+    // entering a rule must not allocate.
     struct StateGuard {
-        StateGuard(State & s) : reset_(), s_(&s) { save(s); }
+        StateGuard(State & s) : slot_(0), reset_(0), s_(&s) { save(s); }
         template< typename T >
-        StateGuard(State & s, std::shared_ptr<T> & r) : reset_([&r](){r.reset();}), s_(&s) { save(s); }
-        ~StateGuard() { if(s_) revert(*s_); if(reset_) reset_(); }
-        bool commit() { if(s_) pop_savepoint(*s_); s_ = 0; reset_ = {}; return true; }
+        StateGuard(State & s, AstPtrT<T> & r) : slot_(&r), reset_(&reset_slot<T>), s_(&s) { save(s); }
+        ~StateGuard() { if(s_) revert(*s_); if(reset_) reset_(slot_); }
+        bool commit() { if(s_) pop_savepoint(*s_); s_ = 0; reset_ = 0; return true; }
     private:
-        std::function<void()> reset_;
+        template< typename T >
+        static void reset_slot(void * slot) { static_cast<AstPtrT<T> *>(slot)->reset(); }
+
+        void * slot_;
+        void (*reset_)(void *);
         State * s_;
     };
 
-    inline void commit(State & s) {
-        s.popped = std::stack<TokenInfo>();
-    }
+    // Adds the counters of a state to options.stats when it goes away
+    struct StatsReport {
+        StatsReport(State & s) : s_(s) {}
+        ~StatsReport() { if(s_.options.stats) *s_.options.stats += s_.stats; }
+    private:
+        State & s_;
+    };
 
     inline TokenInfo const & top(State & s) {
         return s.tok_cur;
@@ -102,13 +177,15 @@ namespace {
     }
 
     template< typename T >
-    inline std::shared_ptr<T> & create(std::shared_ptr<T> & t) {
-        return (t = std::make_shared<T>());
+    inline AstPtrT<T> & create(State & s, AstPtrT<T> & t) {
+        return (t = make_ast<T>(s.options.arena));
     }
 
     template< typename U, typename T >
-    inline std::shared_ptr<U> create(std::shared_ptr<T> & t) {
-        return std::static_pointer_cast<U>(t = std::make_shared<U>());
+    inline AstPtrT<U> create(State & s, AstPtrT<T> & t) {
+        AstPtrT<U> result = make_ast<U>(s.options.arena);
+        t = result;
+        return result;
     }
 
     inline void location(State & s, AstPtr a) {
@@ -172,7 +249,7 @@ namespace {
     template< typename T >
     inline bool consume_value(State & s, T t, String & v) {
         if(is(s, t)) {
-            v = top(s).value;
+            v = top(s).value.str();
             pop(s);
             return true;
         }
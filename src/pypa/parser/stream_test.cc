@@ -0,0 +1,165 @@
+// Copyright 2014 Vinzenz Feenstra
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include <pypa/parser/test_helper.hh>
+
+#if !defined(WIN32)
+#include <sys/resource.h>
+#endif
+
+// Test of parse_statements() against parse()
+//
+//   stream-test files...   - streams each file statement by statement, the
+//                            statements and their symbol table blocks have
+//                            to match the ones of the parsed module. The
+//                            same for a generated module of 20k lines.
+//                            Streaming 25k and 200k generated lines has to
+//                            raise the peak memory by about the same amount.
+
+using pypa::test::describe;
+using pypa::test::print_tree;
+
+namespace {
+    // Statements, blocks and module symbols, or "failed"
+    std::string parse_all(pypa::Lexer & lexer, std::size_t & errors) {
+        pypa::test::Parsed parsed;
+        parsed.parse(lexer);
+        errors = parsed.error_lines.size();
+        if (!parsed.success) {
+            return "failed";
+        }
+        std::string result;
+        for (auto & item : parsed.ast->body->items) {
+            if (item) {
+                result += print_tree(*item);
+            }
+        }
+        for (auto const & child : parsed.symbols->module->children) {
+            result += describe(child) + " ";
+        }
+        return result + describe(parsed.symbols->module, false);
+    }
+
+    std::string parse_streamed(pypa::Lexer & lexer, std::size_t & errors) {
+        pypa::test::Parsed parsed;
+        std::string statements;
+        std::string blocks;
+        pypa::SymbolTableEntryPtr module;
+        bool ok = pypa::parse_statements(lexer, [&](pypa::AstStmt const & statement,
+                                                    pypa::SymbolTablePtr const & symbols) {
+            if (statement) {
+                statements += print_tree(*statement);
+            }
+            // Blocks of earlier statements are gone
+            for (auto const & child : symbols->module->children) {
+                blocks += describe(child) + " ";
+            }
+            module = symbols->module;
+        }, parsed.options());
+        errors = parsed.error_lines.size();
+        if (!ok) {
+            return "failed";
+        }
+        return statements + blocks + (module ? describe(module, false) : "");
+    }
+
+    bool check(char const * name, char const * data, std::size_t length) {
+        std::size_t errors = 0;
+        pypa::Lexer full(data, length, name);
+        std::string expected = parse_all(full, errors);
+        std::size_t expected_errors = errors;
+        pypa::Lexer streamed(data, length, name);
+        std::string actual = parse_streamed(streamed, errors);
+        // A failed parse stops streaming at the first error
+        if (expected == "failed" ? actual != "failed" : actual != expected || errors != expected_errors) {
+            fprintf(stderr, "%s: streamed statements differ\n", name);
+            return false;
+        }
+        printf("%s: %s\n", name, expected == "failed" ? "doesn't parse" : "ok");
+        return true;
+    }
+
+    std::string generated_module(unsigned lines) {
+        std::string source = "'''Generated'''\nimport os\n";
+        char buffer[256];
+        for (unsigned i = 0; i < lines; i += 4) {
+            snprintf(buffer, sizeof(buffer),
+                     "value_%u = [%u, 'text %u', os.path, {'key': %u.5}]; other_%u = value_%u\n"
+                     "def function_%u(a, b=%u):\n"
+                     "    return [a + x for x in b if x != value_%u]\n\n",
+                     i, i, i, i, i, i, i, i, i);
+            source += buffer;
+        }
+        return source;
+    }
+
+    // Peak resident size in KB, 0 where it isn't known
+    long peak_kb() {
+#if defined(WIN32)
+        return 0;
+#else
+        struct rusage usage{};
+        getrusage(RUSAGE_SELF, &usage);
+        return usage.ru_maxrss;
+#endif
+    }
+
+    // How much streaming `lines` lines of small statements raises the peak
+    long stream_growth(unsigned lines) {
+        std::string source;
+        source.reserve(lines * 32);
+        char buffer[64];
+        for (unsigned i = 0; i < lines; ++i) {
+            snprintf(buffer, sizeof(buffer), "value = call(value, %u, 'text')\n", i);
+            source += buffer;
+        }
+        long before = peak_kb();
+        pypa::ParserOptions options;
+        options.printerrors = false;
+        pypa::Lexer lexer(source.data(), source.size(), "<generated>");
+        pypa::parse_statements(lexer, [](pypa::AstStmt const &, pypa::SymbolTablePtr const &) {},
+                               options);
+        return peak_kb() - before;
+    }
+
+    bool check_memory() {
+        long small = stream_growth(25000);
+        long large = stream_growth(200000);
+        // Anything kept per line (a line index, the consumed source) would
+        // take more than a MB for the large module
+        if (large > small + 512) {
+            fprintf(stderr, "<generated>: streaming peak grows with the line count "
+                            "(%ld KB for 25k lines, %ld KB for 200k lines)\n", small, large);
+            return false;
+        }
+        printf("<generated>: streaming peak %ld KB for 25k lines, %ld KB for 200k lines\n",
+               small, large);
+        return true;
+    }
+
+    int check_file(char const * file) {
+        std::string source = pypa::test::read_file(file);
+        return check(file, source.data(), source.size()) ? 0 : 1;
+    }
+
+    int check_generated() {
+        // First, while the peak isn't raised by the other checks yet
+        int failures = check_memory() ? 0 : 1;
+        std::string source = generated_module(20000);
+        return failures + (check("<generated>", source.data(), source.size()) ? 0 : 1);
+    }
+}
+
+int main(int argc, char const ** argv) {
+    return pypa::test::run(argc, argv, check_file, check_generated);
+}
@@ -37,6 +37,7 @@ namespace pypa {
             e->is_nested = true;
         }
         if(current) {
+            current->children.push_back(e);
             stack.push(current);
         }
         current = e;
@@ -52,6 +53,34 @@ namespace pypa {
         }
     }
     void create_from_ast(SymbolTablePtr p, Ast const & a, SymbolErrorReportFun add_err) {
-        walk_tree(a, symbol_table_visitor{p, add_err});
+        // The visitor doesn't modify the tree, it only needs the nodes
+        // themselves to use their addresses as block ids
+        walk_tree(const_cast<Ast &>(a), symbol_table_visitor{p, add_err, SymbolTablePtr(), 0});
+    }
+
+    void update_from_ast(SymbolTablePtr p, SymbolTablePtr previous, AstModule & module,
+                         std::set<Ast const *> const & changed, int first_line, int last_line,
+                         SymbolErrorReportFun add_err) {
+        p->enter_block(BlockType::Module, p->file_name, module);
+        p->current->unoptimized = OptimizeFlag_TopLevel;
+        SymbolErrorReportFun report = [&](Error e) {
+            if(int(e.cur.line) >= first_line && int(e.cur.line) < last_line) {
+                add_err(e);
+            }
+        };
+        symbol_table_visitor visitor{p, report, previous, &changed};
+        if(module.body) {
+            for(AstStmt & item : module.body->items) {
+                if(item) {
+                    walk_tree(*item, visitor);
+                }
+            }
+        }
+        p->leave_block();
+    }
+
+    void add_statement_from_ast(SymbolTablePtr p, Ast const & statement, SymbolErrorReportFun add_err) {
+        assert(p->current && p->current == p->module);
+        walk_tree(const_cast<Ast &>(statement), symbol_table_visitor{p, add_err, SymbolTablePtr(), 0});
     }
 }
@@ -16,6 +16,7 @@
 
 #include <list>
 #include <memory>
+#include <set>
 #include <stack>
 #include <functional>
 #include <unordered_set>
@@ -101,6 +102,19 @@ struct SymbolTable {
 typedef std::shared_ptr<SymbolTable> SymbolTablePtr;
 typedef std::function<void(pypa::Error)> SymbolErrorReportFun;
 void create_from_ast(SymbolTablePtr p, Ast const & a, SymbolErrorReportFun add_err);
+
+// Builds the table of `module` after statements of it were replaced (see
+// reparse()). The blocks in `changed` hold replaced statements and are
+// rebuilt, copies of the entries of the other blocks are taken over from
+// `previous`. Errors are only reported for the lines [first_line, last_line).
+void update_from_ast(SymbolTablePtr p, SymbolTablePtr previous, AstModule & module,
+                     std::set<Ast const *> const & changed, int first_line, int last_line,
+                     SymbolErrorReportFun add_err);
+
+// Adds the blocks and symbols of the top level statement `statement` to the
+// module block of `p`, which has to be the current block (see
+// parse_statements())
+void add_statement_from_ast(SymbolTablePtr p, Ast const & statement, SymbolErrorReportFun add_err);
 }
 
 #endif // GUARD_PYPA_PARSER_SYMBOL_TABLE_HH_INCLUDED
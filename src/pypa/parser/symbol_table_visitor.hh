@@ -30,6 +30,44 @@ namespace pypa {
     struct symbol_table_visitor {
         SymbolTablePtr table;
         SymbolErrorReportFun push_error;
+        // Set by update_from_ast(): blocks found in `previous` are unchanged
+        // unless they're in `changed`, copies of their entries are moved to
+        // the current lines of the blocks
+        SymbolTablePtr previous;
+        std::set<Ast const *> const * changed;
+
+        bool reuse_block(Ast & a) {
+            if(!previous || (changed && changed->count(&a))) {
+                return false;
+            }
+            auto it = previous->symbols.find(&a);
+            if(it == previous->symbols.end()) {
+                return false;
+            }
+            table->current->children.push_back(reuse_entry(it->second, int(a.line) - it->second->start_line));
+            return true;
+        }
+
+        // The entries of `previous` stay as they are, the caller may still
+        // use them
+        SymbolTableEntryPtr reuse_entry(SymbolTableEntryPtr const & e, int line_delta) {
+            SymbolTableEntryPtr copy = std::make_shared<SymbolTableEntry>(*e);
+            table->symbols[copy->id] = copy;
+            copy->start_line += line_delta;
+            if(copy->opt_last_line) {
+                copy->opt_last_line += line_delta;
+            }
+            // Global declarations of the block are recorded in the module
+            for(auto const & sym : copy->symbols) {
+                if((sym.second & SymbolFlag_Global) && table->module) {
+                    table->module->symbols[sym.first] |= sym.second & SymbolFlag_Global;
+                }
+            }
+            for(auto & child : copy->children) {
+                child = reuse_entry(child, line_delta);
+            }
+            return copy;
+        }
 
         void add_error(char const * message, Ast & o, int line = -1, char const * file = 0, char const * function = 0) {
             add_error(ErrorType::SyntaxError, message, o, line, file, function);
@@ -76,7 +114,7 @@ namespace pypa {
             for(AstExpr & e : args) {
                 assert(e && "Expected valid AstExpr instance");
                 if(e->type == AstType::Tuple) {
-                    AstTuple & t = *std::static_pointer_cast<AstTuple>(e);
+                    AstTuple & t = *ast_cast<AstTuple>(e);
                     params(t.elements, false);
                 }
             }
@@ -88,13 +126,13 @@ namespace pypa {
                 assert(e && "Expected valid AstExpr instance");
                 switch(e->type) {
                 case AstType::Name: {
-                    AstName &  n = *std::static_pointer_cast<AstName>(e);
+                    AstName &  n = *ast_cast<AstName>(e);
                     assert(n.context == AstContext::Param || (n.context == AstContext::Store && !toplevel));
                     add_def(n.id, SymbolFlag_Param, n);
                     break;
                 }
                 case AstType::Tuple: {
-                    AstTuple & t = *std::static_pointer_cast<AstTuple>(e);
+                    AstTuple & t = *ast_cast<AstTuple>(e);
                     assert(t.context == AstContext::Store);
                     if(toplevel) {
                         implicit_arg(uint32_t(i), t);
@@ -127,7 +165,7 @@ namespace pypa {
 
         String const & get_name(AstExpr const & expr) {
             assert(expr && expr->type == AstType::Name);
-            return std::static_pointer_cast<AstName>(expr)->id;
+            return ast_cast<AstName>(expr)->id;
         }
 
         String mangle(String name) {
@@ -192,6 +230,9 @@ namespace pypa {
 
             walk_tree(f.args.defaults, *this);
             walk_tree(f.decorators, *this);
+            if(reuse_block(f)) {
+                return false;
+            }
             table->enter_block(BlockType::Function, name, f);
             // TODO: Special arguments handling
             arguments(f.args);
@@ -229,8 +270,11 @@ namespace pypa {
 
             assert(!generators.empty() && generators.front());
 
-            AstComprehension & outermost = *std::static_pointer_cast<AstComprehension>(generators.front());
+            AstComprehension & outermost = *ast_cast<AstComprehension>(generators.front());
             walk_tree(*outermost.iter, *this);
+            if(reuse_block(e)) {
+                return;
+            }
 
             table->enter_block(BlockType::Function, scope_name, e);
 
@@ -276,6 +320,9 @@ namespace pypa {
 
             walk_tree(c.bases, *this);
             walk_tree(c.decorators, *this);
+            if(reuse_block(c)) {
+                return false;
+            }
             table->enter_block(BlockType::Class, name, c);
             String current_class;
             current_class.swap(table->current_class);
@@ -291,6 +338,9 @@ namespace pypa {
 
         bool operator() (AstLambda & l) {
             walk_tree(l.arguments.defaults, *this);
+            if(reuse_block(l)) {
+                return false;
+            }
             table->enter_block(BlockType::Function, "<lambda>", l);
             arguments(l.arguments);
             walk_tree(l.body, *this);
@@ -326,7 +376,7 @@ namespace pypa {
 
         bool operator() (AstImportFrom & i) {
             if(i.names) visit(*this, *i.names);
-            return true;
+            return false;
         }
 
         bool operator() (AstImport & i) {
@@ -335,7 +385,7 @@ namespace pypa {
         }
 
         bool operator() (AstAlias & a) {
-            AstName & n = *std::static_pointer_cast<AstName>(a.as_name ? a.as_name : a.name);
+            AstName & n = *ast_cast<AstName>(a.as_name ? a.as_name : a.name);
             String name = n.id;
             if(n.dotted) {
                 size_t pos = name.find_first_of('.');
@@ -427,7 +477,7 @@ namespace pypa {
         }
 
         template< typename T >
-        bool operator ()(T)
+        bool operator ()(T const &)
         {
             return true;
         }
@@ -27,7 +27,9 @@ int main(int argc, char const ** argv) {
     }
     pypa::AstModulePtr ast;
     pypa::SymbolTablePtr symbols;
+    pypa::AstArena arena;
     pypa::ParserOptions options;
+    options.arena = &arena;
     // options.python3allowed = true;
     options.printerrors = true;
     options.printdbgerrors = true;
@@ -0,0 +1,170 @@
+// Copyright 2014 Vinzenz Feenstra
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#ifndef GUARD_PYPA_PARSER_TEST_HELPER_HH_INCLUDED
+#define GUARD_PYPA_PARSER_TEST_HELPER_HH_INCLUDED
+
+#include <stdio.h>
+#include <algorithm>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include <pypa/parser/parser.hh>
+#include <pypa/parser/serialize.hh>
+#include <pypa/ast/tree_walker.hh>
+
+// Pieces shared by the parser tests, not installed
+
+namespace pypa {
+namespace test {
+
+inline bool expect(bool condition, char const * file, char const * what) {
+    if(!condition) {
+        fprintf(stderr, "%s: %s\n", file, what);
+    }
+    return condition;
+}
+
+inline std::string read_file(char const * path) {
+    std::ifstream ifs(path, std::ios::binary);
+    return std::string((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+}
+
+// Type, line and column of every node and the strings in walk_tree() order,
+// counts the lazy suites if `lazy` is set
+struct fingerprint {
+    std::string * out;
+    std::size_t * lazy;
+
+    template< typename T >
+    typename std::enable_if<std::is_base_of<Ast, T>::value, bool>::type
+    operator()(T & node) {
+        Ast & a = node;
+        char buffer[64];
+        snprintf(buffer, sizeof(buffer), "%d:%d:%d ", int(a.type), a.line, a.column);
+        *out += buffer;
+        if(lazy && a.type == AstType::LazySuite) {
+            ++*lazy;
+        }
+        return true;
+    }
+
+    bool operator()(String & s) {
+        *out += s + " ";
+        return true;
+    }
+
+    template< typename T >
+    typename std::enable_if<!std::is_base_of<Ast, T>::value, bool>::type
+    operator()(T &) {
+        return true;
+    }
+};
+
+inline std::string print_tree(Ast & tree, std::size_t * lazy = 0) {
+    std::string result;
+    walk_tree(tree, fingerprint{&result, lazy});
+    return result;
+}
+
+// Symbol table block with its symbols sorted by name
+inline std::string describe(SymbolTableEntryPtr const & e, bool children = true) {
+    char buffer[64];
+    snprintf(buffer, sizeof(buffer), "%d:%d:%d:%d", int(e->type), e->start_line,
+             int(e->is_generator), int(e->unoptimized));
+    std::string result = e->name + ":" + buffer + " {";
+    std::vector<std::string> symbols;
+    for(auto const & sym : e->symbols) {
+        snprintf(buffer, sizeof(buffer), "=%u", sym.second);
+        symbols.push_back(sym.first + buffer);
+    }
+    std::sort(symbols.begin(), symbols.end());
+    for(auto const & s : symbols) {
+        result += s + " ";
+    }
+    result += "}";
+    if(children) {
+        result += " [";
+        for(auto const & child : e->children) {
+            result += describe(child) + " ";
+        }
+        result += "]";
+    }
+    return result;
+}
+
+// Result of a parse, the nodes live in its own arena
+struct Parsed {
+    AstArena arena;
+    AstModulePtr ast;
+    SymbolTablePtr symbols;
+    ParseStats stats;
+    bool success;
+    std::vector<int> error_lines;
+
+    Parsed() : success(false) {}
+    Parsed(Parsed const &) = delete;
+    Parsed & operator=(Parsed const &) = delete;
+
+    // `base` without printing errors, collecting them and the stats here
+    ParserOptions options(ParserOptions base = ParserOptions()) {
+        base.printerrors = false;
+        base.arena = &arena;
+        base.stats = &stats;
+        base.error_handler = [this](Error e) { error_lines.push_back(int(e.cur.line)); };
+        return base;
+    }
+
+    bool parse(Lexer & lexer, ParserOptions base = ParserOptions()) {
+        return success = pypa::parse(lexer, ast, symbols, options(base));
+    }
+
+    bool parse(std::string const & source, ParserOptions base = ParserOptions()) {
+        Lexer lexer(source.data(), source.size(), "<test>");
+        return parse(lexer, base);
+    }
+
+    std::string serialized() const {
+        std::string result;
+        if(success && ast && symbols) {
+            serialize(*ast, *symbols, result);
+        }
+        return result;
+    }
+
+    std::string tree(std::size_t * lazy = 0) const {
+        return success && ast ? print_tree(*ast, lazy) : std::string();
+    }
+};
+
+// Runs `check` and then `check_file` for every file argument, returns the
+// exit code
+inline int run(int argc, char const ** argv, std::function<int(char const *)> check_file,
+               std::function<int()> check = std::function<int()>()) {
+    if(argc < 2) {
+        fprintf(stderr, "Usage: %s <python_file_path>...\n", argv[0]);
+        return 1;
+    }
+    int failures = check ? check() : 0;
+    for(int i = 1; i < argc; ++i) {
+        failures += check_file(argv[i]);
+    }
+    return failures == 0 ? 0 : 1;
+}
+
+}}
+
+#endif // GUARD_PYPA_PARSER_TEST_HELPER_HH_INCLUDED
@@ -0,0 +1,165 @@
+// Copyright 2014 Vinzenz Feenstra
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include <stdio.h>
+#include <stdlib.h>
+#include <atomic>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <pypa/parser/parser.hh>
+#include <pypa/parser/batch.hh>
+
+// Parses the given files from many threads at once, meant to be built with
+// -fsanitize=thread (pypa-tsan-stress target).
+//
+//   pypa-tsan-stress [-t threads] files...
+//
+// Every thread parses all files in a different order and checks the outcome
+// against a single threaded run, every other thread lexes from in memory
+// copies of the files. Then the files are parsed once more through
+// parse_many(), along with paths which can't be read, and with callbacks
+// throwing something which isn't a std::exception.
+
+namespace {
+    struct Outcome {
+        bool success;
+        std::size_t errors;
+        std::size_t statements;
+
+        bool operator==(Outcome const & o) const {
+            return success == o.success && errors == o.errors && statements == o.statements;
+        }
+    };
+
+    Outcome parse_file(char const * file, std::string const * source) {
+        pypa::AstArena arena;
+        pypa::AstModulePtr ast;
+        pypa::SymbolTablePtr symbols;
+        pypa::ParserOptions options;
+        Outcome outcome{false, 0, 0};
+        options.printerrors = false;
+        options.arena = &arena;
+        options.error_handler = [&outcome](pypa::Error) { ++outcome.errors; };
+        std::unique_ptr<pypa::Lexer> lexer;
+        if (source) {
+            lexer.reset(new pypa::Lexer(source->data(), source->size(), file));
+        }
+        else {
+            lexer.reset(new pypa::Lexer(file));
+        }
+        outcome.success = pypa::parse(*lexer, ast, symbols, options);
+        if (ast && ast->body) {
+            outcome.statements = ast->body->items.size();
+        }
+        return outcome;
+    }
+}
+
+int main(int argc, char const ** argv) {
+    unsigned threads = 8;
+    int first = 1;
+    if (argc > 2 && argv[1][0] == '-' && argv[1][1] == 't') {
+        threads = unsigned(atoi(argv[2]));
+        first = 3;
+    }
+    if (first >= argc || threads == 0) {
+        fprintf(stderr, "Usage: %s [-t threads] <python_file_path>...\n", argv[0]);
+        return 1;
+    }
+    std::vector<char const *> files(argv + first, argv + argc);
+    std::vector<Outcome> expected;
+    std::vector<std::string> sources;
+    for (auto file : files) {
+        expected.push_back(parse_file(file, 0));
+        std::ifstream ifs(file, std::ios::binary);
+        sources.emplace_back(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+    }
+
+    std::atomic<unsigned> mismatches(0);
+    std::vector<std::thread> pool;
+    for (unsigned t = 0; t < threads; ++t) {
+        pool.emplace_back([&, t]() {
+            for (std::size_t i = 0; i < files.size(); ++i) {
+                std::size_t index = (i + t) % files.size();
+                std::string const * source = t % 2 ? &sources[index] : 0;
+                if (!(parse_file(files[index], source) == expected[index])) {
+                    fprintf(stderr, "thread %u: %s differs\n", t, files[index]);
+                    ++mismatches;
+                }
+            }
+        });
+    }
+    for (auto & t : pool) {
+        t.join();
+    }
+
+    std::vector<pypa::ParseSource> batch(files.begin(), files.end());
+    // A missing file and a directory
+    batch.emplace_back(std::string(files[0]) + ".missing");
+    batch.emplace_back(std::string("."));
+    pypa::ParserOptions options;
+    for (auto const & result : pypa::parse_many(std::move(batch), threads, options)) {
+        if (result.index >= files.size()) {
+            if (result.success || result.errors.size() != 1
+                || result.errors.front().type != pypa::ErrorType::IOError) {
+                fprintf(stderr, "parse_many: %s didn't fail to read\n", result.name.c_str());
+                ++mismatches;
+            }
+            continue;
+        }
+        Outcome outcome{result.success, result.errors.size(),
+                        result.ast && result.ast->body ? result.ast->body->items.size() : 0};
+        if (!(outcome == expected[result.index])) {
+            fprintf(stderr, "parse_many: %s differs\n", files[result.index]);
+            ++mismatches;
+        }
+    }
+
+    // A throwing error_handler fails the source, but only it
+    std::string broken = "def f(:\n", fine = "x = 1\n";
+    std::vector<pypa::ParseSource> throwing;
+    throwing.emplace_back(broken.data(), broken.size(), "<broken>");
+    throwing.emplace_back(fine.data(), fine.size(), "<fine>");
+    std::atomic<unsigned> calls(0);
+    options.error_handler = [&calls](pypa::Error) { ++calls; throw 1; };
+    std::vector<pypa::ParseResult> results = pypa::parse_many(std::move(throwing), threads, options);
+    if (calls != 1 || results[0].success
+        || results[0].errors.back().type != pypa::ErrorType::SystemError
+        || !results[1].success || !results[1].errors.empty()) {
+        fprintf(stderr, "parse_many: a throwing error_handler isn't reported\n");
+        ++mismatches;
+    }
+
+    // A throwing on_result ends the batch, parse_many() rethrows it
+    std::vector<pypa::ParseSource> again(files.begin(), files.end());
+    calls = 0;
+    bool rethrown = false;
+    try {
+        pypa::parse_many(std::move(again), [&calls](pypa::ParseResult &) { ++calls; throw 2; }, threads);
+    }
+    catch (int e) {
+        rethrown = e == 2;
+    }
+    if (!rethrown || calls != 1) {
+        fprintf(stderr, "parse_many: a throwing on_result isn't rethrown\n");
+        ++mismatches;
+    }
+
+    printf("%zu files, %u threads, %u mismatches\n", files.size(), threads, mismatches.load());
+    return mismatches == 0 ? 0 : 1;
+}
@@ -30,6 +30,26 @@ public:
     virtual unsigned get_line_number() const = 0;
     virtual std::string get_filename() const = 0;
     virtual bool eof() const = 0;
+
+    // Same as next_line() but hands out a view on the line instead of a copy.
+    // The view is valid until the next call to next_line/next_line_view.
+    // Readers keeping the whole source in memory override this to avoid
+    // copying the line.
+    virtual bool next_line_view(char const *& line, std::size_t & length) {
+        line_ = next_line();
+        line = line_.data();
+        length = line_.size();
+        return length != 0;
+    }
+
+    // Hands out the whole source if the reader keeps it in memory, the view
+    // is valid as long as the reader. Used as the key of the ParseCache.
+    virtual bool get_source(char const *& data, std::size_t & length) const {
+        return false;
+    }
+
+private:
+    std::string line_;
 };
 
 }
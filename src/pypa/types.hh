@@ -16,12 +16,50 @@
 
 #include <vector>
 #include <string>
+#include <cstddef>
+#include <cstring>
 
 namespace pypa {
 
 typedef std::string String;
 typedef std::vector<String> StringList;
 
+// Non owning (pointer, length) view on a character sequence. The referenced
+// memory has to outlive the StringRef.
+class StringRef {
+public:
+    typedef char const * const_iterator;
+
+    StringRef() : data_(""), size_(0) {}
+    StringRef(char const * data, std::size_t size) : data_(data), size_(size) {}
+    StringRef(char const * str) : data_(str), size_(std::strlen(str)) {}
+    StringRef(String const & str) : data_(str.data()), size_(str.size()) {}
+
+    char const * data() const { return data_; }
+    std::size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+    const_iterator begin() const { return data_; }
+    const_iterator end() const { return data_ + size_; }
+
+    char operator[](std::size_t idx) const { return data_[idx]; }
+
+    String str() const { return String(data_, size_); }
+
+    friend bool operator==(StringRef const & lhs, StringRef const & rhs) {
+        return lhs.size_ == rhs.size_
+            && (lhs.size_ == 0 || std::memcmp(lhs.data_, rhs.data_, lhs.size_) == 0);
+    }
+
+    friend bool operator!=(StringRef const & lhs, StringRef const & rhs) {
+        return !(lhs == rhs);
+    }
+
+private:
+    char const * data_;
+    std::size_t size_;
+};
+
 }
 
 #endif // GUARD_PYPA_TYPES_HH_INCLUDED
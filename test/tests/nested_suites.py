@@ -0,0 +1,66 @@
+import os
+
+
+class Walker(object):
+    """Statements in nested suites"""
+
+    def __init__(self, root):
+        self.root = root
+        self.seen = set()
+        self.count = 0
+
+    @staticmethod
+    def visible(name):
+        prefix = '.'
+        return not name.startswith(prefix)
+
+    def walk(self, path):
+        names = os.listdir(path)
+        names.sort()
+        for name in names:
+            full = os.path.join(path, name)
+            if name in self.seen:
+                continue
+            elif os.path.isdir(full):
+                self.seen.add(name)
+                self.walk(full)
+            else:
+                self.count += 1
+                yield full
+        else:
+            total = self.count
+            self.count = total
+
+    def read(self, path):
+        result = None
+        try:
+            handle = open(path)
+            result = handle.read()
+            handle.close()
+        except IOError as e:
+            code = e.errno
+            result = code
+        finally:
+            self.seen.add(path)
+            self.count -= 1
+        try:
+            size = len(result)
+            size += 1
+        finally:
+            self.count += 1
+        with open(path) as f:
+            first = f.readline()
+            rest = f.read()
+        while rest:
+            line, _, rest = rest.partition('\n')
+            first = line
+        return result
+
+
+def main():
+    walker = Walker('.')
+    total = 0
+    for path in walker.walk('.'):
+        data = walker.read(path)
+        total += 1
+    print total
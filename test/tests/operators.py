@@ -0,0 +1,13 @@
+a or b or c and d and e or not f
+not a and not not b or c
+a < b <= c == d != e > f >= g
+a in b not in c is d is not e
+a | b ^ c & d << e >> f + g - h * i / j % k // l
+-a ** -b * ~c + +d
+a + b * c ** d ** e - f // g
+(a | b) ^ (c & d) << (e >> f)
+x = not a == b | c
+y = 1 + 2j - 3 - 4j
+z = a if b or c else d and e
+w = [i * 2 for i in range(10) if not i % 3 == 0 or i > 5]
+v = ((((((a + b) * c) - d) / e) ** f) % g)
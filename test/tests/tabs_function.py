@@ -0,0 +1,16 @@
+def f():
+	x = 1
+	return x
+z = 3
+
+class C(object):
+	def method(self, a):
+		"""Docstring"""
+		if a:
+			return a
+		return [a for a in self.values]
+
+	def other(self):
+		def inner():
+			return 1
+		return inner